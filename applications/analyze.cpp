@@ -0,0 +1,67 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "analysis.hpp"
+#include "thread_pool.hpp"
+
+#include "CLI/App.hpp"
+#include "CLI/Formatter.hpp"
+#include "CLI/Config.hpp"
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> files;
+    std::string format = "json";
+    std::string output;
+    int threads = 0;
+    double gap_factor = 2.0;
+
+    CLI::App app{"trakSTAR session analysis"};
+    app.add_option("files", files, "Raw captures or compressed pose logs")->required();
+    app.add_option("-f,--format", format, "Output format, json or csv")->check(CLI::IsMember({"json", "csv"}));
+    app.add_option("-o,--output", output, "Output file (stdout if omitted)");
+    app.add_option("-j,--threads", threads, "Worker threads, 0 for one per core");
+    app.add_option("--gap-factor", gap_factor, "Intervals longer than this times the median count as gaps");
+    CLI11_PARSE(app, argc, argv);
+
+    // one task per file, large files are balanced by work stealing
+    std::vector<SessionSummary> sessions(files.size());
+    {
+        ThreadPool pool(threads);
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            pool.submit([&, i]() { sessions[i] = summarize_file(files[i], gap_factor); });
+        }
+        pool.wait();
+    }
+
+    int failed = 0;
+    for (const auto &session : sessions)
+    {
+        if (!session.error.empty())
+        {
+            std::cerr << session.file << ": " << session.error << std::endl;
+            failed++;
+        }
+    }
+
+    std::string summary = format == "csv" ? sessions_to_csv(sessions) : sessions_to_json(sessions);
+    if (output.empty())
+    {
+        std::cout << summary;
+    }
+    else
+    {
+        std::ofstream file(output);
+        if (!file)
+        {
+            std::cerr << "Could not write " << output << std::endl;
+            return 1;
+        }
+        file << summary;
+    }
+
+    return failed == 0 ? 0 : 1;
+}
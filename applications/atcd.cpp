@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "atc3dg.hpp"
+#include "realtime.hpp"
+#include "synthetic_tracker.hpp"
+#include "tracker_shm.hpp"
+
+#include "CLI/App.hpp"
+#include "CLI/Formatter.hpp"
+#include "CLI/Config.hpp"
+
+static std::atomic<bool> running;
+
+void signal_handler(int signum)
+{
+    if (signum == SIGINT || signum == SIGTERM)
+    {
+        running = false;
+    }
+}
+
+void publish_topology(TrackerShmWriter &shm, const std::vector<SensorInfo> &topology)
+{
+    std::vector<TrackerShmSensor> sensors;
+    for (const SensorInfo &info : topology)
+    {
+        TrackerShmSensor sensor = {};
+        sensor.port = info.port;
+        sensor.attached = info.attached ? 1 : 0;
+        sensor.serial = info.serial;
+        strncpy(sensor.model, info.model.c_str(), TRACKER_SHM_STRING_LENGTH - 1);
+        strncpy(sensor.part, info.part.c_str(), TRACKER_SHM_STRING_LENGTH - 1);
+        sensors.push_back(sensor);
+    }
+    shm.set_topology(sensors.data(), sensors.size());
+}
+
+int main(int argc, char *argv[])
+{
+    std::string shm_name = TRACKER_SHM_NAME;
+    double rate = 0;
+    SyntheticOptions synthetic;
+    synthetic.sensors = 0;
+    RealtimeOptions realtime;
+
+    CLI::App app{"trakSTAR daemon, serves the tracker to local processes through shared memory"};
+    app.add_option("--shm", shm_name, "Shared memory object clients attach to");
+    app.add_option("-r,--rate", rate, "Tracker rate (Hz), the tracker's default if omitted");
+    app.add_option("--synthetic", synthetic.sensors, "Simulate this many sensors instead of a tracker");
+    app.add_option("--rt-priority", realtime.priority, "Run acquisition with SCHED_FIFO at this priority (1-99)");
+    app.add_option("--cpus", realtime.cpus, "Pin acquisition to these CPUs, e.g. 2,3")->delimiter(',');
+    app.add_flag("--mlock", realtime.lock_memory, "Lock all memory and pre-fault the stack");
+    CLI11_PARSE(app, argc, argv);
+
+    std::unique_ptr<ATC3DGTracker> tracker;
+    if (synthetic.sensors > 0)
+    {
+        if (rate > 0)
+        {
+            synthetic.rate = rate;
+        }
+        tracker.reset(new SyntheticTracker(synthetic));
+    }
+    else
+    {
+        tracker.reset(new ATC3DGTracker());
+    }
+    tracker->connect();
+    if (rate > 0)
+    {
+        tracker->set_rate(rate);
+    }
+    if (realtime.lock_memory)
+    {
+        realtime.prefault_stack = 256 * 1024;
+    }
+    tracker->set_realtime(realtime);
+
+    TrackerShmWriter shm;
+    shm.open(shm_name);
+    publish_topology(shm, tracker->get_topology());
+    shm.set_status(tracker->good(), tracker->get_rate(), atc3dg_time());
+
+    // the acquisition thread is the only publisher
+    tracker->subscribe([&](const Sample &sample) {
+        shm.publish(sample);
+    });
+
+    running = true;
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    tracker->start();
+
+    std::cout << tracker->get_number_sensors() << (synthetic.sensors > 0 ? " synthetic" : "") << " sensors at "
+              << tracker->get_rate() << " Hz served at " << shm_name << "." << std::endl;
+
+    // the acquisition thread recovers the tracker and refreshes the
+    // topology, clients see both through the heartbeat
+    while (running && tracker->acquiring())
+    {
+        publish_topology(shm, tracker->get_topology());
+        shm.set_status(tracker->good(), tracker->get_rate(), atc3dg_time());
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    tracker->stop();
+    shm.close();
+    tracker->disconnect();
+
+    ATC3DGStats stats = tracker->get_stats();
+    std::cout << "Daemon stopped, " << stats.recoveries << " recoveries." << std::endl;
+
+    return 0;
+}
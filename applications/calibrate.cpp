@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "analysis.hpp"
+#include "calibration.hpp"
+
+#include "CLI/App.hpp"
+#include "CLI/Formatter.hpp"
+#include "CLI/Config.hpp"
+
+using json = nlohmann::json;
+
+// fixed transform entry of a transform graph configuration
+json fixed_transform(const std::string &name, const std::string &parent, const Pose &pose)
+{
+    QuadMatrix<4> m = pose.matrix();
+    json rows = json::array();
+    for (int i = 0; i < 4; i++)
+    {
+        rows.push_back({m.get(i, 0), m.get(i, 1), m.get(i, 2), m.get(i, 3)});
+    }
+    json entry = {{"name", name}, {"type", "fixed"}};
+    if (!parent.empty())
+    {
+        entry["parent"] = parent;
+    }
+    entry["matrix"] = rows;
+    return entry;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string mode;
+    std::string filename;
+    std::string output;
+    std::string name;
+    std::string parent;
+    int sensor = 1;
+    int hand_sensor = 0;
+    int eye_sensor = 1;
+    double max_offset = 0.005;
+    int threads = 0;
+
+    CLI::App app{"trakSTAR pivot and hand-eye calibration"};
+    app.add_option("mode", mode, "pivot or handeye")->required()->check(CLI::IsMember({"pivot", "handeye"}));
+    app.add_option("file", filename, "Raw capture or compressed pose log with quaternions")->required();
+    app.add_option("-s,--sensor", sensor, "Sensor of the pivoted tool");
+    app.add_option("--hand", hand_sensor, "Sensor on the hand");
+    app.add_option("--eye", eye_sensor, "Sensor to calibrate against the hand");
+    app.add_option("--max-offset", max_offset, "Largest time between paired hand and eye samples, seconds");
+    app.add_option("-n,--name", name, "Name of the calibrated transform (StylusTip or Eye by default)");
+    app.add_option("-p,--parent", parent, "Parent of the calibrated transform (Tool or Hand by default)");
+    app.add_option("-o,--output", output, "Output file for the transform entry (stdout if omitted)");
+    app.add_option("-j,--threads", threads, "Worker threads, 0 for one per core");
+    CLI11_PARSE(app, argc, argv);
+
+    json entry;
+    try
+    {
+        std::vector<Sample> samples;
+        read_capture(filename, samples, threads);
+        auto start = std::chrono::steady_clock::now();
+
+        if (mode == "pivot")
+        {
+            std::vector<Pose> poses = sensor_poses(samples, sensor);
+            PivotCalibration result = calibrate_pivot(poses, threads);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            std::cerr << "Poses:    " << result.poses << " (" << seconds * 1000.0 << " ms)" << std::endl;
+            std::cerr << "Tip:      " << result.tip[0] << " " << result.tip[1] << " " << result.tip[2] << " mm" << std::endl;
+            std::cerr << "Pivot:    " << result.pivot[0] << " " << result.pivot[1] << " " << result.pivot[2] << " mm" << std::endl;
+            std::cerr << "Residual: " << result.rms << " mm RMS, " << result.max_error << " mm max" << std::endl;
+
+            Pose tip = Pose::identity();
+            std::copy(result.tip, result.tip + 3, tip.t);
+            entry = fixed_transform(name.empty() ? "StylusTip" : name, parent.empty() ? "Tool" : parent, tip);
+        }
+        else
+        {
+            std::vector<Pose> hand;
+            std::vector<Pose> eye;
+            paired_poses(samples, hand_sensor, eye_sensor, hand, eye, max_offset);
+            HandEyeCalibration result = calibrate_hand_eye(hand, eye, threads);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            std::cerr << "Pairs:    " << hand.size() << ", " << result.motions << " motions (" << seconds * 1000.0 << " ms)" << std::endl;
+            std::cerr << "Rotation: " << result.x.q[0] << " " << result.x.q[1] << " " << result.x.q[2] << " " << result.x.q[3] << std::endl;
+            std::cerr << "Offset:   " << result.x.t[0] << " " << result.x.t[1] << " " << result.x.t[2] << " mm" << std::endl;
+            std::cerr << "Residual: " << result.rotation_rms << " deg RMS, " << result.translation_rms << " mm RMS" << std::endl;
+
+            entry = fixed_transform(name.empty() ? "Eye" : name, parent.empty() ? "Hand" : parent, result.x);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << filename << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (output.empty())
+    {
+        std::cout << entry.dump() << std::endl;
+    }
+    else
+    {
+        std::ofstream file(output);
+        if (!file)
+        {
+            std::cerr << "Could not write " << output << std::endl;
+            return 1;
+        }
+        file << entry.dump() << std::endl;
+    }
+
+    return 0;
+}
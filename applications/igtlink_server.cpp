@@ -1,24 +1,57 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
 #include <math.h>
+#include <memory>
+#include <mutex>
 #include <cstdlib>
 #include <csignal>
+#include <cstring>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 #include "atc3dg.hpp"
-
-#include "matrix.hpp"
-
+#include "atc3dg_client.hpp"
+
+#include "frame_queue.hpp"
+#include "pose.hpp"
+#include "pose_shm.hpp"
+#include "poll_scheduler.hpp"
+#include "realtime.hpp"
+#include "resampler.hpp"
+#include "synthetic_tracker.hpp"
+#include "transform_graph.hpp"
+#include "udp_sender.hpp"
+
+#include "igtlMath.h"
+#include "igtlMessageHeader.h"
 #include "igtlOSUtil.h"
 #include "igtlPositionMessage.h"
+#include "igtlQuaternionTrackingDataMessage.h"
 #include "igtlServerSocket.h"
 #include "igtlTrackingDataMessage.h"
 #include "igtlTransformMessage.h"
 #include "igtlPointMessage.h"
+#include "igtlTimeStamp.h"
+#include "igtl_header.h"
+#include "igtl_tdata.h"
 
 #include "CLI/App.hpp"
 #include "CLI/Formatter.hpp"
 #include "CLI/Config.hpp"
 
-static bool running;
+// how often a receiver thread waiting for requests checks whether its
+// client is being stopped, in milliseconds
+#define RECEIVE_TIMEOUT 200
+// "ATCU" and the sequence number in front of a UDP datagram
+#define UDP_PREFIX_SIZE 8
+// transforms that fit into one UDP datagram
+#define UDP_TRANSFORMS ((UDP_MAX_DATAGRAM - UDP_PREFIX_SIZE - IGTL_HEADER_SIZE) / IGTL_TDATA_ELEMENT_SIZE)
+
+static std::atomic<bool> running;
 
 
 void signal_handler(int signum)
@@ -31,22 +64,446 @@ void signal_handler(int signum)
     }
 }
 
+// what a client asked for with STT_/STP_ requests
+enum StreamMode {
+    // TRANSFORM messages of all transforms, until the client sends a request
+    STREAM_TRANSFORM,
+    STREAM_TDATA,
+    STREAM_QTDATA,
+    STREAM_STOPPED
+};
+
+// a connected client, fed by the acquisition thread through its own queue
+// so that a slow client only loses frames and never delays sampling
+struct Client {
+    /**
+     * \param period seconds between frames of the acquisition thread
+     */
+    Client(igtl::Socket::Pointer socket, size_t backlog, double period) : socket(socket),
+                                                                          queue(backlog),
+                                                                          connected(true),
+                                                                          sent(0),
+                                                                          max_backlog(0),
+                                                                          mode(STREAM_TRANSFORM),
+                                                                          resolution(0),
+                                                                          next_delivery(0),
+                                                                          tolerance(period / 2),
+                                                                          settings(0)
+    {
+    }
+
+    // called by the acquisition thread, never blocks on the network; frames
+    // are decimated to the requested resolution before they are queued
+    void deliver(const std::shared_ptr<const PoseShmFrame> &frame)
+    {
+        if (mode == STREAM_STOPPED)
+        {
+            return;
+        }
+        double step = resolution;
+        if (step > 0)
+        {
+            double next = next_delivery;
+            if (frame->timestamp + tolerance < next)
+            {
+                return;
+            }
+            // stay on the grid unless more than one step behind
+            next_delivery = frame->timestamp - next < step ? next + step : frame->timestamp + step;
+        }
+
+        queue.push(frame);
+        size_t backlog = queue.size();
+        if (backlog > max_backlog)
+        {
+            max_backlog = backlog;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.notify_one();
+    }
+
+    void request(StreamMode requested, double seconds, const std::vector<std::string> &selection)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tools = selection;
+            settings++;
+        }
+        resolution = seconds;
+        next_delivery = 0;
+        mode = requested;
+    }
+
+    // sends a message, replies of the receiver thread may interleave
+    bool send(igtl::MessageBase *message)
+    {
+        message->Pack();
+        std::lock_guard<std::mutex> lock(send_mutex);
+        return socket->Send(message->GetPackPointer(), message->GetPackSize());
+    }
+
+    void disconnected()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            connected = false;
+        }
+        ready.notify_one();
+    }
+
+    // the socket is closed last, closing it does not wake a thread
+    // blocked on it and its descriptor may be reused
+    void stop()
+    {
+        disconnected();
+        if (sender.joinable())
+        {
+            sender.join();
+        }
+        if (receiver.joinable())
+        {
+            receiver.join();
+        }
+        socket->CloseSocket();
+    }
+
+    igtl::Socket::Pointer socket;
+    // frames are shared by all clients, a queue only holds references
+    FrameQueue<std::shared_ptr<const PoseShmFrame>> queue;
+    std::thread sender;
+    std::thread receiver;
+    std::atomic<bool> connected;
+    std::atomic<uint64_t> sent;
+    std::atomic<size_t> max_backlog;
+
+    std::atomic<int> mode;
+    // seconds between frames, 0 for every frame
+    std::atomic<double> resolution;
+    std::atomic<double> next_delivery;
+    double tolerance;
+    // transforms the client asked for, all if empty; guarded by mutex
+    std::vector<std::string> tools;
+    uint64_t settings;
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::mutex send_mutex;
+};
+
+// tools are selected by the device name of a request, a comma-separated
+// list of transform names; a name that matches none of the transforms,
+// e.g. that of the client or "Tracker", selects all of them
+std::vector<std::string> parse_tools(const std::string &device_name, const std::vector<std::string> &transforms)
+{
+    std::vector<std::string> tools;
+    std::stringstream names(device_name);
+    std::string name;
+    while (std::getline(names, name, ','))
+    {
+        if (std::find(transforms.begin(), transforms.end(), name) != transforms.end())
+        {
+            tools.push_back(name);
+        }
+    }
+    return tools;
+}
+
+bool selected(const std::vector<std::string> &tools, const char *name)
+{
+    if (tools.empty())
+    {
+        return true;
+    }
+    for (const auto &tool : tools)
+    {
+        if (tool == name)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// sender thread of a client
+void send_frames(Client &client, const RealtimeOptions &realtime)
+{
+    for (const auto& error : apply_realtime(realtime))
+    {
+        std::cerr << "Real-time setup of a send thread: " << error << std::endl;
+    }
+
+    std::shared_ptr<const PoseShmFrame> shared;
+    float matrix[4][4];
+    std::vector<std::string> tools;
+    uint64_t settings = 0;
+    auto timestamp = igtl::TimeStamp::New();
+
+    while (client.connected)
+    {
+        if (!client.queue.pop(shared))
+        {
+            std::unique_lock<std::mutex> lock(client.mutex);
+            client.ready.wait(lock, [&client]() { return client.queue.size() > 0 || !client.connected; });
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(client.mutex);
+            if (settings != client.settings)
+            {
+                tools = client.tools;
+                settings = client.settings;
+            }
+        }
+        const PoseShmFrame &frame = *shared;
+        // clients expect seconds since the epoch
+        timestamp->SetTime(atc3dg_wall_time(frame.timestamp));
+
+        bool ok = true;
+        int mode = client.mode;
+        if (mode == STREAM_TRANSFORM)
+        {
+            for (uint32_t n = 0; n < frame.count && ok; n++)
+            {
+                const PoseShmTransform &transform = frame.transforms[n];
+                if (!transform.valid)
+                {
+                    continue;
+                }
+                auto transform_message = igtl::TransformMessage::New();
+                transform_message->SetDeviceName(transform.name);
+                memcpy(matrix, transform.matrix, sizeof(matrix));
+                transform_message->SetMatrix(matrix);
+                transform_message->SetTimeStamp(timestamp);
+                ok = client.send(transform_message.GetPointer());
+            }
+        }
+        else if (mode == STREAM_TDATA)
+        {
+            auto tdata_message = igtl::TrackingDataMessage::New();
+            tdata_message->SetDeviceName("Tracker");
+            for (uint32_t n = 0; n < frame.count; n++)
+            {
+                const PoseShmTransform &transform = frame.transforms[n];
+                if (!transform.valid || !selected(tools, transform.name))
+                {
+                    continue;
+                }
+                auto element = igtl::TrackingDataElement::New();
+                element->SetName(transform.name);
+                element->SetType(igtl::TrackingDataElement::TYPE_6D);
+                memcpy(matrix, transform.matrix, sizeof(matrix));
+                element->SetMatrix(matrix);
+                tdata_message->AddTrackingDataElement(element);
+            }
+            tdata_message->SetTimeStamp(timestamp);
+            ok = client.send(tdata_message.GetPointer());
+        }
+        else if (mode == STREAM_QTDATA)
+        {
+            // 7 floats per tool instead of 12
+            auto qtdata_message = igtl::QuaternionTrackingDataMessage::New();
+            qtdata_message->SetDeviceName("Tracker");
+            for (uint32_t n = 0; n < frame.count; n++)
+            {
+                const PoseShmTransform &transform = frame.transforms[n];
+                if (!transform.valid || !selected(tools, transform.name))
+                {
+                    continue;
+                }
+                auto element = igtl::QuaternionTrackingDataElement::New();
+                element->SetName(transform.name);
+                element->SetType(igtl::QuaternionTrackingDataElement::TYPE_6D);
+                // OpenIGTLink orders quaternions (x, y, z, w)
+                const float *q = transform.quaternion;
+                element->SetPosition(transform.matrix[0][3], transform.matrix[1][3], transform.matrix[2][3]);
+                element->SetQuaternion(q[1], q[2], q[3], q[0]);
+                qtdata_message->AddQuaternionTrackingDataElement(element);
+            }
+            qtdata_message->SetTimeStamp(timestamp);
+            ok = client.send(qtdata_message.GetPointer());
+        }
+
+        if (!ok)
+        {
+            client.disconnected();
+            break;
+        }
+        client.sent++;
+    }
+}
+
+// acknowledges a start or stop request with RTS_TDATA or RTS_QTDATA
+bool reply(Client &client, bool quaternion, const char *device_name)
+{
+    if (quaternion)
+    {
+        auto message = igtl::RTSQuaternionTrackingDataMessage::New();
+        message->SetDeviceName(device_name);
+        message->SetStatus(igtl::RTSQuaternionTrackingDataMessage::STATUS_SUCCESS);
+        return client.send(message.GetPointer());
+    }
+    auto message = igtl::RTSTrackingDataMessage::New();
+    message->SetDeviceName(device_name);
+    message->SetStatus(igtl::RTSTrackingDataMessage::STATUS_SUCCESS);
+    return client.send(message.GetPointer());
+}
+
+// receiver thread of a client, handles STT_ and STP_ requests for TDATA
+// and QTDATA and ignores everything else
+void receive_requests(Client &client, const std::vector<std::string> &transforms)
+{
+    auto header = igtl::MessageHeader::New();
+    // wake up now and then to notice stop()
+    client.socket->SetReceiveTimeout(RECEIVE_TIMEOUT);
+    while (client.connected)
+    {
+        header->InitPack();
+        bool timeout = false;
+        igtlUint64 size = client.socket->Receive(header->GetPackPointer(), header->GetPackSize(), timeout);
+        if (size == 0 && timeout)
+        {
+            // idle client
+            continue;
+        }
+        if (size != (igtlUint64)header->GetPackSize())
+        {
+            client.disconnected();
+            break;
+        }
+        header->Unpack();
+
+        std::string type = header->GetDeviceType();
+        std::vector<std::string> tools = parse_tools(header->GetDeviceName(), transforms);
+        bool ok = true;
+        if (type == "STT_TDATA")
+        {
+            auto start = igtl::StartTrackingDataMessage::New();
+            start->SetMessageHeader(header);
+            start->AllocatePack();
+            size = client.socket->Receive(start->GetPackBodyPointer(), start->GetPackBodySize(), timeout);
+            if (size != (igtlUint64)start->GetPackBodySize())
+            {
+                client.disconnected();
+                break;
+            }
+            start->Unpack(1);
+            client.request(STREAM_TDATA, start->GetResolution() / 1000.0, tools);
+            ok = reply(client, false, header->GetDeviceName());
+        }
+        else if (type == "STT_QTDATA")
+        {
+            auto start = igtl::StartQuaternionTrackingDataMessage::New();
+            start->SetMessageHeader(header);
+            start->AllocatePack();
+            size = client.socket->Receive(start->GetPackBodyPointer(), start->GetPackBodySize(), timeout);
+            if (size != (igtlUint64)start->GetPackBodySize())
+            {
+                client.disconnected();
+                break;
+            }
+            start->Unpack(1);
+            client.request(STREAM_QTDATA, start->GetResolution() / 1000.0, tools);
+            ok = reply(client, true, header->GetDeviceName());
+        }
+        else if (type == "STP_TDATA" || type == "STP_QTDATA")
+        {
+            client.socket->Skip(header->GetBodySizeToRead(), 0);
+            client.request(STREAM_STOPPED, 0, {});
+            ok = reply(client, type == "STP_QTDATA", header->GetDeviceName());
+        }
+        else
+        {
+            client.socket->Skip(header->GetBodySizeToRead(), 0);
+        }
+
+        if (!ok)
+        {
+            client.disconnected();
+            break;
+        }
+    }
+}
+
 int main(int argc, char *argv[])
 {
     int port = 18944;
     int timeout = 1000;
     bool dry = false;
+    SyntheticOptions synthetic;
+    synthetic.sensors = 0;
+    std::string synthetic_motion_name = "mixed";
+    std::string config;
+    bool no_align = false;
+    std::string shm_name;
+    std::string daemon;
+    std::string udp_destination;
+    int udp_ttl = 1;
+    std::string udp_interface;
+    RealtimeOptions realtime;
+    RealtimeOptions send_realtime;
+    send_realtime.priority = -1;
+    int backlog = 8;
+    bool adaptive = false;
+    SchedulerOptions scheduling;
 
     // parse command line args
     CLI::App app{"trakSTAR IGTLink Server"};
     app.add_option("-p,--port", port, "Server port");
     app.add_option("-t,--timeout", timeout, "Connection timeout");
-    app.add_flag("-d,--dry", dry, "Dry run (without tracker)");
+    app.add_flag("-d,--dry", dry, "Dry run with one synthetic sensor instead of a tracker");
+    app.add_option("--synthetic", synthetic.sensors, "Simulate this many sensors instead of a tracker");
+    app.add_option("--synthetic-rate", synthetic.rate, "Rate of the simulated sensors (Hz)");
+    app.add_option("--synthetic-motion", synthetic_motion_name, "Motion of the simulated sensors")
+        ->check(CLI::IsMember({"static", "sine", "walk", "step", "mixed"}));
+    app.add_option("--synthetic-seed", synthetic.seed, "Seed of the simulated motion");
+    app.add_option("--daemon", daemon, "Attach to the tracker daemon at this shared memory object, e.g. " TRACKER_SHM_NAME);
+    app.add_option("-c,--config", config, "Transform graph configuration (JSON)")->check(CLI::ExistingFile);
+    app.add_flag("--no-align", no_align, "Do not resample sensors to a common timestamp");
+    app.add_option("--shm", shm_name, "Also publish frames to this POSIX shared memory object, e.g. /atc3dg");
+    app.add_option("--udp", udp_destination, "Also send frames as UDP datagrams to host:port (unicast or multicast)");
+    app.add_option("--udp-ttl", udp_ttl, "Time to live of multicast datagrams");
+    app.add_option("--udp-interface", udp_interface, "IPv4 address of the interface to send multicast on");
+    app.add_option("--rt-priority", realtime.priority, "Run acquisition with SCHED_FIFO at this priority (1-99)");
+    app.add_option("--send-rt-priority", send_realtime.priority, "Run send threads with SCHED_FIFO at this priority, one below --rt-priority if omitted");
+    app.add_option("--cpus", realtime.cpus, "Pin acquisition and send threads to these CPUs, e.g. 2,3")->delimiter(',');
+    app.add_flag("--mlock", realtime.lock_memory, "Lock all memory and pre-fault the stack");
+    app.add_option("--backlog", backlog, "Frames queued per client before the oldest are dropped");
+    app.add_flag("--adaptive", adaptive, "Share the polls the link can carry among the sensors by their motion");
+    app.add_option("--poll-budget", scheduling.budget, "Polls per second for --adaptive, measured if omitted");
+    app.add_option("--min-rate", scheduling.min_rate, "Rate static sensors are polled at with --adaptive (Hz)");
+    app.add_option("--priority", scheduling.priorities, "Weight of each port with --adaptive, e.g. 1,4,1,1")->delimiter(',');
     CLI11_PARSE(app, argc, argv);
 
+    if (dry && synthetic.sensors == 0)
+    {
+        synthetic.sensors = 1;
+    }
+    synthetic.motion = synthetic_motion(synthetic_motion_name);
+
+    TransformGraph graph = TransformGraph::default_graph();
+    if (!config.empty())
+    {
+        graph.load(config);
+    }
+    else if (synthetic.sensors > 2)
+    {
+        // one transform per simulated sensor
+        graph = TransformGraph();
+        for (int sensor = 0; sensor < synthetic.sensors; sensor++)
+        {
+            graph.add_sensor("Sensor" + std::to_string(sensor), sensor);
+        }
+    }
+    std::vector<int> ports = graph.ports();
+    std::vector<std::string> transform_names;
+    for (int n = 0; n < graph.size(); n++)
+    {
+        transform_names.push_back(graph.node(n).name);
+    }
+
     auto server_socket = igtl::ServerSocket::New();
     int status = server_socket->CreateServer(port);
-    igtl::Socket::Pointer client_socket;
 
     if (status < 0)
     {
@@ -55,167 +512,454 @@ int main(int argc, char *argv[])
         exit(EXIT_FAILURE);
     }
 
-    ATC3DGTracker tracker;
-    int num_sensors;
-    int interval;
-
-    if (!dry)
+    std::unique_ptr<ATC3DGTracker> tracker;
+    if (synthetic.sensors > 0)
     {
-        tracker.connect();
-
-        num_sensors = tracker.get_number_sensors();
-        std::cout << num_sensors << " sensors connected." << std::endl;
-        interval = (int)(1000.0 / tracker.get_rate());
+        tracker.reset(new SyntheticTracker(synthetic));
+    }
+    else if (!daemon.empty())
+    {
+        tracker.reset(new ATC3DGClient(daemon));
     }
     else
     {
-        num_sensors = 1;
-        interval = (int)(1000.0 / 80.0);
+        tracker.reset(new ATC3DGTracker());
+    }
+    tracker->connect();
+
+    std::cout << tracker->get_number_sensors() << (synthetic.sensors > 0 ? " synthetic" : "") << " sensors connected." << std::endl;
+    if (synthetic.sensors <= 0)
+    {
+        for (const SensorInfo& info : tracker->get_topology())
+        {
+            if (info.attached)
+            {
+                std::cout << "    port " << info.port << ": " << info.model << " " << info.part
+                          << " (serial " << info.serial << ")" << std::endl;
+            }
+        }
     }
+    tracker->set_topology_callback([](const SensorInfo& info) {
+        std::cout << "Sensor " << (info.attached ? "attached to" : "detached from")
+                  << " port " << info.port << "." << std::endl;
+    });
+    // seconds between frames
+    double period = 1.0 / tracker->get_rate();
+    auto next_refresh = std::chrono::steady_clock::now();
 
     signal(SIGINT, signal_handler);
 
+    if (realtime.lock_memory)
+    {
+        realtime.prefault_stack = 256 * 1024;
+    }
+    // sends wait for frames, they must not delay acquisition; memory is
+    // locked for the whole process by the acquisition thread
+    if (send_realtime.priority < 0)
+    {
+        send_realtime.priority = std::max(realtime.priority - 1, 0);
+    }
+    send_realtime.cpus = realtime.cpus;
+    send_realtime.prefault_stack = realtime.prefault_stack;
+    GapStats gaps(2.0 * period);
+    std::mutex gaps_mutex;
+
     // trakSTAR return values
-    double position[] = {0.0, 0.0, 0.0};
-    double quaternion[] = {0.0, 0.0, 0.0, 0.0};
-    double atcmatrix[3][3] = {
-        {0.0, 0.0, 0.0},
-        {0.0, 0.0, 0.0},
-        {0.0, 0.0, 0.0}};
+    std::vector<Sample> samples;
     float matrix[4][4];
-    double orientation[] = {0.0, 0.0, 0.0};
-    double quality = 0;
-    bool button = false;
-
-    // float igtmatrix[4][4];
-    // float tool[4][4];
-    // float reference[4][4];
-    // float tool2reference[4][4];
-    QuadMatrix<4> igtmatrix, tool, reference, tool2reference;
-    // igtl::TransformElement::Pointer transform_element_ptr;
-
-    bool connected = false;
-    running = true;
 
-    std::cout << "IGTLink Server running on port " << port << "." << std::endl;
+    Pose pose;
+    Resampler resampler;
+    std::vector<int> attached;
+    std::vector<int> scheduled;
+    std::vector<int> polled;
+    // time of the last record of every port, a sensor whose records keep
+    // getting lost for max_age is not streamed at its last pose
+    std::vector<double> last_record;
+    for (int sensor : ports)
+    {
+        last_record.resize(std::max<size_t>(last_record.size(), sensor + 1), 0.0);
+    }
+    double max_age = adaptive ? std::max(0.5, 3.0 / scheduling.min_rate) : 0.5;
+    PollScheduler scheduler(scheduling);
 
-    while (running)
+    PoseShmWriter shm;
+    if (!shm_name.empty())
+    {
+        shm.open(shm_name);
+        std::cout << "Publishing frames to shared memory " << shm_name << "." << std::endl;
+    }
+
+    UdpSender udp;
+    uint32_t udp_sequence = 0;
+    std::vector<unsigned char> datagram;
+    if (!udp_destination.empty())
     {
-        client_socket = server_socket->WaitForConnection(timeout);
+        size_t colon = udp_destination.rfind(':');
+        if (colon == std::string::npos)
+        {
+            std::cerr << "UDP destination must be host:port." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        udp.open(udp_destination.substr(0, colon), std::stoi(udp_destination.substr(colon + 1)), udp_ttl, udp_interface);
+        std::cout << "Sending frames to " << (udp.is_multicast() ? "multicast group " : "") << udp_destination << "." << std::endl;
+    }
+
+    // polls the sensors of the graph and evaluates it, returns the frame time
+    auto acquire_frame = [&]() {
+        graph.begin_frame();
+        polled.clear();
+        double frame_time = atc3dg_time();
 
-        if (!dry && !tracker.good())
+        if (std::chrono::steady_clock::now() >= next_refresh)
         {
-            std::cout << "Tracker disconnected." << std::endl;
-            running = false;
+            tracker->refresh_topology();
+            next_refresh = std::chrono::steady_clock::now() + std::chrono::seconds(1);
         }
 
-        while (running && client_socket.IsNotNull() && client_socket->GetConnected())
+        attached.clear();
+        for (int sensor : ports)
         {
-            if (!connected)
+            if (tracker->is_attached(sensor))
             {
-                std::cout << "Client connected." << std::endl;
-                connected = true;
+                attached.push_back(sensor);
             }
+            else
+            {
+                graph.clear_sensor(sensor);
+            }
+        }
+        if (adaptive)
+        {
+            // sensors left out keep their last pose in the graph
+            scheduler.next(attached, tracker->get_rate(), frame_time, scheduled);
+        }
+        const std::vector<int>& sensors = adaptive ? scheduled : attached;
+
+        double started = atc3dg_time();
+        // requests are pipelined, a lost record leaves the resampler with
+        // the previous pose of its sensor and skips the rest of the frame
+        tracker->poll_all(sensors, samples, SAMPLE_POSITION | SAMPLE_QUATERNION);
+        for (const Sample& sample : samples)
+        {
+            scheduler.update(sample);
+            last_record[sample.sensor] = sample.timestamp;
+            pose = Pose::from_sample(sample);
 
-            for (int sensor = 0; sensor < num_sensors; sensor++)
+            if (no_align)
             {
-                auto transform_message = igtl::TransformMessage::New();
+                graph.set_sensor(sample.sensor, pose);
+            }
+            else
+            {
+                resampler.push(sample.sensor, sample.timestamp, pose);
+                polled.push_back(sample.sensor);
+            }
+        }
 
-                std::string name;
-                switch (sensor)
+        scheduler.account(sensors.size(), atc3dg_time() - started);
+
+        if (!no_align && !polled.empty())
+        {
+            // sensors were sampled one after another, bring them to the
+            // time of the oldest newest sample before relating them
+            frame_time = resampler.common_timestamp(polled);
+            for (int sensor : polled)
+            {
+                if (resampler.sample(sensor, frame_time, pose))
                 {
-                case 0:
-                    name = "Reference";
-                    break;
-                case 1:
-                    name = "Tool";
-                    break;
-                default:
-                    name = "Unknown";
-                    break;
+                    graph.set_sensor(sensor, pose);
                 }
+            }
+        }
+
+        for (int sensor : attached)
+        {
+            if (atc3dg_time() - last_record[sensor] > max_age)
+            {
+                graph.clear_sensor(sensor);
+            }
+        }
+
+        // derived transforms are only recomputed if an input changed
+        graph.evaluate();
+        return frame_time;
+    };
+
+    // copies the transforms of the graph into a frame for shared memory
+    // and the clients
+    auto fill_frame = [&](PoseShmFrame& frame, double frame_time) {
+        frame.timestamp = frame_time;
+        frame.count = 0;
+        for (int n = 0; n < graph.size() && frame.count < POSE_SHM_MAX_TRANSFORMS; n++)
+        {
+            const TransformNode& node = graph.node(n);
+            PoseShmTransform& transform = frame.transforms[frame.count++];
+            strncpy(transform.name, node.name.c_str(), POSE_SHM_NAME_LENGTH - 1);
+            transform.name[POSE_SHM_NAME_LENGTH - 1] = '\0';
+            transform.valid = node.valid ? 1 : 0;
+            // poses become matrices only here, on their way out
+            node.value.to_matrix(transform.matrix);
+            for (int i = 0; i < 4; i++)
+            {
+                transform.quaternion[i] = node.value.q[i];
+            }
+        }
+    };
+
+    auto publish_frame = [&](double frame_time) {
+        if (!shm.is_open())
+        {
+            return;
+        }
+        fill_frame(shm.begin(), frame_time);
+        shm.publish();
+    };
+
+    // a datagram is one TDATA message, preceded by "ATCU" and a big-endian
+    // sequence number so receivers can drop stale or duplicate datagrams;
+    // frames with more transforms than fit into one are split
+    std::vector<int> udp_nodes;
+    auto send_udp = [&](double frame_time) {
+        if (!udp.is_open())
+        {
+            return;
+        }
+
+        udp_nodes.clear();
+        for (int n = 0; n < graph.size(); n++)
+        {
+            if (graph.node(n).valid)
+            {
+                udp_nodes.push_back(n);
+            }
+        }
+
+        size_t first = 0;
+        do
+        {
+            size_t last = std::min(udp_nodes.size(), first + UDP_TRANSFORMS);
+            auto tdata_message = igtl::TrackingDataMessage::New();
+            tdata_message->SetDeviceName("Tracker");
+            for (size_t i = first; i < last; i++)
+            {
+                const TransformNode& node = graph.node(udp_nodes[i]);
+                auto element = igtl::TrackingDataElement::New();
+                element->SetName(node.name.c_str());
+                element->SetType(igtl::TrackingDataElement::TYPE_6D);
+                node.value.to_matrix(matrix);
+                element->SetMatrix(matrix);
+                tdata_message->AddTrackingDataElement(element);
+            }
+            auto timestamp = igtl::TimeStamp::New();
+            timestamp->SetTime(atc3dg_wall_time(frame_time));
+            tdata_message->SetTimeStamp(timestamp);
+            tdata_message->Pack();
+
+            size_t size = tdata_message->GetPackSize();
+            datagram.resize(UDP_PREFIX_SIZE + size);
+            memcpy(datagram.data(), "ATCU", 4);
+            uint32_t sequence = udp_sequence++;
+            datagram[4] = sequence >> 24;
+            datagram[5] = sequence >> 16;
+            datagram[6] = sequence >> 8;
+            datagram[7] = sequence;
+            memcpy(datagram.data() + UDP_PREFIX_SIZE, tdata_message->GetPackPointer(), size);
+            udp.send(datagram.data(), datagram.size());
+            first = last;
+        } while (first < udp_nodes.size());
+    };
+
+    // reopens the tracker after a USB failure, returns false when interrupted
+    auto recover_tracker = [&](const std::string& reason) {
+        std::cout << "Tracker connection lost (" << reason << "), recovering..." << std::endl;
+        while (running && !tracker->recover(1000))
+        {
+        }
+        if (!tracker->good())
+        {
+            return false;
+        }
+        ATC3DGStats stats = tracker->get_stats();
+        std::cout << "Tracker recovered after " << (int)(stats.last_outage * 1000) << " ms ("
+                  << stats.recoveries << " recoveries, " << (int)(stats.total_outage * 1000) << " ms total outage)." << std::endl;
+        return true;
+    };
+
+    // acquires a frame, recovering the tracker if necessary, returns false
+    // if there is no frame to send
+    double frame_time = 0;
+    auto next_frame = [&]() {
+        try
+        {
+            if (!tracker->good())
+            {
+                recover_tracker("tracker not good");
+                return false;
+            }
+            frame_time = acquire_frame();
+        }
+        catch (const std::exception& e)
+        {
+            recover_tracker(e.what());
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(gaps_mutex);
+            gaps.add(atc3dg_time());
+        }
+        publish_frame(frame_time);
+        send_udp(frame_time);
+        return true;
+    };
+
+    std::mutex clients_mutex;
+    std::vector<std::shared_ptr<Client>> clients;
+    running = true;
 
-                transform_message->SetDeviceName(name.c_str());
+    // cost of acquiring and distributing a frame, to find the throughput
+    // ceiling for a number of sensors
+    uint64_t costed_frames = 0;
+    double total_cost = 0;
+    double max_cost = 0;
+    uint64_t overruns = 0;
+
+    // samples at the tracker rate whatever the clients do
+    std::thread acquisition([&]() {
+        std::vector<std::string> realtime_errors = apply_realtime(realtime);
+        for (const auto& error : realtime_errors)
+        {
+            std::cerr << "Real-time setup: " << error << std::endl;
+        }
+        if (realtime_errors.empty() && (realtime.priority > 0 || !realtime.cpus.empty() || realtime.lock_memory))
+        {
+            std::cout << "Real-time options applied." << std::endl;
+        }
 
-                if (!dry)
+        // frames are reused once no client queue holds them any more, so
+        // the loop does not allocate ~60 KB per frame
+        std::vector<std::shared_ptr<PoseShmFrame>> frame_pool;
+        auto free_frame = [&frame_pool]() {
+            for (auto& frame : frame_pool)
+            {
+                if (frame.use_count() == 1)
                 {
-                    tracker.update(sensor, position, orientation, atcmatrix, quaternion, &quality, &button);
+                    // the last reader released it before
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    return frame;
                 }
-
-                for (int j = 0; j < 3; j++)
+            }
+            frame_pool.emplace_back(new PoseShmFrame);
+            return frame_pool.back();
+        };
+
+        uint64_t frame_number = 0;
+        auto step = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(period));
+        auto next = std::chrono::steady_clock::now();
+        while (running)
+        {
+            double start = atc3dg_time();
+            if (next_frame())
+            {
+                // one copy for all clients, transforms beyond count are stale
+                std::shared_ptr<PoseShmFrame> frame = free_frame();
+                fill_frame(*frame, frame_time);
+                frame->frame = frame_number++;
                 {
-                    for (int i = 0; i < 3; i++)
+                    std::lock_guard<std::mutex> lock(clients_mutex);
+                    for (auto& client : clients)
                     {
-                        if (sensor == 0)
-                        {
-                            reference.set(i, j, static_cast<float>(atcmatrix[i][j]));
-                        }
-                        if (sensor == 1)
-                        {
-                            tool.set(i, j, static_cast<float>(atcmatrix[i][j]));
-                        }
-                        igtmatrix.set(i, j, static_cast<float>(atcmatrix[i][j]));
+                        client->deliver(frame);
                     }
                 }
+                double cost = atc3dg_time() - start;
+                costed_frames++;
+                total_cost += cost;
+                max_cost = std::max(max_cost, cost);
+            }
 
-                if (sensor == 0)
-                {
-                    reference.set(0, 3, position[0]);
-                    reference.set(1, 3, position[1]);
-                    reference.set(2, 3, position[2]);
-                }
-                else if (sensor == 1)
+            next += step;
+            auto now = std::chrono::steady_clock::now();
+            if (next < now)
+            {
+                overruns++;
+                next = now;
+            }
+            std::this_thread::sleep_until(next);
+        }
+    });
+
+    // joins the sender threads of clients that went away, or of all clients
+    auto remove_clients = [&](bool all) {
+        std::vector<std::shared_ptr<Client>> removed;
+        {
+            std::lock_guard<std::mutex> lock(clients_mutex);
+            for (auto it = clients.begin(); it != clients.end();)
+            {
+                if (all || !(*it)->connected)
                 {
-                    tool.set(0, 3, position[0]);
-                    tool.set(1, 3, position[1]);
-                    tool.set(2, 3, position[2]);
+                    removed.push_back(*it);
+                    it = clients.erase(it);
                 }
-
-                igtmatrix.set(0, 3, position[0]);
-                igtmatrix.set(1, 3, position[1]);
-                igtmatrix.set(2, 3, position[2]);
-
-                igtmatrix.toArray(matrix);
-                transform_message->SetMatrix(matrix);
-                transform_message->Pack();
-
-                if (!client_socket->Send(transform_message->GetPackPointer(), transform_message->GetPackSize()))
+                else
                 {
-                    break;
+                    ++it;
                 }
             }
+        }
+        for (auto& client : removed)
+        {
+            client->stop();
+            std::cout << "Client disconnected: " << client->sent << " frames sent, " << client->queue.dropped()
+                      << " dropped, backlog up to " << client->max_backlog << " frames." << std::endl;
+            std::lock_guard<std::mutex> lock(gaps_mutex);
+            std::cout << "Frame gaps: " << gaps.summary() << std::endl;
+        }
+    };
 
-            // compute ToolToReference transform
+    std::cout << "IGTLink Server running on port " << port << "." << std::endl;
 
-            QuadMatrix<4> toolToReference = reference.inverse().multiply(tool);
+    while (running)
+    {
+        auto client_socket = server_socket->WaitForConnection(timeout);
+        if (running && client_socket.IsNotNull() && client_socket->GetConnected())
+        {
+            auto client = std::make_shared<Client>(client_socket, backlog, period);
+            client->sender = std::thread(send_frames, std::ref(*client), std::cref(send_realtime));
+            client->receiver = std::thread(receive_requests, std::ref(*client), std::cref(transform_names));
+            std::lock_guard<std::mutex> lock(clients_mutex);
+            clients.push_back(client);
+            std::cout << "Client connected (" << clients.size() << " connected)." << std::endl;
+        }
+        remove_clients(false);
+    }
 
-            auto transform_message = igtl::TransformMessage::New();
-            transform_message->SetDeviceName("ToolToReference");
-            toolToReference.toArray(matrix);
-            transform_message->SetMatrix(matrix);
-            transform_message->Pack();
-            if (!client_socket->Send(transform_message->GetPackPointer(), transform_message->GetPackSize()))
-            {
-                // ...
-            }
+    acquisition.join();
+    remove_clients(true);
 
-            igtl::Sleep(interval);
-        }
+    std::cout << "Frame gaps: " << gaps.summary() << std::endl;
+    if (costed_frames > 0)
+    {
+        std::cout << "Frame cost: " << (int)(total_cost / costed_frames * 1e6) << " us mean, " << (int)(max_cost * 1e6)
+                  << " us max for " << graph.size() << " transforms, " << overruns << " overruns." << std::endl;
+    }
 
-        if (connected)
+    if (adaptive)
+    {
+        for (const SensorSchedule& entry : scheduler.get_schedule())
         {
-            std::cout << "Client disconnected." << std::endl;
+            std::cout << "Sensor " << entry.sensor << ": " << (int)entry.rate << " Hz allotted, " << entry.polls
+                      << " polls, moving " << (int)entry.motion << " mm/s." << std::endl;
         }
-        connected = false;
     }
 
-    if (client_socket.IsNotNull())
+    if (udp.is_open())
     {
-        client_socket->CloseSocket();
+        std::cout << udp.sent() << " UDP datagrams sent, " << udp.dropped() << " dropped." << std::endl;
     }
 
-    if (!dry)
+    if (tracker->good())
     {
-        tracker.disconnect();
+        tracker->disconnect();
     }
 }
@@ -0,0 +1,383 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "atc3dg.hpp"
+
+#include "igtlClientSocket.h"
+#include "igtlMessageHeader.h"
+#include "igtlQuaternionTrackingDataMessage.h"
+#include "igtlTimeStamp.h"
+#include "igtlTrackingDataMessage.h"
+#include "igtlTransformMessage.h"
+
+#include "CLI/App.hpp"
+#include "CLI/Formatter.hpp"
+#include "CLI/Config.hpp"
+
+static std::atomic<bool> running;
+
+
+void signal_handler(int signum)
+{
+    if (signum == SIGINT)
+    {
+        running = false;
+    }
+}
+
+// what one connection received; frames are told apart by the timestamps
+// the server embeds, all messages of a frame carry the same one
+struct LoadClient {
+    int index = 0;
+    bool connected = false;
+    std::string error;
+    uint64_t messages = 0;
+    uint64_t elements = 0;
+    uint64_t bytes = 0;
+    uint64_t out_of_order = 0;
+    double last_timestamp = 0;
+    // per frame: server timestamp, arrival time and latency, seconds
+    std::vector<double> timestamps;
+    std::vector<double> arrivals;
+    std::vector<double> latencies;
+};
+
+struct LoadStats {
+    uint64_t frames = 0;
+    double rate = 0;
+    // standard deviation of the intervals between arrivals
+    double jitter = 0;
+    double max_interval = 0;
+    double latency_p50 = 0;
+    double latency_p95 = 0;
+    double latency_p99 = 0;
+    double latency_max = 0;
+    // frames missing from the timestamp sequence
+    uint64_t dropped = 0;
+};
+
+double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    size_t index = (size_t)std::ceil(p * sorted.size());
+    return sorted[std::min(sorted.size() - 1, index > 0 ? index - 1 : 0)];
+}
+
+LoadStats summarize(const LoadClient &client)
+{
+    LoadStats stats;
+    stats.frames = client.timestamps.size();
+    if (stats.frames > 1)
+    {
+        double duration = client.arrivals.back() - client.arrivals.front();
+        stats.rate = duration > 0 ? (stats.frames - 1) / duration : 0;
+
+        double sum = 0;
+        double sum_squares = 0;
+        std::vector<double> periods;
+        for (size_t i = 1; i < stats.frames; i++)
+        {
+            double interval = client.arrivals[i] - client.arrivals[i - 1];
+            sum += interval;
+            sum_squares += interval * interval;
+            stats.max_interval = std::max(stats.max_interval, interval);
+            periods.push_back(client.timestamps[i] - client.timestamps[i - 1]);
+        }
+        double mean = sum / (stats.frames - 1);
+        stats.jitter = std::sqrt(std::max(0.0, sum_squares / (stats.frames - 1) - mean * mean));
+
+        // the median timestamp step is the period the client was served at,
+        // longer steps stand for the frames that did not arrive
+        std::nth_element(periods.begin(), periods.begin() + periods.size() / 2, periods.end());
+        double period = periods[periods.size() / 2];
+        for (size_t i = 1; period > 0 && i < stats.frames; i++)
+        {
+            double step = client.timestamps[i] - client.timestamps[i - 1];
+            if (step > 1.5 * period)
+            {
+                stats.dropped += (uint64_t)std::llround(step / period) - 1;
+            }
+        }
+    }
+
+    std::vector<double> latencies = client.latencies;
+    std::sort(latencies.begin(), latencies.end());
+    stats.latency_p50 = percentile(latencies, 0.50);
+    stats.latency_p95 = percentile(latencies, 0.95);
+    stats.latency_p99 = percentile(latencies, 0.99);
+    stats.latency_max = latencies.empty() ? 0 : latencies.back();
+    return stats;
+}
+
+// receives the body of a message into a new message of type T
+template <typename T>
+typename T::Pointer receive_body(igtl::Socket::Pointer socket, igtl::MessageHeader::Pointer header, bool &ok)
+{
+    auto message = T::New();
+    message->SetMessageHeader(header);
+    message->AllocatePack();
+    bool timeout = false;
+    igtlUint64 size = socket->Receive(message->GetPackBodyPointer(), message->GetPackBodySize(), timeout);
+    ok = size == (igtlUint64)message->GetPackBodySize();
+    if (ok)
+    {
+        message->Unpack(1);
+    }
+    return message;
+}
+
+bool request_stream(igtl::Socket::Pointer socket, const std::string &mode, int resolution, const std::string &tools)
+{
+    if (mode == "tdata")
+    {
+        auto start = igtl::StartTrackingDataMessage::New();
+        start->SetDeviceName(tools.c_str());
+        start->SetResolution(resolution);
+        start->Pack();
+        return socket->Send(start->GetPackPointer(), start->GetPackSize());
+    }
+    if (mode == "qtdata")
+    {
+        auto start = igtl::StartQuaternionTrackingDataMessage::New();
+        start->SetDeviceName(tools.c_str());
+        start->SetResolution(resolution);
+        start->Pack();
+        return socket->Send(start->GetPackPointer(), start->GetPackSize());
+    }
+    // TRANSFORM messages are sent without a request
+    return true;
+}
+
+void run_client(LoadClient &client, const std::string &host, int port, const std::string &mode, int resolution,
+                const std::string &tools, double end)
+{
+    auto socket = igtl::ClientSocket::New();
+    if (socket->ConnectToServer(host.c_str(), port) != 0)
+    {
+        client.error = "cannot connect";
+        return;
+    }
+    client.connected = true;
+    // wake up regularly to notice the end of the test
+    socket->SetReceiveTimeout(200);
+    if (!request_stream(socket, mode, resolution, tools))
+    {
+        client.error = "request failed";
+        socket->CloseSocket();
+        return;
+    }
+
+    auto header = igtl::MessageHeader::New();
+    auto timestamp = igtl::TimeStamp::New();
+    igtl::Matrix4x4 matrix;
+    float position[3];
+    float quaternion[4];
+
+    while (running && atc3dg_time() < end)
+    {
+        header->InitPack();
+        bool timeout = false;
+        igtlUint64 size = socket->Receive(header->GetPackPointer(), header->GetPackSize(), timeout);
+        if (timeout && size == 0)
+        {
+            continue;
+        }
+        if (size != (igtlUint64)header->GetPackSize())
+        {
+            client.error = "connection closed";
+            break;
+        }
+        header->Unpack();
+        header->GetTimeStamp(timestamp);
+
+        // parse what a real client would parse
+        std::string type = header->GetDeviceType();
+        bool ok = true;
+        bool frame = true;
+        if (type == "TRANSFORM")
+        {
+            auto message = receive_body<igtl::TransformMessage>(socket, header, ok);
+            message->GetMatrix(matrix);
+            client.elements++;
+        }
+        else if (type == "TDATA")
+        {
+            auto message = receive_body<igtl::TrackingDataMessage>(socket, header, ok);
+            int count = message->GetNumberOfTrackingDataElements();
+            for (int i = 0; i < count && ok; i++)
+            {
+                igtl::TrackingDataElement::Pointer element;
+                message->GetTrackingDataElement(i, element);
+                element->GetMatrix(matrix);
+            }
+            client.elements += count;
+        }
+        else if (type == "QTDATA")
+        {
+            auto message = receive_body<igtl::QuaternionTrackingDataMessage>(socket, header, ok);
+            int count = message->GetNumberOfQuaternionTrackingDataElements();
+            for (int i = 0; i < count && ok; i++)
+            {
+                igtl::QuaternionTrackingDataElement::Pointer element;
+                message->GetQuaternionTrackingDataElement(i, element);
+                element->GetPosition(position);
+                element->GetQuaternion(quaternion);
+            }
+            client.elements += count;
+        }
+        else
+        {
+            // acknowledgements and anything else
+            socket->Skip(header->GetBodySizeToRead(), 0);
+            frame = false;
+        }
+        if (!ok)
+        {
+            client.error = "connection closed";
+            break;
+        }
+
+        // frame timestamps are seconds since the epoch
+        double arrival = atc3dg_wall_time(atc3dg_time());
+        client.messages++;
+        client.bytes += header->GetPackSize() + header->GetBodySizeToRead();
+        if (!frame)
+        {
+            continue;
+        }
+
+        double time = timestamp->GetTimeStamp();
+        if (time < client.last_timestamp)
+        {
+            client.out_of_order++;
+        }
+        else if (time > client.last_timestamp)
+        {
+            client.last_timestamp = time;
+            client.timestamps.push_back(time);
+            client.arrivals.push_back(arrival);
+            client.latencies.push_back(arrival - time);
+        }
+    }
+
+    socket->CloseSocket();
+}
+
+int main(int argc, char *argv[])
+{
+    std::string host = "127.0.0.1";
+    int port = 18944;
+    int clients = 1;
+    double duration = 10;
+    std::string mode = "transform";
+    int resolution = 0;
+    std::string tools;
+    std::string output;
+
+    CLI::App app{"trakSTAR IGTLink load test"};
+    app.add_option("-H,--host", host, "Server host");
+    app.add_option("-p,--port", port, "Server port");
+    app.add_option("-n,--clients", clients, "Concurrent connections");
+    app.add_option("-d,--duration", duration, "Seconds to receive");
+    app.add_option("-m,--mode", mode, "Stream to request: transform, tdata or qtdata")
+        ->check(CLI::IsMember({"transform", "tdata", "qtdata"}));
+    app.add_option("-r,--resolution", resolution, "Milliseconds between frames requested with tdata and qtdata, 0 for all");
+    app.add_option("--tools", tools, "Comma-separated transforms requested with tdata and qtdata, all if empty");
+    app.add_option("-o,--output", output, "Also write one CSV row per client to this file");
+    CLI11_PARSE(app, argc, argv);
+
+    signal(SIGINT, signal_handler);
+    running = true;
+
+    std::vector<LoadClient> loads(std::max(1, clients));
+    std::vector<std::thread> threads;
+    double end = atc3dg_time() + duration;
+    for (size_t i = 0; i < loads.size(); i++)
+    {
+        loads[i].index = i;
+        threads.emplace_back(run_client, std::ref(loads[i]), host, port, mode, resolution, tools, end);
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    // latencies are only meaningful if both hosts share a synchronized clock
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "client  frames    rate(Hz)  jitter(ms)  max gap(ms)  latency p50/p95/p99/max(ms)     dropped  reordered" << std::endl;
+
+    std::ofstream csv;
+    if (!output.empty())
+    {
+        csv.open(output);
+        if (!csv)
+        {
+            std::cerr << "Could not write " << output << std::endl;
+            return 1;
+        }
+        csv << "client,frames,messages,elements,bytes,rate,jitter_ms,max_interval_ms,latency_p50_ms,latency_p95_ms,"
+               "latency_p99_ms,latency_max_ms,dropped,out_of_order,error" << std::endl;
+    }
+
+    LoadClient all;
+    uint64_t frames = 0;
+    uint64_t dropped = 0;
+    uint64_t out_of_order = 0;
+    double rate = 0;
+    int failed = 0;
+    for (const auto &load : loads)
+    {
+        LoadStats stats = summarize(load);
+        std::cout << std::setw(6) << load.index << std::setw(8) << stats.frames << std::setw(12) << stats.rate
+                  << std::setw(12) << stats.jitter * 1e3 << std::setw(13) << stats.max_interval * 1e3 << "  "
+                  << stats.latency_p50 * 1e3 << "/" << stats.latency_p95 * 1e3 << "/" << stats.latency_p99 * 1e3
+                  << "/" << stats.latency_max * 1e3 << std::setw(12) << stats.dropped << std::setw(11)
+                  << load.out_of_order;
+        if (!load.error.empty())
+        {
+            std::cout << "  (" << load.error << ")";
+        }
+        std::cout << std::endl;
+
+        if (csv.is_open())
+        {
+            csv << load.index << "," << stats.frames << "," << load.messages << "," << load.elements << ","
+                << load.bytes << "," << stats.rate << "," << stats.jitter * 1e3 << "," << stats.max_interval * 1e3
+                << "," << stats.latency_p50 * 1e3 << "," << stats.latency_p95 * 1e3 << "," << stats.latency_p99 * 1e3
+                << "," << stats.latency_max * 1e3 << "," << stats.dropped << "," << load.out_of_order << ","
+                << load.error << std::endl;
+        }
+
+        all.latencies.insert(all.latencies.end(), load.latencies.begin(), load.latencies.end());
+        frames += stats.frames;
+        dropped += stats.dropped;
+        out_of_order += load.out_of_order;
+        rate += stats.rate;
+        failed += load.connected ? 0 : 1;
+    }
+
+    LoadStats total = summarize(all);
+    std::cout << "total " << std::setw(8) << frames << std::setw(12) << rate << std::setw(25) << "" << "  "
+              << total.latency_p50 * 1e3 << "/" << total.latency_p95 * 1e3 << "/" << total.latency_p99 * 1e3 << "/"
+              << total.latency_max * 1e3 << std::setw(12) << dropped << std::setw(11) << out_of_order << std::endl;
+
+    if (failed > 0)
+    {
+        std::cerr << failed << " of " << loads.size() << " clients could not connect." << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,31 +1,103 @@
 #include <iostream>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <memory>
+#include <thread>
 
 #include "atc3dg.hpp"
+#include "atc3dg_client.hpp"
+#include "pose_log.hpp"
+#include "recording.hpp"
+
+#include "CLI/App.hpp"
+#include "CLI/Formatter.hpp"
+#include "CLI/Config.hpp"
+
+static std::atomic<bool> running;
+
+void signal_handler(int signum)
+{
+    if (signum == SIGINT)
+    {
+        running = false;
+    }
+}
 
 int main(int argc, char *argv[])
 {
-    ATC3DGTracker tracker;
+    std::string output;
+    int samples = 10;
+    bool compress = false;
+    std::string daemon;
 
-    double x, y, z;
-    double ax, ay, az;
-    double matrix[3][3];
-    double q0, qi, qj, qk;
-    double quality;
-    bool button;
+    CLI::App app{"trakSTAR recorder"};
+    app.add_option("-o,--output", output, "Capture file (prints samples if omitted)");
+    app.add_option("-n,--samples", samples, "Samples per sensor, 0 records until interrupted");
+    app.add_flag("-z,--compress", compress, "Write a compressed pose log instead of a raw capture");
+    app.add_option("--daemon", daemon, "Attach to the tracker daemon at this shared memory object, e.g. " TRACKER_SHM_NAME);
+    CLI11_PARSE(app, argc, argv);
 
-    int sensors = tracker.get_number_sensors();
+    std::unique_ptr<ATC3DGTracker> tracker;
+    if (!daemon.empty())
+    {
+        tracker.reset(new ATC3DGClient(daemon));
+    }
+    else
+    {
+        tracker.reset(new ATC3DGTracker());
+    }
+    RecordingWriter writer;
+    PoseLogWriter log;
+    if (!output.empty() && compress)
+    {
+        log.open(output);
+    }
+    else if (!output.empty())
+    {
+        writer.open(output);
+    }
 
-    tracker.connect();
+    tracker->connect();
 
-    for (int s = 0; s < sensors; s++)
-    {
-        for (int i = 0; i < 10; ++i)
+    int sensors = tracker->get_number_sensors();
+
+    std::atomic<long> recorded(0);
+    tracker->subscribe([&](const Sample &sample) {
+        if (!output.empty() && compress)
+        {
+            log.write(sample);
+        }
+        else if (!output.empty())
+        {
+            writer.write(sample);
+        }
+        else
         {
-            tracker.update(s, x, y, z, ax, ay, az, matrix, q0, qi, qj, qk, quality, button);
-            std::cout << x << " " << y << " " << z << " " << ax << " " << ay << " " << az << " " << button << std::endl;
+            std::cout << sample.sensor << " "
+                      << sample.position[0] << " " << sample.position[1] << " " << sample.position[2] << " "
+                      << sample.angles[0] << " " << sample.angles[1] << " " << sample.angles[2] << " "
+                      << sample.button << std::endl;
         }
+        recorded++;
+    });
+
+    running = true;
+    signal(SIGINT, signal_handler);
+    tracker->start();
+
+    long total = (long)samples * sensors;
+    while (running && tracker->acquiring() && (samples == 0 || recorded < total))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
-    tracker.disconnect();
+
+    tracker->stop();
+    tracker->disconnect();
+    writer.close();
+    log.close();
+
+    std::cout << recorded << " samples recorded." << std::endl;
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+/**
+ * analysis.hpp
+ *
+ * Summaries of recorded sessions: achieved rate, timing jitter, gaps,
+ * button presses and the distribution of the quality value, per sensor.
+ * Reads raw captures (recording.hpp) and compressed pose logs
+ * (pose_log.hpp).
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "sample.hpp"
+
+
+struct SensorSummary {
+	int sensor;
+	uint64_t samples;
+	// seconds between the first and the last sample
+	double duration;
+	// samples per second
+	double rate;
+	// intervals between consecutive samples, seconds
+	double mean_interval;
+	double median_interval;
+	double jitter;
+	double max_interval;
+	// intervals longer than the gap factor times the median interval
+	uint64_t gaps;
+	// seconds lost in gaps, beyond the median interval
+	double gap_time;
+	uint64_t button_presses;
+	// over samples that carry the quality field
+	uint64_t quality_samples;
+	double quality_min;
+	double quality_mean;
+	double quality_p50;
+	double quality_p95;
+	double quality_max;
+};
+
+struct SessionSummary {
+	std::string file;
+	// "raw", "pose log", or empty if the file could not be read
+	std::string format;
+	std::string error;
+	uint64_t samples;
+	// first timestamp, seconds since the epoch for captures
+	double start;
+	double duration;
+	std::vector<SensorSummary> sensors;
+};
+
+/**
+ * \param samples samples of one session in timestamp order
+ * \param gap_factor intervals longer than this times the median interval
+ * of a sensor count as gaps
+ */
+SessionSummary summarize_samples(const std::vector<Sample>& samples, double gap_factor = 2.0);
+
+/**
+ * Reads all samples of a raw capture or a pose log, told apart by their
+ * magic number. Throws std::runtime_error if the file cannot be read.
+ * \param threads threads to decode a pose log with, 0 for one per core
+ * \param clock_offset if not null, set to the clock offset of the capture
+ * (see RecordingReader::clock_offset())
+ * \return "raw" or "pose log"
+ */
+std::string read_capture(const std::string& filename, std::vector<Sample>& samples, int threads = 0, double* clock_offset = nullptr);
+
+/**
+ * Reads and summarizes a capture. Errors are reported in the error field
+ * of the summary instead of being thrown.
+ */
+SessionSummary summarize_file(const std::string& filename, double gap_factor = 2.0);
+
+/** one JSON document with all sessions */
+std::string sessions_to_json(const std::vector<SessionSummary>& sessions);
+/** one CSV row per sensor and session */
+std::string sessions_to_csv(const std::vector<SessionSummary>& sessions);
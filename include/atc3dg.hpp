@@ -17,9 +17,22 @@
 #include <string.h>
 #include <usb.h>
 
+#include <atomic>
 #include <exception>
+#include <functional>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
+#include "poll_scheduler.hpp"
+#include "raw_history.hpp"
+#include "realtime.hpp"
+#include "sample.hpp"
+#include "sample_ring.hpp"
+
 #define BUF_SIZE 64
 
 #define VENDOR_TRAKSTAR2G 0x04b4
@@ -27,7 +40,20 @@
 
 #define ENDPOINT_OUT 0x02
 #define ENDPOINT_IN 0x86
+// default budget of one transaction in milliseconds
 #define USB_TIMEOUT 500
+// zero-length transfers retried within a transaction
+#define ATC_MAX_RETRIES 3
+// consecutive failed transactions that take the tracker offline
+#define ATC_MAX_FAILURES 3
+// packets discarded at most when draining stale data
+#define ATC_MAX_DRAIN 8
+// POINT requests in flight by default, see set_pipeline_depth()
+#define ATC_PIPELINE_DEPTH 2
+// parameter reads in flight in a ParameterBatch
+#define ATC_BATCH_DEPTH 8
+
+#define ATC_MAX_SENSORS 4
 
 
 // system commands
@@ -128,6 +154,151 @@ enum ATC3DGParameters {
 };
 
 
+// components that report model and part number strings
+enum ATC3DGComponent {
+	ATC_COMPONENT_PCB =			0x00,
+	ATC_COMPONENT_RX =			0x01,
+	ATC_COMPONENT_TX =			0x02
+};
+
+/**
+ * Bytes of the EXAMINE response of a parameter as this driver reads them,
+ * and for the others as in the Flock of Birds protocol the unit inherits.
+ * \return 0 if unknown
+ */
+int atc3dg_parameter_size(int parameter);
+
+
+/**
+ * Monotonic time in seconds, the time base of all tracker timestamps. It is
+ * not affected by NTP steps or changes of the system clock, so intervals
+ * never go negative. The same for all processes of a host.
+ */
+double atc3dg_time();
+/**
+ * Seconds since the epoch at an atc3dg_time(), for timestamps that leave
+ * the host. The offset between the clocks is taken once per process, so
+ * converted times keep their order.
+ */
+double atc3dg_wall_time(double time);
+
+
+enum ATC3DGErrorKind {
+	// no data within the transaction budget
+	ATC_ERROR_TIMEOUT,
+	// endpoint halted, it is cleared before the error is thrown
+	ATC_ERROR_STALL,
+	// device gone, only recover() brings it back
+	ATC_ERROR_DISCONNECT,
+	// short or misaligned records
+	ATC_ERROR_PROTOCOL
+};
+
+/** Failed USB transaction. */
+class ATC3DGError : public std::runtime_error {
+public:
+	ATC3DGError(ATC3DGErrorKind kind, const std::string& message) : std::runtime_error(message), m_kind(kind) {}
+	ATC3DGErrorKind kind() const { return m_kind; }
+
+private:
+	ATC3DGErrorKind m_kind;
+};
+
+
+typedef std::function<void(const Sample&)> SampleCallback;
+
+// sensor attached to one of the receiver ports
+struct SensorInfo {
+	int port;
+	bool attached;
+	int serial;
+	std::string model;
+	std::string part;
+};
+
+typedef std::function<void(const SensorInfo&)> TopologyCallback;
+
+struct ATC3DGStats {
+	// USB failures that took the tracker offline
+	uint64_t failures;
+	uint64_t recoveries;
+	// recoveries that needed the full initialization sequence
+	uint64_t reinitializations;
+	// durations in seconds
+	double last_outage;
+	double max_outage;
+	double total_outage;
+	// failed transactions by kind
+	uint64_t timeouts;
+	uint64_t stalls;
+	uint64_t protocol_errors;
+	// records realigned on the phasing bit
+	uint64_t resyncs;
+	// records lost by poll() or poll_all() while the tracker stayed
+	// connected
+	uint64_t dropped_records;
+};
+
+
+/** value read by one EXAMINE (or string) of a ParameterBatch */
+struct ParameterValue {
+	// false until all of the response has been read
+	bool ok = false;
+	std::vector<unsigned char> bytes;
+
+	/** little-endian 16 bit word */
+	int word(int index = 0) const;
+	/** word as fixed point with 8 fraction bits, e.g. the rate in Hz */
+	double fixed(int index = 0) const;
+	/** printable characters, e.g. of an identification string */
+	std::string text() const;
+};
+
+/**
+ * EXAMINE and CHANGE operations that ATC3DGTracker::execute() sends in
+ * order as one pipelined batch: requests go out while earlier responses
+ * are still on their way, and CHANGEs do not wait at all. Every read
+ * returns the index of its value.
+ */
+class ParameterBatch {
+public:
+	/**
+	 * \param unit 0xF1 + unit addresses the request, i.e. 0 for the system
+	 * and the port for a receiver; -1 sends no address
+	 * \param size bytes of the response, atc3dg_parameter_size() if 0
+	 */
+	size_t examine(int parameter, int unit = 0, int size = 0);
+	void change(int parameter, const std::vector<int>& value, int unit = 0);
+	/** 16 bit little-endian value */
+	void change_word(int parameter, int value, int unit = 0);
+	/** \param port of the receiver, ignored for other components */
+	size_t model_string(ATC3DGComponent component, int port = 0);
+	size_t part_number(ATC3DGComponent component, int port = 0);
+
+	size_t size() const;
+	const ParameterValue& operator[](size_t index) const;
+	void clear();
+
+private:
+	friend class ATC3DGTracker;
+
+	struct Operation {
+		std::vector<int> request;
+		// bytes of the response, 0 for none
+		int response;
+		// value the response is appended to
+		size_t value;
+		// last response of the value
+		bool last;
+	};
+
+	size_t p_string(ATC3DGComponent component, int port, int offset, int length);
+
+	std::vector<Operation> m_operations;
+	std::vector<ParameterValue> m_values;
+};
+
+
 class ATC3DGTracker {
 public:
 	ATC3DGTracker();
@@ -154,8 +325,66 @@ public:
 		bool* button
 	);
 	virtual void disconnect();
+
+	/**
+	 * Brings the tracker back after a USB failure. The device is reopened
+	 * and, if the unit stayed powered, only the cached configuration is
+	 * re-applied; the full initialization sequence is only run if the unit
+	 * was unplugged or does not respond.
+	 * \param timeout milliseconds to wait for the device to reappear
+	 * \return true if the tracker is good again
+	 */
+	virtual bool recover(int timeout = 5000);
+	/** let the acquisition thread recover() on USB failures (default) */
+	void set_auto_recover(bool enabled);
+	ATC3DGStats get_stats() const;
+
+	/**
+	 * Upper bound of one transaction, i.e. a request and its response,
+	 * including retries. Failed transactions throw ATC3DGError; after
+	 * ATC_MAX_FAILURES of them in a row, or when the device is gone, the
+	 * tracker goes offline.
+	 * \param milliseconds budget, USB_TIMEOUT by default
+	 */
+	void set_transaction_budget(int milliseconds);
+	int get_transaction_budget() const;
+
+	/**
+	 * Number of POINT requests poll_all() keeps in flight. The request for
+	 * the next sensor goes out before the record of the current one is
+	 * read, so a frame takes about one response time plus the transfers
+	 * instead of one round trip per sensor. 1 polls strictly one after
+	 * another.
+	 * \param depth ATC_PIPELINE_DEPTH by default, at most ATC_MAX_SENSORS
+	 */
+	void set_pipeline_depth(int depth);
+	int get_pipeline_depth() const;
 	
+	/**
+	 * Executes the operations of a batch in order, with up to
+	 * ATC_BATCH_DEPTH reads in flight (one if the pipeline depth is 1).
+	 * Throws ATC3DGError if a transaction fails; values read until then
+	 * are ok.
+	 */
+	void execute(ParameterBatch& batch);
+	/** reads one parameter, see ParameterBatch::examine() */
+	ParameterValue examine(int parameter, int unit = 0, int size = 0);
+
+	/**
+	 * Number of attached sensors. The topology is discovered while
+	 * connecting and cached, this does not talk to the tracker.
+	 */
 	virtual int get_number_sensors();
+	virtual std::vector<SensorInfo> get_topology() const;
+	virtual bool is_attached(int port) const;
+	/**
+	 * Checks the tracker status for plugged or unplugged sensors, one round
+	 * trip if nothing changed. Changed ports are probed again and reported
+	 * to the topology callback.
+	 * \return true if the topology changed
+	 */
+	virtual bool refresh_topology();
+	void set_topology_callback(TopologyCallback callback);
 	
 	virtual void set_rate(double rate);
 	virtual double get_rate() const;
@@ -164,10 +393,129 @@ public:
 	
 	virtual bool good() const;
 
+	/**
+	 * Time (see atc3dg_time()) at which the record of the most recent
+	 * update() arrived.
+	 */
+	double get_timestamp() const;
+
+	/**
+	 * Requests and decodes one record of a sensor. Only the requested
+	 * fields are decoded. A failed transaction only costs this record,
+	 * stale data is drained before the next request.
+	 * \return false if the tracker is not connected (see good()) or the
+	 * record was lost
+	 */
+	virtual bool poll(int sensor, Sample& sample, unsigned fields = SAMPLE_ALL);
+
+	/**
+	 * Polls several sensors with pipelined requests (see
+	 * set_pipeline_depth()). Responses arrive in request order and are
+	 * matched to the addresses of the outstanding requests.
+	 * \param samples receives one sample per record, in the order of
+	 * sensors; after a lost record, the rest of the list is skipped
+	 * \return number of samples
+	 */
+	virtual size_t poll_all(const std::vector<int>& sensors, std::vector<Sample>& samples, unsigned fields = SAMPLE_ALL);
+
+	/**
+	 * Polls every sensor in sensors n times, paced by the tracker rate, and
+	 * writes the samples into the caller's arrays. Row i * n_sensors + k
+	 * holds sample i of sensors[k], i.e. arrays are shaped
+	 * [n][n_sensors][...].
+	 * \return number of rows written, less than n * n_sensors if the
+	 * tracker is not connected or goes offline. Lost records are requested
+	 * again for up to the transaction budget, after that the batch ends.
+	 */
+	size_t read_batch(const int* sensors, int n_sensors, size_t n, const SampleBatch& batch);
+
+	/**
+	 * Registers a consumer of samples produced by the acquisition thread.
+	 * Every record is decoded once, with the union of all subscribed
+	 * fields, and handed to all matching subscribers. Callbacks run on the
+	 * acquisition thread and should return quickly. They may subscribe and
+	 * unsubscribe; a callback unsubscribed during a dispatch may still get
+	 * the sample being dispatched.
+	 * \param fields SampleFields the subscriber needs
+	 * \param sensor only deliver samples of this sensor, -1 for all
+	 * \return subscription id for unsubscribe()
+	 */
+	int subscribe(SampleCallback callback, unsigned fields = SAMPLE_ALL, int sensor = -1);
+	/** \param ring sink that must outlive the subscription */
+	int subscribe(SampleRing& ring, unsigned fields = SAMPLE_ALL, int sensor = -1);
+	void unsubscribe(int id);
+
+	/**
+	 * Starts the acquisition thread, which polls the given sensors (all
+	 * ports of get_topology() if empty) once per period of the tracker
+	 * rate, or as far as set_adaptive_polling() allots them. Ports without
+	 * a sensor are skipped, and the topology is refreshed once per second.
+	 */
+	void start(const std::vector<int>& sensors = {});
+	void stop();
+	bool acquiring() const;
+
+	/**
+	 * Lets the acquisition thread share the polls the link can carry among
+	 * the sensors by recent motion and priority (see PollScheduler), instead
+	 * of polling every sensor in every frame. Applied by start().
+	 */
+	void set_adaptive_polling(bool enabled, const SchedulerOptions& options = SchedulerOptions());
+	/** rates and motion of the sensors polled by the acquisition thread */
+	std::vector<SensorSchedule> get_schedule() const;
+
+	/**
+	 * Keeps the raw words of every record read from the tracker in a
+	 * history, whether or not a subscriber decodes them. The history must
+	 * outlive its use; nullptr stops keeping records.
+	 */
+	void set_raw_history(RawHistory* history);
+
+	/**
+	 * Scheduling options of the acquisition thread, applied by start().
+	 * Options that cannot be applied are reported on stderr and by
+	 * get_realtime_errors().
+	 */
+	void set_realtime(const RealtimeOptions& options);
+	std::vector<std::string> get_realtime_errors() const;
+	/** gaps between frames of the acquisition thread */
+	GapStats get_gap_stats() const;
+
+protected:
+	/** passes changed ports to the topology callback */
+	void p_report_topology(const std::vector<SensorInfo>& changed);
+
 private:
-	void p_read(int bytes);
-	void p_write(std::vector<int> list);
-	double p_get_double(int byte1, int byte2=-1);
+	struct Subscriber {
+		int id;
+		unsigned fields;
+		int sensor;
+		// shared, so dispatch can call it without holding the lock
+		std::shared_ptr<const SampleCallback> callback;
+	};
+
+	typedef std::chrono::steady_clock::time_point Deadline;
+
+	struct usb_device* p_find_device();
+	void p_open();
+	void p_close();
+	bool p_reconfigure();
+	void p_fail();
+	void p_discover_topology();
+	void p_probe_sensors();
+	Deadline p_deadline() const;
+	int p_transfer(int endpoint, char* buffer, int bytes, Deadline deadline);
+	[[noreturn]] void p_error(ATC3DGErrorKind kind, const std::string& message);
+	void p_drain();
+	void p_resync(int bytes, Deadline deadline);
+	// a default deadline starts the transaction budget now
+	void p_read(int bytes, Deadline deadline = Deadline());
+	void p_write(std::vector<int> list, Deadline deadline = Deadline());
+	int16_t p_get_word(int byte1, int byte2=-1);
+	void p_decode(int sensor, Sample& sample, unsigned fields);
+	void p_acquire(std::vector<int> sensors);
+	void p_dispatch(const Sample& sample);
+	unsigned p_subscribed_fields();
 	
 	void atc_init();
 	void atc_select_tx(int tx, int delay=7000);
@@ -175,17 +523,49 @@ private:
 	void atc_autoconfig(int units = 0x04, int delay=600);
 	void atc_reset(int delay = 6000);
 	void atc_sleep(int delay = 6000);
-	std::string atc_get_modelstring_pcb();
-	std::string atc_get_partnum_pcb();
-	std::string atc_get_modelstring_tx();
-	std::string atc_get_partnum_tx();
-	std::string atc_get_modelstring_rx(int rx);
-	std::string atc_get_partnum_rx(int rx);
 	
 	double m_scaling;
 	double m_rate;
-	bool m_good;
+	double m_timestamp;
+	std::atomic<bool> m_good;
 	
+	uint64_t m_sequence;
+
+	std::vector<Subscriber> m_subscribers;
+	int m_next_subscriber;
+	std::mutex m_subscriber_mutex;
+	// callbacks of the sample being dispatched, acquisition thread only
+	std::vector<std::shared_ptr<const SampleCallback>> m_dispatching;
+	// serializes USB transactions between the acquisition thread and callers
+	mutable std::recursive_mutex m_io_mutex;
+	std::thread m_thread;
+	std::atomic<bool> m_acquiring;
+
+	std::atomic<bool> m_auto_recover;
+	bool m_needs_init;
+	bool m_rate_set;
+	double m_outage_start;
+	ATC3DGStats m_stats;
+	std::atomic<int> m_transaction_budget;
+	std::atomic<int> m_pipeline_depth;
+	int m_consecutive_errors;
+	// a failed transaction may have left a response in the pipe
+	bool m_stale;
+
+	SensorInfo m_topology[ATC_MAX_SENSORS];
+	int m_tracker_status;
+	TopologyCallback m_topology_callback;
+
+	bool m_adaptive;
+	PollScheduler m_scheduler;
+	mutable std::mutex m_scheduler_mutex;
+
+	RawHistory* m_history;
+
+	RealtimeOptions m_realtime;
+	std::vector<std::string> m_realtime_errors;
+	GapStats m_gap_stats;
+
 	struct usb_device* m_device;
 	struct usb_dev_handle* m_handle;
 	
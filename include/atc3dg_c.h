@@ -0,0 +1,63 @@
+/**
+ * atc3dg_c.h
+ *
+ * C interface of the tracker library, e.g. for ctypes/numpy bindings.
+ *
+ * Functions returning int report 0 on success and -1 on failure; counts are
+ * returned as int64_t, with -1 on failure. atc_last_error() describes the
+ * last failure of the calling thread. Structures are only ever extended at
+ * the end, and ATC3DG_C_API_VERSION is increased when they are.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ATC3DG_C_API_VERSION 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct atc_tracker atc_tracker;
+typedef struct atc_recording atc_recording;
+
+/**
+ * Caller-owned structure-of-arrays buffers, one row per sample. NULL
+ * pointers skip a field.
+ */
+typedef struct atc_sample_batch {
+	double* position;	/* [rows][3] millimeters */
+	double* angles;		/* [rows][3] degrees */
+	double* matrix;		/* [rows][3][3] row-major */
+	double* quaternion;	/* [rows][4] q0, qi, qj, qk */
+	double* quality;	/* [rows] */
+	double* timestamp;	/* [rows] seconds */
+	uint8_t* button;	/* [rows] */
+	int32_t* sensor;	/* [rows] */
+	uint64_t* sequence;	/* [rows] */
+} atc_sample_batch;
+
+int atc_api_version(void);
+const char* atc_last_error(void);
+
+atc_tracker* atc_tracker_create(void);
+void atc_tracker_destroy(atc_tracker* tracker);
+int atc_tracker_connect(atc_tracker* tracker);
+int atc_tracker_disconnect(atc_tracker* tracker);
+int atc_tracker_number_sensors(atc_tracker* tracker);
+int atc_tracker_set_rate(atc_tracker* tracker, double rate);
+/* rows are ordered [n][n_sensors]; fewer rows than n * n_sensors if the
+   tracker goes offline or a sensor keeps losing records */
+int64_t atc_tracker_read_batch(atc_tracker* tracker, const int32_t* sensors, int32_t n_sensors, size_t n, const atc_sample_batch* batch);
+
+atc_recording* atc_recording_open(const char* filename);
+void atc_recording_close(atc_recording* recording);
+int64_t atc_recording_size(atc_recording* recording);
+int atc_recording_seek(atc_recording* recording, int64_t index);
+/* n_sensors == 0 reads all sensors */
+int64_t atc_recording_read_batch(atc_recording* recording, const int32_t* sensors, int32_t n_sensors, size_t n, const atc_sample_batch* batch);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,76 @@
+/**
+ * atc3dg_client.hpp
+ *
+ * Tracker served by the tracker daemon (atcd). The daemon owns the
+ * trakSTAR, keeps it initialized and streaming, and publishes every sample
+ * to shared memory; a client attaches to that in a few milliseconds instead
+ * of running the initialization sequence, and any number of processes can
+ * share one tracker. Samples, topology and status come from the daemon, so
+ * the client works with update(), poll(), start() and the rest of the
+ * ATC3DGTracker API, except that the rate is the daemon's.
+ */
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "atc3dg.hpp"
+#include "tracker_shm.hpp"
+
+
+class ATC3DGClient : public ATC3DGTracker {
+public:
+	/** \param name shared memory object of the daemon */
+	explicit ATC3DGClient(const std::string& name = TRACKER_SHM_NAME);
+	virtual ~ATC3DGClient();
+
+	/** attaches to the daemon, throws std::runtime_error if there is none */
+	void connect() override;
+	/** detaches, the daemon keeps the tracker streaming */
+	void disconnect() override;
+	/** attaches again, e.g. after the daemon was restarted */
+	bool recover(int timeout = 5000) override;
+
+	int get_number_sensors() override;
+	std::vector<SensorInfo> get_topology() const override;
+	bool is_attached(int port) const override;
+	/**
+	 * Compares the topology the daemon reports with that of the last call,
+	 * changed ports go to the topology callback.
+	 * \return true if the topology changed
+	 */
+	bool refresh_topology() override;
+
+	/** the daemon owns the rate, throws std::runtime_error */
+	void set_rate(double rate) override;
+	double get_rate() const override;
+
+	/** attached to a daemon that reported a good tracker within TRACKER_SHM_TIMEOUT */
+	bool good() const override;
+
+	/**
+	 * Next sample of a sensor the daemon published since the previous
+	 * one. Every sample is returned once and in order, as long as the
+	 * client keeps up within TRACKER_SHM_HISTORY samples of all sensors;
+	 * otherwise the oldest ones still available follow. Waits up to the
+	 * transaction budget for a new sample. The daemon decodes all fields.
+	 * \return false if there was none or the client is not attached
+	 */
+	bool poll(int sensor, Sample& sample, unsigned fields = SAMPLE_ALL) override;
+	/** polls the sensors one after another */
+	size_t poll_all(const std::vector<int>& sensors, std::vector<Sample>& samples, unsigned fields = SAMPLE_ALL) override;
+
+private:
+	void p_attach();
+	bool p_alive() const;
+	std::vector<SensorInfo> p_topology() const;
+
+	std::string m_name;
+	TrackerShmReader m_reader;
+	// per sensor, number of the next sample to look at
+	uint64_t m_cursors[TRACKER_SHM_MAX_SENSORS];
+	// topology last returned by refresh_topology()
+	std::vector<SensorInfo> m_known_topology;
+	mutable std::mutex m_mutex;
+};
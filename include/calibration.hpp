@@ -0,0 +1,68 @@
+/**
+ * calibration.hpp
+ *
+ * Tool calibration from recorded poses: pivot calibration of a stylus tip
+ * and hand-eye calibration (AX = XB) of a sensor mounted on another tracked
+ * or robot-held body. Both are linear least-squares problems whose normal
+ * equations are accumulated over chunks of the poses in parallel, so
+ * thousands of poses solve in milliseconds.
+ */
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "pose.hpp"
+#include "sample.hpp"
+
+
+struct PivotCalibration {
+	// tip in the sensor frame, mm
+	double tip[3];
+	// point the tip was pivoted about, in the transmitter frame, mm
+	double pivot[3];
+	// distance between the tip of every pose and the pivot, mm
+	double rms;
+	double max_error;
+	size_t poses;
+};
+
+struct HandEyeCalibration {
+	// sensor (eye) in the frame of the hand
+	Pose x;
+	// residuals of A X = X B over all motions, degrees and mm
+	double rotation_rms;
+	double translation_rms;
+	size_t motions;
+};
+
+/**
+ * Solves R_i tip + t_i = pivot in the least-squares sense over poses of a
+ * sensor pivoted about a fixed point. Throws std::runtime_error if the
+ * poses do not rotate enough to locate the tip.
+ * \param threads 0 for one per core
+ */
+PivotCalibration calibrate_pivot(const std::vector<Pose>& poses, int threads = 0);
+
+/**
+ * Solves A X = X B for the sensor-in-hand transform X, with A the motion
+ * of the hand and B the motion of the eye between two poses. Motions are
+ * taken between every pose and the pose half the sequence later, which
+ * keeps them large compared to the noise. Rotation and translation are
+ * solved one after the other; throws std::runtime_error if the motions do
+ * not rotate about at least two different axes.
+ * \param hand poses of the hand, e.g. a robot flange or a reference sensor
+ * \param eye poses of the eye taken at the same time as the hand poses
+ * \param threads 0 for one per core
+ */
+HandEyeCalibration calibrate_hand_eye(const std::vector<Pose>& hand, const std::vector<Pose>& eye, int threads = 0);
+
+/** poses of one sensor, the samples must carry position and quaternion */
+std::vector<Pose> sensor_poses(const std::vector<Sample>& samples, int sensor);
+
+/**
+ * Pairs samples of two sensors taken in the same measurement cycle.
+ * \param max_offset largest timestamp difference of a pair, seconds
+ */
+void paired_poses(const std::vector<Sample>& samples, int hand_sensor, int eye_sensor,
+	std::vector<Pose>& hand, std::vector<Pose>& eye, double max_offset = 0.005);
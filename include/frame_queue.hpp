@@ -0,0 +1,170 @@
+/**
+ * frame_queue.hpp
+ *
+ * Bounded lock-free queue (after Dmitry Vyukov's bounded MPMC queue) that
+ * decouples a producer from a slower consumer. When the queue is full,
+ * push() drops the oldest entries instead of waiting, so the producer's
+ * cadence never depends on the consumer. Drops are counted.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+
+
+template <typename T>
+class FrameQueue {
+public:
+	/**
+	 * \param capacity number of entries, rounded up to a power of two
+	 */
+	explicit FrameQueue(size_t capacity = 16) : m_enqueue(0), m_dequeue(0), m_dropped(0)
+	{
+		size_t size = 2;
+		while (size < capacity)
+		{
+			size <<= 1;
+		}
+		m_cells.reset(new Cell[size]);
+		for (size_t i = 0; i < size; i++)
+		{
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+		m_mask = size - 1;
+	}
+	FrameQueue(const FrameQueue&) = delete;
+
+	/** \return false if the queue is full */
+	bool try_push(const T& value)
+	{
+		size_t position = m_enqueue.load(std::memory_order_relaxed);
+		Cell* cell;
+		while (true)
+		{
+			cell = &m_cells[position & m_mask];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+			if (difference == 0)
+			{
+				if (m_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (difference < 0)
+			{
+				return false;
+			}
+			else
+			{
+				position = m_enqueue.load(std::memory_order_relaxed);
+			}
+		}
+		cell->value = value;
+		cell->sequence.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Pushes a value, dropping the oldest entry if the queue is full. Only
+	 * one thread may push. If a consumer is still copying out the entry
+	 * that has to be overwritten, this yields until it is done.
+	 * \return number of entries dropped
+	 */
+	size_t push(const T& value)
+	{
+		size_t dropped = 0;
+		while (!try_push(value))
+		{
+			if (dropped == 0 && p_pop(nullptr))
+			{
+				dropped++;
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+		return dropped;
+	}
+
+	/** \return false if the queue is empty */
+	bool pop(T& value)
+	{
+		return p_pop(&value);
+	}
+
+	/** approximate number of queued entries */
+	size_t size() const
+	{
+		size_t enqueue = m_enqueue.load(std::memory_order_acquire);
+		size_t dequeue = m_dequeue.load(std::memory_order_acquire);
+		return enqueue > dequeue ? enqueue - dequeue : 0;
+	}
+
+	size_t capacity() const
+	{
+		return m_mask + 1;
+	}
+
+	uint64_t dropped() const
+	{
+		return m_dropped.load(std::memory_order_relaxed);
+	}
+
+private:
+	struct Cell {
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	// a null value discards the entry
+	bool p_pop(T* value)
+	{
+		size_t position = m_dequeue.load(std::memory_order_relaxed);
+		Cell* cell;
+		while (true)
+		{
+			cell = &m_cells[position & m_mask];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+			if (difference == 0)
+			{
+				if (m_dequeue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (difference < 0)
+			{
+				return false;
+			}
+			else
+			{
+				position = m_dequeue.load(std::memory_order_relaxed);
+			}
+		}
+		// moved out so that shared entries are released as early as possible
+		if (value)
+		{
+			*value = std::move(cell->value);
+		}
+		else
+		{
+			cell->value = T();
+		}
+		cell->sequence.store(position + m_mask + 1, std::memory_order_release);
+		return true;
+	}
+
+	std::unique_ptr<Cell[]> m_cells;
+	size_t m_mask;
+	alignas(64) std::atomic<size_t> m_enqueue;
+	alignas(64) std::atomic<size_t> m_dequeue;
+	alignas(64) std::atomic<uint64_t> m_dropped;
+};
@@ -1,41 +1,192 @@
 #pragma once
 
+#include <type_traits>
+
 template <int N>
-class QuadMatrix
+class QuadMatrix;
+
+/**
+ * Base of everything that can be evaluated element by element to an NxN
+ * matrix. Operators build expressions instead of temporaries; assigning
+ * an expression to a QuadMatrix evaluates it in a single pass.
+ * Expressions refer to their matrix operands, so assign them right away
+ * instead of keeping them with auto.
+ */
+template <typename E, int N>
+class MatrixExpression
 {
 public:
-    QuadMatrix() { identity(); }
-    QuadMatrix(const float (&data)[N][N]) { fromArray(data); }
-    QuadMatrix(const QuadMatrix &other) { copy(other); }
-    virtual ~QuadMatrix() {}
-
-    void copy(const QuadMatrix &other);
-    void fromArray(const float (&data)[N][N]);
-    void toArray(float (&data)[N][N]) const;
-
-    void identity();
-    void set(const int i, const float value, const bool row_first=true);
-    void set(const int i, const int j, const float value);
-    float get(const int i, const int j) const;
-    QuadMatrix multiply(const QuadMatrix &other);
-    QuadMatrix multiply(const float scalar);
-
-    QuadMatrix adjoint();
-    QuadMatrix cofactor();
-    QuadMatrix<N - 1> minor(const int strike_row, const int strike_column);
-    float determinant();
-    float trace();
-    QuadMatrix inverse();
-    QuadMatrix transpose();
-
-    bool equals(const QuadMatrix& other) const;
-    bool operator==(const QuadMatrix& other) { return equals(other); }
-    bool operator!=(const QuadMatrix& other) { return !equals(other); }
-
-    // TODO: overload operators
+    constexpr float operator()(const int i, const int j) const { return static_cast<const E &>(*this)(i, j); }
+};
+
+// matrices are referenced, small expression nodes are copied
+template <typename E, int N>
+struct MatrixOperand { typedef const E type; };
+template <int N>
+struct MatrixOperand<QuadMatrix<N>, N> { typedef const QuadMatrix<N> &type; };
+
+// factors of a product are read N times per element, so nested
+// expressions are evaluated once instead
+template <typename E, int N>
+struct MatrixFactor { typedef const QuadMatrix<N> type; };
+template <int N>
+struct MatrixFactor<QuadMatrix<N>, N> { typedef const QuadMatrix<N> &type; };
+
+template <int N>
+class QuadMatrix : public MatrixExpression<QuadMatrix<N>, N>
+{
+public:
+    constexpr QuadMatrix() : m_data{} { identity(); }
+    constexpr QuadMatrix(const float (&data)[N][N]) : m_data{} { fromArray(data); }
+    QuadMatrix(const QuadMatrix &other) = default;
+    template <typename E>
+    constexpr QuadMatrix(const MatrixExpression<E, N> &expression) : m_data{} { evaluate(expression); }
+
+    QuadMatrix &operator=(const QuadMatrix &other) = default;
+    template <typename E>
+    constexpr QuadMatrix &operator=(const MatrixExpression<E, N> &expression)
+    {
+        // through a copy, the expression may refer to this matrix
+        return *this = QuadMatrix(expression);
+    }
+
+    constexpr void copy(const QuadMatrix &other) { *this = other; }
+    constexpr void fromArray(const float (&data)[N][N]);
+    constexpr void toArray(float (&data)[N][N]) const;
+
+    constexpr void identity();
+    constexpr void set(const int i, const float value, const bool row_first=true);
+    constexpr void set(const int i, const int j, const float value);
+    constexpr float get(const int i, const int j) const;
+    constexpr float operator()(const int i, const int j) const { return m_data[i][j]; }
+    constexpr QuadMatrix multiply(const QuadMatrix &other) const;
+    constexpr QuadMatrix multiply(const float scalar) const;
+
+    constexpr QuadMatrix adjoint() const;
+    constexpr QuadMatrix cofactor() const;
+    constexpr QuadMatrix<N - 1> minor(const int strike_row, const int strike_column) const;
+    constexpr float determinant() const;
+    constexpr float trace() const;
+    constexpr QuadMatrix inverse() const;
+    constexpr QuadMatrix transpose() const;
+
+    constexpr bool equals(const QuadMatrix& other) const;
+    constexpr bool operator==(const QuadMatrix& other) const { return equals(other); }
+    constexpr bool operator!=(const QuadMatrix& other) const { return !equals(other); }
+
+    template <typename E>
+    constexpr QuadMatrix &operator*=(const MatrixExpression<E, N> &other) { return *this = *this * other; }
+    constexpr QuadMatrix &operator*=(const float scalar) { return *this = *this * scalar; }
+    template <typename E>
+    constexpr QuadMatrix &operator+=(const MatrixExpression<E, N> &other) { return *this = *this + other; }
+    template <typename E>
+    constexpr QuadMatrix &operator-=(const MatrixExpression<E, N> &other) { return *this = *this - other; }
 
 protected:
-    float m_data[N][N];
+    template <typename E>
+    constexpr void evaluate(const MatrixExpression<E, N> &expression);
+
+    // 16 bytes, so that rows can be loaded as SSE/NEON vectors
+    alignas(16) float m_data[N][N];
 };
 
-#include "matrix.tpp"
\ No newline at end of file
+template <typename A, typename B, int N>
+class MatrixProduct : public MatrixExpression<MatrixProduct<A, B, N>, N>
+{
+public:
+    constexpr MatrixProduct(const MatrixExpression<A, N> &a, const MatrixExpression<B, N> &b)
+        : m_a(static_cast<const A &>(a)), m_b(static_cast<const B &>(b)) {}
+    constexpr float operator()(const int i, const int k) const
+    {
+        float sum = 0.0f;
+        for (int j = 0; j < N; j++)
+        {
+            sum += m_a(i, j) * m_b(j, k);
+        }
+        return sum;
+    }
+
+private:
+    typename MatrixFactor<A, N>::type m_a;
+    typename MatrixFactor<B, N>::type m_b;
+};
+
+template <typename A, typename B, int N>
+class MatrixSum : public MatrixExpression<MatrixSum<A, B, N>, N>
+{
+public:
+    constexpr MatrixSum(const MatrixExpression<A, N> &a, const MatrixExpression<B, N> &b, const float sign)
+        : m_a(static_cast<const A &>(a)), m_b(static_cast<const B &>(b)), m_sign(sign) {}
+    constexpr float operator()(const int i, const int j) const { return m_a(i, j) + m_sign * m_b(i, j); }
+
+private:
+    typename MatrixOperand<A, N>::type m_a;
+    typename MatrixOperand<B, N>::type m_b;
+    float m_sign;
+};
+
+template <typename A, int N>
+class MatrixScaled : public MatrixExpression<MatrixScaled<A, N>, N>
+{
+public:
+    constexpr MatrixScaled(const MatrixExpression<A, N> &a, const float scalar)
+        : m_a(static_cast<const A &>(a)), m_scalar(scalar) {}
+    constexpr float operator()(const int i, const int j) const { return m_a(i, j) * m_scalar; }
+
+private:
+    typename MatrixOperand<A, N>::type m_a;
+    float m_scalar;
+};
+
+template <typename A, int N>
+class MatrixTransposed : public MatrixExpression<MatrixTransposed<A, N>, N>
+{
+public:
+    constexpr explicit MatrixTransposed(const MatrixExpression<A, N> &a) : m_a(static_cast<const A &>(a)) {}
+    constexpr float operator()(const int i, const int j) const { return m_a(j, i); }
+
+private:
+    typename MatrixOperand<A, N>::type m_a;
+};
+
+template <typename A, typename B, int N>
+constexpr MatrixProduct<A, B, N> operator*(const MatrixExpression<A, N> &a, const MatrixExpression<B, N> &b)
+{
+    return MatrixProduct<A, B, N>(a, b);
+}
+
+template <typename A, typename B, int N>
+constexpr MatrixSum<A, B, N> operator+(const MatrixExpression<A, N> &a, const MatrixExpression<B, N> &b)
+{
+    return MatrixSum<A, B, N>(a, b, 1.0f);
+}
+
+template <typename A, typename B, int N>
+constexpr MatrixSum<A, B, N> operator-(const MatrixExpression<A, N> &a, const MatrixExpression<B, N> &b)
+{
+    return MatrixSum<A, B, N>(a, b, -1.0f);
+}
+
+template <typename A, int N>
+constexpr MatrixScaled<A, N> operator*(const MatrixExpression<A, N> &a, const float scalar)
+{
+    return MatrixScaled<A, N>(a, scalar);
+}
+
+template <typename A, int N>
+constexpr MatrixScaled<A, N> operator*(const float scalar, const MatrixExpression<A, N> &a)
+{
+    return MatrixScaled<A, N>(a, scalar);
+}
+
+/** transpose as part of an expression, see QuadMatrix::transpose() */
+template <typename A, int N>
+constexpr MatrixTransposed<A, N> transposed(const MatrixExpression<A, N> &a)
+{
+    return MatrixTransposed<A, N>(a);
+}
+
+static_assert(std::is_trivially_copyable<QuadMatrix<4>>::value, "QuadMatrix must be trivially copyable");
+static_assert(sizeof(QuadMatrix<4>) == 16 * sizeof(float), "QuadMatrix must not carry more than its elements");
+
+#include "matrix.tpp"
@@ -1,17 +1,5 @@
 template <int N>
-void QuadMatrix<N>::copy(const QuadMatrix<N> &other)
-{
-    for (int i = 0; i < N; i++)
-    {
-        for (int j = 0; j < N; j++)
-        {
-            m_data[i][j] = other.m_data[i][j];
-        }
-    }
-}
-
-template <int N>
-void QuadMatrix<N>::fromArray(const float (&data)[N][N])
+constexpr void QuadMatrix<N>::fromArray(const float (&data)[N][N])
 {
     for (int i = 0; i < N; i++)
     {
@@ -23,7 +11,7 @@ void QuadMatrix<N>::fromArray(const float (&data)[N][N])
 }
 
 template <int N>
-void QuadMatrix<N>::toArray(float (&data)[N][N]) const
+constexpr void QuadMatrix<N>::toArray(float (&data)[N][N]) const
 {
     for (int i = 0; i < N; i++)
     {
@@ -35,7 +23,7 @@ void QuadMatrix<N>::toArray(float (&data)[N][N]) const
 }
 
 template <int N>
-void QuadMatrix<N>::identity()
+constexpr void QuadMatrix<N>::identity()
 {
     for (int i = 0; i < N; i++)
     {
@@ -51,7 +39,7 @@ void QuadMatrix<N>::identity()
 }
 
 template <int N>
-void QuadMatrix<N>::set(const int i, const float value, const bool row_first)
+constexpr void QuadMatrix<N>::set(const int i, const float value, const bool row_first)
 {
     // TODO assert 0 <= i < N * N
     if (row_first)
@@ -65,58 +53,52 @@ void QuadMatrix<N>::set(const int i, const float value, const bool row_first)
 }
 
 template <int N>
-void QuadMatrix<N>::set(const int i, const int j, const float value)
+constexpr void QuadMatrix<N>::set(const int i, const int j, const float value)
 {
     // TODO assert i , j
     m_data[i][j] = value;
 }
 
 template <int N>
-float QuadMatrix<N>::get(const int i, const int j) const
+constexpr float QuadMatrix<N>::get(const int i, const int j) const
 {
     // TODO assert i , j
     return m_data[i][j];
 }
 
 template <int N>
-QuadMatrix<N> QuadMatrix<N>::multiply(const QuadMatrix<N> &other)
+template <typename E>
+constexpr void QuadMatrix<N>::evaluate(const MatrixExpression<E, N> &expression)
 {
-    QuadMatrix<N> result;
     for (int i = 0; i < N; i++)
     {
         for (int j = 0; j < N; j++)
         {
-            for (int k = 0; k < N; k++)
-            {
-                result.m_data[i][k] = m_data[i][j] * other.m_data[j][k];
-            }
+            m_data[i][j] = expression(i, j);
         }
     }
-    return result;
 }
 
 template <int N>
-QuadMatrix<N> QuadMatrix<N>::multiply(const float scalar)
+constexpr QuadMatrix<N> QuadMatrix<N>::multiply(const QuadMatrix<N> &other) const
 {
-    QuadMatrix<N> result;
-    for (int i = 0; i < N; i++)
-    {
-        for (int j = 0; j < N; j++)
-        {
-            result.m_data[i][j] = m_data[i][j] * scalar;
-        }
-    }
-    return result;
+    return *this * other;
 }
 
 template <int N>
-QuadMatrix<N> QuadMatrix<N>::adjoint()
+constexpr QuadMatrix<N> QuadMatrix<N>::multiply(const float scalar) const
 {
-    return cofactor().transpose();
+    return *this * scalar;
 }
 
 template <int N>
-QuadMatrix<N> QuadMatrix<N>::cofactor()
+constexpr QuadMatrix<N> QuadMatrix<N>::adjoint() const
+{
+    return transposed(cofactor());
+}
+
+template <int N>
+constexpr QuadMatrix<N> QuadMatrix<N>::cofactor() const
 {
     QuadMatrix<N> C;
 
@@ -137,7 +119,13 @@ QuadMatrix<N> QuadMatrix<N>::cofactor()
 }
 
 template <>
-float QuadMatrix<2>::determinant()
+constexpr float QuadMatrix<1>::determinant() const
+{
+    return m_data[0][0];
+}
+
+template <>
+constexpr float QuadMatrix<2>::determinant() const
 {
     float det = 0.0f;
     det += m_data[0][0] * m_data[1][1] - m_data[0][1] * m_data[1][0];
@@ -145,19 +133,22 @@ float QuadMatrix<2>::determinant()
 }
 
 template <>
-float QuadMatrix<3>::determinant()
+constexpr float QuadMatrix<3>::determinant() const
 {
     float det = 0.0f;
     det += m_data[0][0] * m_data[1][1] * m_data[2][2];
     det += m_data[0][1] * m_data[1][2] * m_data[2][0];
     det += m_data[0][2] * m_data[1][0] * m_data[2][1];
+    det -= m_data[0][2] * m_data[1][1] * m_data[2][0];
+    det -= m_data[0][0] * m_data[1][2] * m_data[2][1];
+    det -= m_data[0][1] * m_data[1][0] * m_data[2][2];
     return det;
 }
 
 template <int N>
-QuadMatrix<N - 1> QuadMatrix<N>::minor(const int strike_row, const int strike_column)
+constexpr QuadMatrix<N - 1> QuadMatrix<N>::minor(const int strike_row, const int strike_column) const
 {
-    // TODO assert N > 2
+    static_assert(N > 1, "A 1x1 matrix has no minors.");
     int mi = 0;
     int mj = 0;
     QuadMatrix<N - 1> minor_matrix;
@@ -183,20 +174,20 @@ QuadMatrix<N - 1> QuadMatrix<N>::minor(const int strike_row, const int strike_co
 }
 
 template <int N>
-float QuadMatrix<N>::determinant()
+constexpr float QuadMatrix<N>::determinant() const
 {
-    // TODO assert N >= 4, if template specification failed at some point
+    static_assert(N >= 4, "Smaller determinants are specialized.");
     float det = 0.0f;
     for (int j = 0; j < N; j++)
     {
-        // choose third row, as we're likely to have many zeros in there
+        // choose the last row, as we're likely to have many zeros in there
         // if we're dealing with homogeneous 4x4 transforms
-        int i = 3;
+        int i = N - 1;
         if (m_data[i][j] == 0)
         {
             continue;
         }
-        int minor_determinant = minor(i, j).determinant();
+        float minor_determinant = minor(i, j).determinant();
         if ((i + j) % 2 != 0)
         {
             minor_determinant = -minor_determinant;
@@ -207,7 +198,7 @@ float QuadMatrix<N>::determinant()
 }
 
 template <int N>
-float QuadMatrix<N>::trace()
+constexpr float QuadMatrix<N>::trace() const
 {
     float result = 0;
     for (int i = 0; i < N; i++)
@@ -218,29 +209,20 @@ float QuadMatrix<N>::trace()
 }
 
 template <int N>
-QuadMatrix<N> QuadMatrix<N>::inverse()
+constexpr QuadMatrix<N> QuadMatrix<N>::inverse() const
 {
-    return adjoint().multiply(1 / determinant());
+    // the adjoint is transposed while it is scaled
+    return transposed(cofactor()) * (1 / determinant());
 }
 
 template <int N>
-QuadMatrix<N> QuadMatrix<N>::transpose()
+constexpr QuadMatrix<N> QuadMatrix<N>::transpose() const
 {
-    QuadMatrix<N> T;
-
-    for (int i = 0; i < N; i++)
-    {
-        for (int j = 0; j < N; j++)
-        {
-            T.m_data[i][j] = m_data[j][i];
-        }
-    }
-
-    return T;
+    return transposed(*this);
 }
 
 template <int N>
-bool QuadMatrix<N>::equals(const QuadMatrix<N> &other) const
+constexpr bool QuadMatrix<N>::equals(const QuadMatrix<N> &other) const
 {
     for (int i = 0; i < N; i++)
     {
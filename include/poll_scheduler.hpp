@@ -0,0 +1,104 @@
+/**
+ * poll_scheduler.hpp
+ *
+ * Shares the polls per second the USB link can carry among the sensors by
+ * how much they move. Polling every sensor in every frame gives a static
+ * reference the same bandwidth as a moving instrument; the scheduler gives
+ * every sensor a rate of its own instead: a minimum refresh rate for all,
+ * the rest of the budget by recent motion times priority, and never more
+ * than the tracker rate, since faster polls only repeat a measurement.
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "sample.hpp"
+
+
+struct SchedulerOptions {
+	// polls per second shared by all sensors, 0 to derive it from the
+	// measured duration of a poll
+	double budget = 0;
+	// fraction of the measured link capacity used if budget is 0
+	double utilization = 0.8;
+	// Hz every attached sensor is polled at at least
+	double min_rate = 5;
+	// distance of the point of interest (e.g. a tool tip) from the sensor
+	// in mm, turns rotations into motion
+	double lever = 100;
+	// mm of motion below which a sensor counts as static, motion is
+	// measured over at least this distance or the time constant
+	double deadband = 0.25;
+	// seconds over which motion is averaged
+	double time_constant = 0.25;
+	// mm/s added to the motion of every sensor, so that priorities also
+	// divide the budget among static sensors
+	double base_motion = 1;
+	// weight of every port, 1 for ports not listed
+	std::vector<double> priorities;
+};
+
+struct SensorSchedule {
+	int sensor;
+	double priority;
+	// smoothed speed in mm/s, including rotations at the lever
+	double motion;
+	// allocated polls per second
+	double rate;
+	uint64_t polls;
+};
+
+
+class PollScheduler {
+public:
+	explicit PollScheduler(const SchedulerOptions& options = SchedulerOptions());
+
+	/** keeps the motion and timing of the sensors */
+	void set_options(const SchedulerOptions& options);
+	const SchedulerOptions& get_options() const;
+
+	/**
+	 * Chooses the sensors to poll in the frame that starts now.
+	 * \param attached sensors that can be polled
+	 * \param rate tracker rate in Hz, one frame per period
+	 * \param now seconds, see atc3dg_time()
+	 * \param sensors receives the sensors to poll, in the order of attached
+	 */
+	void next(const std::vector<int>& attached, double rate, double now, std::vector<int>& sensors);
+	/** updates the motion of a sensor from a sample with position and quaternion */
+	void update(const Sample& sample);
+	/** measured duration of polling a number of sensors, for the budget */
+	void account(size_t polls, double seconds);
+
+	/** polls per second available, 0 if not configured and not yet measured */
+	double get_budget() const;
+	/** sensors seen by next(), in the order of their ports */
+	std::vector<SensorSchedule> get_schedule() const;
+
+private:
+	struct SensorState {
+		bool seen = false;
+		bool has_pose = false;
+		// last pose motion was measured from
+		double position[3];
+		double quaternion[4];
+		double time = 0;
+		double motion = 0;
+		double rate = 0;
+		// time of the next poll
+		double due = 0;
+		uint64_t polls = 0;
+	};
+
+	SensorState& p_state(int sensor);
+	double p_priority(int sensor) const;
+	void p_allocate(const std::vector<int>& attached, double rate);
+
+	SchedulerOptions m_options;
+	std::vector<SensorState> m_states;
+	// seconds per poll, smoothed
+	double m_cost;
+	// polls that may still be spent, refilled every frame
+	double m_credit;
+};
@@ -0,0 +1,113 @@
+/**
+ * pose.hpp
+ *
+ * Rigid transform as a unit quaternion and a translation, the internal
+ * representation of sensor poses and derived transforms. A pose holds 7
+ * numbers instead of the 16 of a homogeneous matrix, and composing two
+ * poses takes about a third of the arithmetic of a 4x4 product. Matrices
+ * are only built where they leave the process.
+ */
+#pragma once
+
+#include <cmath>
+
+#include "matrix.hpp"
+#include "sample.hpp"
+
+
+struct Pose {
+	// unit quaternion (w, x, y, z), identity by default
+	double q[4] = {1, 0, 0, 0};
+	// translation in millimeters
+	double t[3] = {0, 0, 0};
+
+	static Pose identity();
+	/** pose of the upper 3x4 part of a rigid transform */
+	static Pose from_matrix(const QuadMatrix<4>& m);
+	/**
+	 * pose of the quaternion and position of a sample, its matrix is that
+	 * of the sample
+	 */
+	static Pose from_sample(const Sample& sample);
+
+	QuadMatrix<4> matrix() const;
+	void to_matrix(float (&m)[4][4]) const;
+
+	/** this transform applied after other, like the matrix product this * other */
+	Pose operator*(const Pose& other) const;
+	Pose inverse() const;
+	void normalize();
+	void rotate(const double (&v)[3], double (&out)[3]) const;
+	void apply(const double (&point)[3], double (&out)[3]) const;
+
+	/**
+	 * Rotation by spherical linear interpolation along the shorter arc,
+	 * translation linearly.
+	 * \param alpha 0 for a, 1 for b
+	 */
+	static Pose slerp(const Pose& a, const Pose& b, double alpha);
+};
+
+
+inline Pose Pose::identity()
+{
+	return {{1, 0, 0, 0}, {0, 0, 0}};
+}
+
+inline void Pose::rotate(const double (&v)[3], double (&out)[3]) const
+{
+	// v + 2w (u x v) + 2 u x (u x v) with u the vector part
+	double w = q[0], x = q[1], y = q[2], z = q[3];
+	double cx = 2 * (y * v[2] - z * v[1]);
+	double cy = 2 * (z * v[0] - x * v[2]);
+	double cz = 2 * (x * v[1] - y * v[0]);
+	out[0] = v[0] + w * cx + (y * cz - z * cy);
+	out[1] = v[1] + w * cy + (z * cx - x * cz);
+	out[2] = v[2] + w * cz + (x * cy - y * cx);
+}
+
+inline void Pose::apply(const double (&point)[3], double (&out)[3]) const
+{
+	rotate(point, out);
+	for (int i = 0; i < 3; i++)
+	{
+		out[i] += t[i];
+	}
+}
+
+inline Pose Pose::operator*(const Pose& other) const
+{
+	const double* a = q;
+	const double* b = other.q;
+	Pose result;
+	result.q[0] = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+	result.q[1] = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+	result.q[2] = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+	result.q[3] = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+	apply(other.t, result.t);
+	return result;
+}
+
+inline Pose Pose::inverse() const
+{
+	Pose result = {{q[0], -q[1], -q[2], -q[3]}, {0, 0, 0}};
+	double t_negated[3] = {-t[0], -t[1], -t[2]};
+	result.rotate(t_negated, result.t);
+	return result;
+}
+
+inline void Pose::normalize()
+{
+	double norm = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+	if (norm > 0)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			q[i] /= norm;
+		}
+	}
+	else
+	{
+		q[0] = 1;
+	}
+}
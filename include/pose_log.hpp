@@ -0,0 +1,139 @@
+/**
+ * pose_log.hpp
+ *
+ * Compressed captures for long recordings.
+ *
+ * Samples are quantized well below the 14 bit resolution of the tracker
+ * and stored as zigzag varint deltas against the previous sample of the
+ * same sensor. Samples are grouped into blocks that start from scratch, so
+ * every block decodes on its own. A footer indexes the blocks by time,
+ * which makes seeking O(log n) and lets readers decode blocks in parallel.
+ *
+ * Layout: 24 byte header (magic "ATC3DGP", format version, samples per
+ * block, clock offset, see RecordingReader::clock_offset()), the blocks, the index (one PoseLogBlock per block, host byte
+ * order) and a 16 byte trailer (index offset, magic "ATCPIDX"). Every
+ * block starts with a 32 byte header (magic "ATCB", sample count, encoded
+ * bytes, first and last timestamp). The index is written by close(); for
+ * logs of an interrupted recording, readers rebuild it from the block
+ * headers, and lose at most the block that was being written.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "sample.hpp"
+
+#define POSE_LOG_MAGIC "ATC3DGP"
+#define POSE_LOG_INDEX_MAGIC "ATCPIDX"
+#define POSE_LOG_BLOCK_MAGIC "ATCB"
+#define POSE_LOG_VERSION 2
+#define POSE_LOG_HEADER_SIZE 24
+#define POSE_LOG_BLOCK_HEADER_SIZE 32
+#define POSE_LOG_TRAILER_SIZE 16
+#define POSE_LOG_BLOCK_SAMPLES 4096
+
+// quantization steps, a fraction of the native 1/8192 of full scale
+#define POSE_LOG_POSITION_STEP 0.01	// millimeters
+#define POSE_LOG_ANGLE_STEP 0.005		// degrees
+#define POSE_LOG_UNIT_STEP (1.0 / 65536)	// matrix, quaternion, quality
+#define POSE_LOG_TIME_STEP 1e-6			// seconds
+// position, angles, matrix, quaternion, quality
+#define POSE_LOG_VALUES 20
+
+
+struct PoseLogBlock {
+	// file offset of the encoded samples, after the block header
+	uint64_t offset;
+	uint64_t bytes;
+	// index of the first sample in the log
+	uint64_t first;
+	uint64_t count;
+	double first_timestamp;
+	double last_timestamp;
+};
+
+
+class PoseLogWriter {
+public:
+	PoseLogWriter();
+	virtual ~PoseLogWriter();
+
+	/**
+	 * \param block_samples samples per independently decodable block
+	 */
+	void open(const std::string& filename, int block_samples = POSE_LOG_BLOCK_SAMPLES);
+	/** samples of a log must be written in timestamp order */
+	void write(const Sample& sample);
+	/** writes the last block and the index */
+	void close();
+
+private:
+	// quantized previous sample of a sensor
+	struct State {
+		uint64_t sequence;
+		int64_t values[POSE_LOG_VALUES];
+	};
+
+	void p_flush();
+
+	FILE* m_file;
+	int m_block_samples;
+	std::vector<uint8_t> m_block;
+	std::vector<State> m_previous;
+	int64_t m_previous_time;
+	PoseLogBlock m_current;
+	std::vector<PoseLogBlock> m_index;
+};
+
+
+class PoseLogReader {
+public:
+	PoseLogReader();
+	virtual ~PoseLogReader();
+
+	/**
+	 * Reads the index, or rebuilds it from the block headers if the log
+	 * has none (see PoseLogWriter::close()).
+	 */
+	void open(const std::string& filename);
+	void close();
+
+	/** number of samples in the log */
+	size_t size() const;
+	/** seconds to add to timestamps for the time since the epoch */
+	double clock_offset() const;
+	const std::vector<PoseLogBlock>& blocks() const;
+
+	/**
+	 * Positions the reader at the first sample not older than timestamp.
+	 * \return false if all samples are older
+	 */
+	bool seek_time(double timestamp);
+	bool read(Sample& sample);
+
+	/**
+	 * Decodes one block. Safe to call from several threads at once.
+	 */
+	void decode_block(size_t block, std::vector<Sample>& samples) const;
+	/**
+	 * Decodes the whole log, blocks are distributed over threads.
+	 * \param threads 0 for one per core
+	 */
+	void read_all(std::vector<Sample>& samples, int threads = 0) const;
+
+private:
+	bool p_read_index(const std::string& filename, uint64_t size);
+	void p_scan_blocks(uint64_t size);
+
+	int m_fd;
+	std::vector<PoseLogBlock> m_index;
+	size_t m_size;
+	double m_clock_offset;
+	// block being read by read()
+	size_t m_block;
+	std::vector<Sample> m_samples;
+	size_t m_consumed;
+};
@@ -0,0 +1,214 @@
+/**
+ * pose_shm.hpp
+ *
+ * Publishes transform frames into POSIX shared memory for consumers on the
+ * same host, and reads them back. Header-only, so readers only need this
+ * file and shm_segment.hpp (and -lrt on older glibc).
+ *
+ * The segment holds a ring of the most recent frames. Each slot is guarded
+ * by a seqlock (see ShmSeqlock), so readers never block the writer and
+ * need no system calls after attaching.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "shm_segment.hpp"
+
+#define POSE_SHM_MAGIC 0x50435441 // "ATCP"
+#define POSE_SHM_VERSION 3
+#define POSE_SHM_HISTORY 64
+#define POSE_SHM_MAX_TRANSFORMS 512
+#define POSE_SHM_NAME_LENGTH 32
+
+
+struct PoseShmTransform {
+	char name[POSE_SHM_NAME_LENGTH];
+	float matrix[4][4];
+	// rotation of the matrix as a unit quaternion (w, x, y, z)
+	float quaternion[4];
+	uint32_t valid;
+	uint32_t reserved;
+};
+
+struct PoseShmFrame {
+	// frame number, starting at 0
+	uint64_t frame;
+	// see atc3dg_time()
+	double timestamp;
+	uint32_t count;
+	uint32_t reserved;
+	PoseShmTransform transforms[POSE_SHM_MAX_TRANSFORMS];
+};
+
+struct PoseShmSlot {
+	ShmSeqlock lock;
+	PoseShmFrame frame;
+};
+
+struct PoseShmSegment {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t history;
+	uint32_t max_transforms;
+	// number of frames published so far
+	alignas(64) std::atomic<uint64_t> published;
+	alignas(64) PoseShmSlot slots[POSE_SHM_HISTORY];
+};
+
+
+class PoseShmWriter {
+public:
+	PoseShmWriter() : m_segment(nullptr) {}
+	PoseShmWriter(const PoseShmWriter&) = delete;
+	virtual ~PoseShmWriter() { close(); }
+
+	/**
+	 * \param name shared memory object name, e.g. "/atc3dg"
+	 */
+	void open(const std::string& name)
+	{
+		close();
+		m_segment = static_cast<PoseShmSegment*>(shm_segment_create(name, sizeof(PoseShmSegment)));
+		m_name = name;
+		m_segment->history = POSE_SHM_HISTORY;
+		m_segment->max_transforms = POSE_SHM_MAX_TRANSFORMS;
+		m_segment->version = POSE_SHM_VERSION;
+		std::atomic_thread_fence(std::memory_order_release);
+		// readers check the magic last
+		m_segment->magic = POSE_SHM_MAGIC;
+	}
+
+	void close()
+	{
+		if (m_segment)
+		{
+			shm_segment_close(m_segment, sizeof(PoseShmSegment));
+			shm_unlink(m_name.c_str());
+			m_segment = nullptr;
+		}
+	}
+
+	bool is_open() const
+	{
+		return m_segment != nullptr;
+	}
+
+	/**
+	 * Slot to fill for the next frame, followed by publish(). Only one
+	 * thread may write.
+	 */
+	PoseShmFrame& begin()
+	{
+		uint64_t frame = m_segment->published.load(std::memory_order_relaxed);
+		PoseShmSlot& slot = m_segment->slots[frame % POSE_SHM_HISTORY];
+		slot.lock.begin_write();
+		slot.frame.frame = frame;
+		return slot.frame;
+	}
+
+	void publish()
+	{
+		uint64_t frame = m_segment->published.load(std::memory_order_relaxed);
+		PoseShmSlot& slot = m_segment->slots[frame % POSE_SHM_HISTORY];
+		slot.lock.end_write();
+		m_segment->published.store(frame + 1, std::memory_order_release);
+	}
+
+private:
+	std::string m_name;
+	PoseShmSegment* m_segment;
+};
+
+
+class PoseShmReader {
+public:
+	PoseShmReader() : m_segment(nullptr) {}
+	PoseShmReader(const PoseShmReader&) = delete;
+	virtual ~PoseShmReader() { close(); }
+
+	void open(const std::string& name)
+	{
+		close();
+		m_segment = static_cast<const PoseShmSegment*>(shm_segment_open(name, sizeof(PoseShmSegment)));
+		if (!m_segment)
+		{
+			throw std::runtime_error("Could not open shared memory " + name + ".");
+		}
+		if (m_segment->magic != POSE_SHM_MAGIC || m_segment->version != POSE_SHM_VERSION)
+		{
+			close();
+			throw std::runtime_error(name + " is not a pose segment of a compatible version.");
+		}
+	}
+
+	void close()
+	{
+		if (m_segment)
+		{
+			shm_segment_close(m_segment, sizeof(PoseShmSegment));
+			m_segment = nullptr;
+		}
+	}
+
+	/** number of frames published so far */
+	uint64_t published() const
+	{
+		return m_segment->published.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * Copies a frame that is still in the history.
+	 * \return false if the frame was not published yet or was overwritten
+	 */
+	bool read(uint64_t number, PoseShmFrame& frame) const
+	{
+		const PoseShmSlot& slot = m_segment->slots[number % POSE_SHM_HISTORY];
+		uint64_t sequence = slot.lock.read([&]() {
+			// only the transforms in use, frames hold up to 512 of them
+			memcpy(&frame, &slot.frame, offsetof(PoseShmFrame, transforms));
+			uint32_t count = std::min<uint32_t>(frame.count, POSE_SHM_MAX_TRANSFORMS);
+			memcpy(frame.transforms, slot.frame.transforms, count * sizeof(PoseShmTransform));
+		});
+		return sequence != 0 && frame.frame == number;
+	}
+
+	/** \return false if nothing was published yet */
+	bool latest(PoseShmFrame& frame) const
+	{
+		while (true)
+		{
+			uint64_t published = this->published();
+			if (published == 0)
+			{
+				return false;
+			}
+			if (read(published - 1, frame))
+			{
+				return true;
+			}
+		}
+	}
+
+	/** \return transform of a frame by name, or nullptr */
+	static const PoseShmTransform* find(const PoseShmFrame& frame, const std::string& name)
+	{
+		for (uint32_t i = 0; i < frame.count && i < POSE_SHM_MAX_TRANSFORMS; i++)
+		{
+			if (name == frame.transforms[i].name)
+			{
+				return &frame.transforms[i];
+			}
+		}
+		return nullptr;
+	}
+
+private:
+	const PoseShmSegment* m_segment;
+};
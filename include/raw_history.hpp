@@ -0,0 +1,108 @@
+/**
+ * raw_history.hpp
+ *
+ * Per-sensor history of trakSTAR records as the 14 bit words the tracker
+ * sends, decoded only when a consumer asks for a field. A decoded Sample
+ * takes over 200 bytes, a RawSample one 64 byte cache line, so seconds of
+ * history for filtering, prediction or interpolation stay small and the
+ * acquisition thread only copies words. One thread pushes (see
+ * ATC3DGTracker::set_raw_history()), any number of threads read without
+ * taking samples out.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "sample.hpp"
+
+// words of a record up to the quaternion, see RawWord
+#define RAW_SAMPLE_WORDS 19
+// sensors of a history by default, as many as a tracker has ports
+#define RAW_HISTORY_SENSORS 4
+
+
+// index of the first word of a field in RawSample::words
+enum RawWord {
+	RAW_WORD_POSITION = 0,
+	RAW_WORD_MATRIX = 3,
+	RAW_WORD_ANGLES = 12,
+	RAW_WORD_QUATERNION = 15,
+	// quality is decoded from bytes 36 and 37, as in poll()
+	RAW_WORD_QUALITY = 18
+};
+
+struct alignas(64) RawSample {
+	// see Sample
+	double request_time;
+	double timestamp;
+	uint64_t sequence;
+	// 14 bit values shifted into the upper bits, fractions of 0x8000
+	int16_t words[RAW_SAMPLE_WORDS];
+	uint8_t button;
+	// position range, 2 for the extended range of some transmitters
+	uint8_t scaling;
+};
+
+static_assert(sizeof(RawSample) == 64, "a raw sample should fill one cache line");
+
+/**
+ * Decodes the requested fields of a raw sample, like
+ * ATC3DGTracker::poll() decodes a record. Sensor, sequence and times are
+ * always set.
+ */
+void raw_sample_decode(int sensor, const RawSample& raw, unsigned fields, Sample& sample);
+
+
+class RawHistory {
+public:
+	/**
+	 * \param capacity samples kept per sensor at least, the ring of a
+	 * sensor has the next power of two above it
+	 * \param sensors sensors 0 to sensors - 1 are kept
+	 */
+	explicit RawHistory(size_t capacity = 1024, int sensors = RAW_HISTORY_SENSORS);
+	RawHistory(const RawHistory&) = delete;
+
+	/** Only one thread may push. Samples of unknown sensors are ignored. */
+	void push(int sensor, const RawSample& raw);
+
+	/** number of samples pushed for a sensor so far */
+	uint64_t count(int sensor) const;
+	/** samples of a sensor a reader can get */
+	size_t capacity() const;
+	int sensors() const;
+	/** bytes of sample storage */
+	size_t memory() const;
+
+	/**
+	 * Copies up to n of the most recent raw samples of a sensor, oldest
+	 * first. Samples the producer overwrote while they were copied are
+	 * left out.
+	 * \return number of samples
+	 */
+	size_t latest(int sensor, size_t n, std::vector<RawSample>& raw) const;
+	/** decodes the fields of up to n of the most recent samples, oldest first */
+	size_t decode(int sensor, size_t n, unsigned fields, std::vector<Sample>& samples) const;
+	/** decodes the fields of the samples with timestamps in [begin, end], oldest first */
+	size_t decode_range(int sensor, double begin, double end, unsigned fields, std::vector<Sample>& samples) const;
+	/**
+	 * Decodes up to n of the most recent samples of a sensor into the
+	 * non-null arrays of a batch (see SampleBatch), oldest first.
+	 * \return number of rows written
+	 */
+	size_t read_batch(int sensor, size_t n, const SampleBatch& batch) const;
+
+private:
+	bool p_valid(int sensor) const;
+
+	size_t m_mask;
+	int m_sensors;
+	// capacity samples per sensor, one sensor after another
+	std::vector<RawSample> m_slots;
+	// per sensor, number of samples pushed
+	std::unique_ptr<std::atomic<uint64_t>[]> m_heads;
+};
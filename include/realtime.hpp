@@ -0,0 +1,64 @@
+/**
+ * realtime.hpp
+ *
+ * Real-time scheduling options for acquisition and send threads, and
+ * statistics of the gaps between consecutive frames to judge their effect.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+struct RealtimeOptions {
+	// SCHED_FIFO priority (1-99), 0 keeps the default scheduler
+	int priority = 0;
+	// CPUs the thread is pinned to, empty for no affinity
+	std::vector<int> cpus;
+	// lock all current and future pages of the process into memory
+	bool lock_memory = false;
+	// bytes of stack touched up front so they are not faulted in later
+	size_t prefault_stack = 0;
+};
+
+/**
+ * Applies options to the calling thread (memory locking affects the whole
+ * process).
+ * \return one description per option that could not be applied, empty if
+ * everything succeeded
+ */
+std::vector<std::string> apply_realtime(const RealtimeOptions& options);
+
+
+class GapStats {
+public:
+	/**
+	 * \param threshold gaps longer than this many seconds are counted
+	 */
+	explicit GapStats(double threshold = 0.02);
+
+	/** adds the timestamp of the next frame, in seconds */
+	void add(double timestamp);
+	void reset();
+
+	uint64_t count() const;
+	// seconds
+	double mean() const;
+	double stddev() const;
+	double max() const;
+	double threshold() const;
+	uint64_t over_threshold() const;
+
+	std::string summary() const;
+
+private:
+	double m_threshold;
+	double m_last;
+	uint64_t m_count;
+	double m_sum;
+	double m_sum_squares;
+	double m_max;
+	uint64_t m_over_threshold;
+};
@@ -0,0 +1,74 @@
+/**
+ * recording.hpp
+ *
+ * Raw capture files of tracker samples.
+ *
+ * A capture starts with a 24 byte header (magic "ATC3DGR", format version,
+ * record size, clock offset) followed by fixed-size records in host byte
+ * order, so the n-th sample can be located without scanning the file.
+ * Timestamps are those of atc3dg_time(); adding the clock offset gives
+ * seconds since the epoch. Version 1 captures have a 16 byte header and
+ * wall-clock timestamps.
+ */
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "sample.hpp"
+
+#define RECORDING_MAGIC "ATC3DGR"
+#define RECORDING_VERSION 2
+#define RECORDING_HEADER_SIZE 24
+#define RECORDING_RECORD_SIZE 200
+
+
+class RecordingWriter {
+public:
+	RecordingWriter();
+	virtual ~RecordingWriter();
+
+	void open(const std::string& filename);
+	void write(const Sample& sample);
+	void close();
+
+private:
+	FILE* m_file;
+};
+
+
+class RecordingReader {
+public:
+	RecordingReader();
+	virtual ~RecordingReader();
+
+	void open(const std::string& filename);
+	void close();
+
+	/** number of samples in the capture */
+	size_t size() const;
+	/** seconds to add to timestamps for the time since the epoch */
+	double clock_offset() const;
+	void seek(size_t index);
+	bool read(Sample& sample);
+
+	/**
+	 * Reads up to n samples of the given sensors (all sensors if n_sensors
+	 * is 0) from the current position into consecutive rows of a batch.
+	 * \return number of rows written, less than n at the end of the file
+	 */
+	size_t read_batch(const int* sensors, int n_sensors, size_t n, const SampleBatch& batch);
+
+private:
+	bool p_fill();
+
+	FILE* m_file;
+	size_t m_size;
+	long m_header_size;
+	double m_clock_offset;
+	// block of raw records read ahead
+	std::vector<char> m_buffer;
+	size_t m_buffered;
+	size_t m_consumed;
+};
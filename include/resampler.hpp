@@ -0,0 +1,59 @@
+/**
+ * resampler.hpp
+ *
+ * Keeps a short pose history per sensor and resamples all sensors to a
+ * common timestamp.
+ *
+ * Sensors are polled one after the other, so the poses of a frame are taken
+ * at different instants. Positions are interpolated linearly and rotations
+ * by spherical linear interpolation between the two samples enclosing the
+ * requested timestamp.
+ */
+#pragma once
+
+#include <vector>
+
+#include "pose.hpp"
+
+
+class Resampler {
+public:
+	Resampler(int history = 16);
+
+	void push(int sensor, double timestamp, const Pose& pose);
+	void clear();
+
+	/** timestamp of the newest sample of a sensor, or 0 if there is none */
+	double latest(int sensor) const;
+
+	/**
+	 * Newest timestamp that can be interpolated for all given sensors
+	 * without extrapolation, i.e. the oldest of their newest samples.
+	 */
+	double common_timestamp(const std::vector<int>& sensors) const;
+
+	/**
+	 * \param sensor sensor to resample
+	 * \param timestamp time to interpolate to, clamped to the history
+	 * \param pose resampled rigid transform
+	 * \return false if the sensor has no samples yet
+	 */
+	bool sample(int sensor, double timestamp, Pose& pose) const;
+
+private:
+	struct Entry {
+		double timestamp;
+		Pose pose;
+	};
+
+	struct History {
+		std::vector<Entry> entries;
+		int head;
+		int count;
+	};
+
+	const Entry& p_entry(const History& history, int age) const;
+
+	int m_capacity;
+	std::vector<History> m_histories;
+};
@@ -0,0 +1,133 @@
+/**
+ * sample.hpp
+ *
+ * Decoded trakSTAR record of a single sensor.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+// fields of a Sample, used to select what is decoded
+enum SampleFields {
+	SAMPLE_POSITION =			0x01,
+	SAMPLE_ANGLES =				0x02,
+	SAMPLE_MATRIX =				0x04,
+	SAMPLE_QUATERNION =			0x08,
+	SAMPLE_QUALITY =			0x10,
+	SAMPLE_BUTTON =				0x20,
+	SAMPLE_ALL =				0x3F
+};
+
+struct Sample {
+	int sensor;
+	// increases by one with every record read from the tracker
+	uint64_t sequence;
+	// time the request was sent and the record arrived, see atc3dg_time()
+	double request_time;
+	double timestamp;
+	// SampleFields that were decoded, other fields are left untouched
+	unsigned fields;
+
+	// millimeters
+	double position[3];
+	// azimuth, elevation, roll in degrees
+	double angles[3];
+	double matrix[3][3];
+	// q0, qi, qj, qk
+	double quaternion[4];
+	double quality;
+	bool button;
+};
+
+/**
+ * Caller-owned structure-of-arrays buffers filled by the read_batch()
+ * functions. Each array holds one row per sample; a null pointer skips the
+ * field, and only non-null fields are decoded.
+ */
+struct SampleBatch {
+	// [rows][3]
+	double* position;
+	// [rows][3]
+	double* angles;
+	// [rows][3][3], row-major
+	double* matrix;
+	// [rows][4]
+	double* quaternion;
+	// [rows]
+	double* quality;
+	double* timestamp;
+	uint8_t* button;
+	int32_t* sensor;
+	uint64_t* sequence;
+};
+
+/** SampleFields needed to fill the non-null arrays of a batch */
+inline unsigned sample_batch_fields(const SampleBatch& batch)
+{
+	unsigned fields = 0;
+	fields |= batch.position ? SAMPLE_POSITION : 0;
+	fields |= batch.angles ? SAMPLE_ANGLES : 0;
+	fields |= batch.matrix ? SAMPLE_MATRIX : 0;
+	fields |= batch.quaternion ? SAMPLE_QUATERNION : 0;
+	fields |= batch.quality ? SAMPLE_QUALITY : 0;
+	fields |= batch.button ? SAMPLE_BUTTON : 0;
+	return fields;
+}
+
+/** copies a sample into row of a batch */
+inline void sample_batch_store(const SampleBatch& batch, size_t row, const Sample& sample)
+{
+	if (batch.position)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			batch.position[row * 3 + i] = sample.position[i];
+		}
+	}
+	if (batch.angles)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			batch.angles[row * 3 + i] = sample.angles[i];
+		}
+	}
+	if (batch.matrix)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				batch.matrix[row * 9 + i * 3 + j] = sample.matrix[i][j];
+			}
+		}
+	}
+	if (batch.quaternion)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			batch.quaternion[row * 4 + i] = sample.quaternion[i];
+		}
+	}
+	if (batch.quality)
+	{
+		batch.quality[row] = sample.quality;
+	}
+	if (batch.timestamp)
+	{
+		batch.timestamp[row] = sample.timestamp;
+	}
+	if (batch.button)
+	{
+		batch.button[row] = sample.button ? 1 : 0;
+	}
+	if (batch.sensor)
+	{
+		batch.sensor[row] = sample.sensor;
+	}
+	if (batch.sequence)
+	{
+		batch.sequence[row] = sample.sequence;
+	}
+}
@@ -0,0 +1,80 @@
+/**
+ * sample_ring.hpp
+ *
+ * Lock-free single-producer single-consumer ring buffer of samples, used as
+ * a sink for ATC3DGTracker::subscribe(). The acquisition thread pushes,
+ * exactly one consumer thread pops. If the consumer falls behind, new
+ * samples are dropped and counted instead of blocking acquisition.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "sample.hpp"
+
+
+class SampleRing {
+public:
+	/**
+	 * \param capacity number of samples, rounded up to a power of two
+	 */
+	explicit SampleRing(size_t capacity = 1024) : m_head(0), m_tail(0), m_dropped(0)
+	{
+		size_t size = 2;
+		while (size < capacity)
+		{
+			size <<= 1;
+		}
+		m_buffer.resize(size);
+		m_mask = size - 1;
+	}
+
+	bool push(const Sample& sample)
+	{
+		size_t head = m_head.load(std::memory_order_relaxed);
+		if (head - m_tail.load(std::memory_order_acquire) > m_mask)
+		{
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		m_buffer[head & m_mask] = sample;
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(Sample& sample)
+	{
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail == m_head.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		sample = m_buffer[tail & m_mask];
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	size_t size() const
+	{
+		return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+	}
+
+	size_t capacity() const
+	{
+		return m_mask + 1;
+	}
+
+	uint64_t dropped() const
+	{
+		return m_dropped.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::vector<Sample> m_buffer;
+	size_t m_mask;
+	alignas(64) std::atomic<size_t> m_head;
+	alignas(64) std::atomic<size_t> m_tail;
+	std::atomic<uint64_t> m_dropped;
+};
@@ -0,0 +1,122 @@
+/**
+ * shm_segment.hpp
+ *
+ * What the shared memory segments of pose_shm.hpp and tracker_shm.hpp have
+ * in common: mapping a POSIX shared memory object and the seqlock that
+ * guards each slot. Header-only.
+ *
+ * A seqlock lets one writer update data in place without ever waiting for
+ * readers. The writer makes the sequence odd while it writes and even again
+ * when it is done, readers copy the data and retry if the sequence was odd
+ * or changed in between.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory needs lock-free 64 bit atomics");
+
+
+struct ShmSeqlock {
+	std::atomic<uint64_t> sequence;
+
+	/** Only one thread may write. */
+	void begin_write()
+	{
+		sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	void end_write()
+	{
+		sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	/**
+	 * Calls copy() until it ran while no write was in progress.
+	 * \return sequence the copy was taken at, 0 if nothing was written yet
+	 */
+	template <typename Copy>
+	uint64_t read(Copy copy) const
+	{
+		while (true)
+		{
+			uint64_t before = sequence.load(std::memory_order_acquire);
+			if (before & 1)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			copy();
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (sequence.load(std::memory_order_relaxed) == before)
+			{
+				return before;
+			}
+		}
+	}
+};
+
+
+/**
+ * Creates (or truncates) a shared memory object of size bytes and maps it
+ * writable, zeroed.
+ * \param name shared memory object name, e.g. "/atc3dg"
+ */
+inline void* shm_segment_create(const std::string& name, size_t size)
+{
+	int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+	if (fd < 0)
+	{
+		throw std::runtime_error("Could not create shared memory " + name + ".");
+	}
+	if (ftruncate(fd, size) < 0)
+	{
+		::close(fd);
+		throw std::runtime_error("Could not resize shared memory " + name + ".");
+	}
+	void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (memory == MAP_FAILED)
+	{
+		throw std::runtime_error("Could not map shared memory " + name + ".");
+	}
+	memset(memory, 0, size);
+	return memory;
+}
+
+/**
+ * Maps an existing shared memory object read-only.
+ * \return nullptr if there is no object of that name
+ */
+inline const void* shm_segment_open(const std::string& name, size_t size)
+{
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd < 0)
+	{
+		return nullptr;
+	}
+	void* memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (memory == MAP_FAILED)
+	{
+		throw std::runtime_error("Could not map shared memory " + name + ".");
+	}
+	return memory;
+}
+
+inline void shm_segment_close(const void* memory, size_t size)
+{
+	munmap(const_cast<void*>(memory), size);
+}
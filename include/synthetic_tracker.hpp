@@ -0,0 +1,94 @@
+/**
+ * synthetic_tracker.hpp
+ *
+ * Tracker without hardware for tests and load tests. It behaves like a
+ * connected ATC3DGTracker with any number of sensors and produces
+ * plausible motion: sinusoids, random walks, step changes and button
+ * presses, plus measurement noise. Trajectories depend only on the seed
+ * and the sample times.
+ */
+#pragma once
+
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "atc3dg.hpp"
+
+
+enum SyntheticMotion {
+	SYNTHETIC_STATIC,
+	SYNTHETIC_SINE,
+	SYNTHETIC_RANDOM_WALK,
+	SYNTHETIC_STEP,
+	// sine, random walk and steps on alternating sensors
+	SYNTHETIC_MIXED
+};
+
+struct SyntheticOptions {
+	int sensors = 4;
+	// Hz, up to several kHz
+	double rate = 80;
+	SyntheticMotion motion = SYNTHETIC_MIXED;
+	// standard deviation of the position noise in millimeters
+	double noise = 0.05;
+	// button presses per second and sensor
+	double button_rate = 0.2;
+	unsigned seed = 1;
+};
+
+/**
+ * \return motion named "static", "sine", "walk", "step" or "mixed"
+ */
+SyntheticMotion synthetic_motion(const std::string& name);
+
+
+class SyntheticTracker : public ATC3DGTracker {
+public:
+	explicit SyntheticTracker(const SyntheticOptions& options = SyntheticOptions());
+	virtual ~SyntheticTracker();
+
+	void connect() override;
+	void disconnect() override;
+	bool recover(int timeout = 5000) override;
+
+	int get_number_sensors() override;
+	std::vector<SensorInfo> get_topology() const override;
+	bool is_attached(int port) const override;
+	bool refresh_topology() override;
+
+	void set_rate(double rate) override;
+	double get_rate() const override;
+	double get_min_rate() const override;
+	double get_max_rate() const override;
+
+	bool good() const override;
+
+	/** sample of a sensor at the current time */
+	bool poll(int sensor, Sample& sample, unsigned fields = SAMPLE_ALL) override;
+	/** polls the sensors one after another, there is nothing to overlap */
+	size_t poll_all(const std::vector<int>& sensors, std::vector<Sample>& samples, unsigned fields = SAMPLE_ALL) override;
+
+	/**
+	 * Noise-free pose of a sensor at time t (seconds since connect()).
+	 * Random walks advance with every call.
+	 */
+	void pose(int sensor, double t, Sample& sample);
+
+private:
+	void p_pose(int sensor, double t, Sample& sample);
+
+	struct SensorState {
+		std::mt19937 random;
+		double walk[6];
+		double last_time;
+	};
+
+	SyntheticOptions m_options;
+	std::vector<SensorState> m_states;
+	double m_start;
+	bool m_connected;
+	uint64_t m_synthetic_sequence;
+	mutable std::mutex m_mutex;
+};
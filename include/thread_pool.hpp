@@ -0,0 +1,60 @@
+/**
+ * thread_pool.hpp
+ *
+ * Work-stealing thread pool for offline processing. Every worker owns a
+ * task queue; tasks are spread over the queues round-robin, workers take
+ * from the back of their own queue and steal from the front of the others
+ * when it runs empty, so a few long tasks do not leave cores idle.
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+class ThreadPool {
+public:
+	/**
+	 * \param threads number of workers, 0 for one per core
+	 */
+	explicit ThreadPool(int threads = 0);
+	ThreadPool(const ThreadPool&) = delete;
+	virtual ~ThreadPool();
+
+	/** tasks must not throw */
+	void submit(std::function<void()> task);
+	/** blocks until all submitted tasks have finished */
+	void wait();
+	int size() const;
+	/** tasks a worker took from another worker's queue */
+	uint64_t steals() const;
+
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	void p_work(int worker);
+	bool p_take(int worker, std::function<void()>& task);
+
+	std::vector<std::unique_ptr<Queue>> m_queues;
+	std::vector<std::thread> m_workers;
+	std::atomic<size_t> m_next_queue;
+	std::atomic<uint64_t> m_steals;
+
+	// waiting in a queue
+	size_t m_queued;
+	// submitted but not finished
+	size_t m_pending;
+	bool m_stopping;
+	std::mutex m_mutex;
+	std::condition_variable m_work;
+	std::condition_variable m_done;
+};
@@ -0,0 +1,246 @@
+/**
+ * tracker_shm.hpp
+ *
+ * Shared memory through which the tracker daemon (atcd) serves samples,
+ * topology and status to local processes (see ATC3DGClient). Header-only
+ * like pose_shm.hpp and built from the same parts (shm_segment.hpp):
+ * samples of all sensors go into one ring of seqlocked slots, the topology
+ * has a seqlock of its own, and readers never block the daemon.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "sample.hpp"
+#include "shm_segment.hpp"
+
+#define TRACKER_SHM_MAGIC 0x44435441 // "ATCD"
+#define TRACKER_SHM_VERSION 1
+#define TRACKER_SHM_HISTORY 256
+#define TRACKER_SHM_MAX_SENSORS 16
+#define TRACKER_SHM_STRING_LENGTH 32
+// default name of the daemon's segment
+#define TRACKER_SHM_NAME "/atcd"
+// seconds without a heartbeat after which the daemon counts as gone
+#define TRACKER_SHM_TIMEOUT 1.0
+
+
+struct TrackerShmSensor {
+	int32_t port;
+	uint32_t attached;
+	int32_t serial;
+	char model[TRACKER_SHM_STRING_LENGTH];
+	char part[TRACKER_SHM_STRING_LENGTH];
+};
+
+struct TrackerShmSlot {
+	ShmSeqlock lock;
+	// position of the sample in the stream of all sensors
+	uint64_t number;
+	Sample sample;
+};
+
+struct TrackerShmSegment {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t history;
+	uint32_t max_sensors;
+
+	// written by the daemon about every 100 ms, microseconds of atc3dg_time()
+	alignas(64) std::atomic<uint64_t> heartbeat;
+	std::atomic<uint32_t> good;
+	// tracker rate in mHz
+	std::atomic<uint32_t> rate;
+
+	alignas(64) ShmSeqlock topology_lock;
+	TrackerShmSensor sensors[TRACKER_SHM_MAX_SENSORS];
+
+	// number of samples published so far
+	alignas(64) std::atomic<uint64_t> published;
+	// per sensor, number of the latest sample plus one, 0 if none
+	std::atomic<uint64_t> latest[TRACKER_SHM_MAX_SENSORS];
+	alignas(64) TrackerShmSlot slots[TRACKER_SHM_HISTORY];
+};
+
+
+class TrackerShmWriter {
+public:
+	TrackerShmWriter() : m_segment(nullptr) {}
+	TrackerShmWriter(const TrackerShmWriter&) = delete;
+	virtual ~TrackerShmWriter() { close(); }
+
+	/**
+	 * \param name shared memory object name, TRACKER_SHM_NAME by default
+	 */
+	void open(const std::string& name = TRACKER_SHM_NAME)
+	{
+		close();
+		m_segment = static_cast<TrackerShmSegment*>(shm_segment_create(name, sizeof(TrackerShmSegment)));
+		m_name = name;
+		m_segment->history = TRACKER_SHM_HISTORY;
+		m_segment->max_sensors = TRACKER_SHM_MAX_SENSORS;
+		m_segment->version = TRACKER_SHM_VERSION;
+		std::atomic_thread_fence(std::memory_order_release);
+		// readers check the magic last
+		m_segment->magic = TRACKER_SHM_MAGIC;
+	}
+
+	void close()
+	{
+		if (m_segment)
+		{
+			m_segment->good.store(0, std::memory_order_release);
+			shm_segment_close(m_segment, sizeof(TrackerShmSegment));
+			shm_unlink(m_name.c_str());
+			m_segment = nullptr;
+		}
+	}
+
+	bool is_open() const
+	{
+		return m_segment != nullptr;
+	}
+
+	/** \param time see atc3dg_time() */
+	void set_status(bool good, double rate, double time)
+	{
+		m_segment->rate.store((uint32_t)(rate * 1000), std::memory_order_relaxed);
+		m_segment->good.store(good ? 1 : 0, std::memory_order_relaxed);
+		m_segment->heartbeat.store((uint64_t)(time * 1e6), std::memory_order_release);
+	}
+
+	/** sensors beyond TRACKER_SHM_MAX_SENSORS are left out */
+	void set_topology(const TrackerShmSensor* sensors, size_t count)
+	{
+		count = std::min<size_t>(count, TRACKER_SHM_MAX_SENSORS);
+		m_segment->topology_lock.begin_write();
+		memset(m_segment->sensors, 0, sizeof(m_segment->sensors));
+		for (size_t i = 0; i < TRACKER_SHM_MAX_SENSORS; i++)
+		{
+			m_segment->sensors[i].port = -1;
+		}
+		std::copy(sensors, sensors + count, m_segment->sensors);
+		m_segment->topology_lock.end_write();
+	}
+
+	/** Only one thread may publish. */
+	void publish(const Sample& sample)
+	{
+		uint64_t number = m_segment->published.load(std::memory_order_relaxed);
+		TrackerShmSlot& slot = m_segment->slots[number % TRACKER_SHM_HISTORY];
+		slot.lock.begin_write();
+		slot.number = number;
+		slot.sample = sample;
+		slot.lock.end_write();
+		if (sample.sensor >= 0 && sample.sensor < TRACKER_SHM_MAX_SENSORS)
+		{
+			m_segment->latest[sample.sensor].store(number + 1, std::memory_order_release);
+		}
+		m_segment->published.store(number + 1, std::memory_order_release);
+	}
+
+private:
+	std::string m_name;
+	TrackerShmSegment* m_segment;
+};
+
+
+class TrackerShmReader {
+public:
+	TrackerShmReader() : m_segment(nullptr) {}
+	TrackerShmReader(const TrackerShmReader&) = delete;
+	virtual ~TrackerShmReader() { close(); }
+
+	void open(const std::string& name = TRACKER_SHM_NAME)
+	{
+		close();
+		m_segment = static_cast<const TrackerShmSegment*>(shm_segment_open(name, sizeof(TrackerShmSegment)));
+		if (!m_segment)
+		{
+			throw std::runtime_error("No tracker daemon at " + name + ".");
+		}
+		if (m_segment->magic != TRACKER_SHM_MAGIC || m_segment->version != TRACKER_SHM_VERSION)
+		{
+			close();
+			throw std::runtime_error(name + " is not a tracker segment of a compatible version.");
+		}
+	}
+
+	void close()
+	{
+		if (m_segment)
+		{
+			shm_segment_close(m_segment, sizeof(TrackerShmSegment));
+			m_segment = nullptr;
+		}
+	}
+
+	bool is_open() const
+	{
+		return m_segment != nullptr;
+	}
+
+	/** \return seconds of atc3dg_time() of the last heartbeat */
+	double heartbeat() const
+	{
+		return m_segment->heartbeat.load(std::memory_order_acquire) * 1e-6;
+	}
+
+	bool good() const
+	{
+		return m_segment->good.load(std::memory_order_acquire) != 0;
+	}
+
+	double rate() const
+	{
+		return m_segment->rate.load(std::memory_order_acquire) / 1000.0;
+	}
+
+	/** copies all TRACKER_SHM_MAX_SENSORS entries, unused ones have port -1 */
+	void topology(TrackerShmSensor (&sensors)[TRACKER_SHM_MAX_SENSORS]) const
+	{
+		m_segment->topology_lock.read([&]() {
+			memcpy(sensors, m_segment->sensors, sizeof(sensors));
+		});
+	}
+
+	/** number of samples published so far */
+	uint64_t published() const
+	{
+		return m_segment->published.load(std::memory_order_acquire);
+	}
+
+	/** number of the latest sample of a sensor plus one, 0 if none */
+	uint64_t latest(int sensor) const
+	{
+		if (sensor < 0 || sensor >= TRACKER_SHM_MAX_SENSORS)
+		{
+			return 0;
+		}
+		return m_segment->latest[sensor].load(std::memory_order_acquire);
+	}
+
+	/**
+	 * Copies a sample that is still in the history.
+	 * \return false if the sample was not published yet or was overwritten
+	 */
+	bool read(uint64_t number, Sample& sample) const
+	{
+		const TrackerShmSlot& slot = m_segment->slots[number % TRACKER_SHM_HISTORY];
+		uint64_t slot_number = 0;
+		uint64_t sequence = slot.lock.read([&]() {
+			slot_number = slot.number;
+			memcpy(&sample, &slot.sample, sizeof(Sample));
+		});
+		return sequence != 0 && slot_number == number;
+	}
+
+private:
+	const TrackerShmSegment* m_segment;
+};
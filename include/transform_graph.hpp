@@ -0,0 +1,91 @@
+/**
+ * transform_graph.hpp
+ *
+ * Configurable graph of named transforms fed by trakSTAR sensors.
+ *
+ * A node is either a sensor (the pose reported on one tracker port), a fixed
+ * transform (a constant calibration, optionally attached to a parent node)
+ * or a relative transform (one node expressed in the frame of another).
+ * Nodes may only refer to nodes declared before them, so declaration order
+ * is also evaluation order. Derived nodes are cached and only recomputed
+ * when one of their inputs changed during the current frame, and are
+ * invalid while one of their inputs is.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "pose.hpp"
+
+// trakSTAR ports are 0-3, synthetic trackers have many more
+#define TRANSFORM_MAX_PORT 1023
+
+enum TransformNodeType {
+	TRANSFORM_SENSOR,
+	TRANSFORM_FIXED,
+	TRANSFORM_RELATIVE
+};
+
+struct TransformNode {
+	std::string name;
+	TransformNodeType type;
+	// tracker port, sensor nodes only
+	int port;
+	// parent of a fixed node, or source frame of a relative node (-1 if none)
+	int input;
+	// frame a relative node is expressed in
+	int reference;
+	// constant part of a fixed node
+	Pose offset;
+	// cached result
+	Pose value;
+	bool valid;
+	// value was updated during the current frame
+	bool changed;
+};
+
+
+class TransformGraph {
+public:
+	TransformGraph();
+
+	/**
+	 * Graph reproducing the classic setup: "Reference" on port 0, "Tool" on
+	 * port 1 and the derived "ToolToReference".
+	 */
+	static TransformGraph default_graph();
+
+	void load(const std::string& filename);
+	void parse(const std::string& text);
+
+	int add_sensor(const std::string& name, int port);
+	int add_fixed(const std::string& name, const Pose& offset, const std::string& parent = "");
+	int add_relative(const std::string& name, const std::string& from, const std::string& to);
+
+	void begin_frame();
+	void set_sensor(int port, const Pose& pose);
+	/**
+	 * Invalidates the nodes of a port, e.g. of an unplugged sensor;
+	 * evaluate() invalidates their dependents until the port is set again.
+	 */
+	void clear_sensor(int port);
+	void evaluate();
+
+	int find(const std::string& name) const;
+	int size() const;
+	const TransformNode& node(int index) const;
+	std::vector<int> ports() const;
+
+	/** number of derived nodes recomputed by the last evaluate() */
+	int evaluations() const;
+
+private:
+	int p_add(const TransformNode& node);
+	int p_lookup(const std::string& name) const;
+
+	std::vector<TransformNode> m_nodes;
+	// sensor nodes by port
+	std::vector<std::vector<int>> m_port_nodes;
+	int m_evaluations;
+};
@@ -0,0 +1,55 @@
+/**
+ * udp_sender.hpp
+ *
+ * Non-blocking UDP datagram sender for unicast and multicast destinations.
+ *
+ * Datagrams that cannot be sent immediately are dropped and counted; for
+ * real-time poses a newer frame will follow shortly anyway.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// largest UDP payload over IPv4
+#define UDP_MAX_DATAGRAM 65507
+
+
+class UdpSender {
+public:
+	UdpSender();
+	UdpSender(const UdpSender&) = delete;
+	virtual ~UdpSender();
+
+	/**
+	 * \param host IPv4 address or host name, multicast groups (224.0.0.0/4)
+	 * are detected automatically
+	 * \param port destination port
+	 * \param ttl time to live of multicast datagrams
+	 * \param interface IPv4 address of the interface to send multicast on,
+	 * default interface if empty
+	 */
+	void open(const std::string& host, int port, int ttl = 1, const std::string& interface = "");
+	void close();
+	bool is_open() const;
+	bool is_multicast() const;
+
+	/**
+	 * \param length at most UDP_MAX_DATAGRAM bytes, longer datagrams are
+	 * dropped
+	 * \return false if the datagram was dropped
+	 */
+	bool send(const void* data, size_t length);
+
+	uint64_t sent() const;
+	uint64_t dropped() const;
+
+private:
+	int m_socket;
+	bool m_multicast;
+	// struct sockaddr_in, kept opaque to avoid leaking socket headers
+	alignas(8) unsigned char m_address[16];
+	uint64_t m_sent;
+	uint64_t m_dropped;
+};
@@ -1,25 +1,44 @@
 #pragma once
 
+#include <type_traits>
+
 template <int N>
 class Vector
 {
 public:
-    Vector() {}
-    Vector(const float (&data)[N]) { fromArray(data); }
-    Vector(const Vector& other) { copy(other); }
-    virtual ~Vector() {}
+    constexpr Vector() : m_data{} {}
+    constexpr Vector(const float (&data)[N]) : m_data{} { fromArray(data); }
+    Vector(const Vector& other) = default;
+    Vector &operator=(const Vector &other) = default;
 
-    void fromArray(const float (&data)[N]);
-    void copy(const Vector<N> &other);
-    void toArray(float (&data)[N]);
+    constexpr void fromArray(const float (&data)[N]);
+    constexpr void copy(const Vector<N> &other) { *this = other; }
+    constexpr void toArray(float (&data)[N]) const;
 
-    float get(const int i);
-    void set(const int i, const float value);
+    constexpr float get(const int i) const;
+    constexpr void set(const int i, const float value);
+    constexpr float operator()(const int i) const { return m_data[i]; }
     float length() const;
+    constexpr float dot(const Vector &other) const;
+
+    constexpr Vector operator+(const Vector &other) const;
+    constexpr Vector operator-(const Vector &other) const;
+    constexpr Vector operator*(const float scalar) const;
+    constexpr Vector &operator+=(const Vector &other) { return *this = *this + other; }
+    constexpr Vector &operator-=(const Vector &other) { return *this = *this - other; }
+    constexpr Vector &operator*=(const float scalar) { return *this = *this * scalar; }
+
+    constexpr bool operator==(const Vector &other) const;
+    constexpr bool operator!=(const Vector &other) const { return !(*this == other); }
 
 protected:
-    float m_data[N];
+    alignas(16) float m_data[N];
 };
 
+template <int N>
+constexpr Vector<N> operator*(const float scalar, const Vector<N> &v) { return v * scalar; }
+
+static_assert(std::is_trivially_copyable<Vector<4>>::value, "Vector must be trivially copyable");
+
 
-#include "vector.tpp"
\ No newline at end of file
+#include "vector.tpp"
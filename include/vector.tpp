@@ -1,7 +1,7 @@
 #include <cmath>
 
 template <int N>
-void Vector<N>::fromArray(const float (&data)[N])
+constexpr void Vector<N>::fromArray(const float (&data)[N])
 {
     for (int i = 0; i < N; i++)
     {
@@ -10,16 +10,7 @@ void Vector<N>::fromArray(const float (&data)[N])
 }
 
 template <int N>
-void Vector<N>::copy(const Vector<N> &other)
-{
-    for (int i = 0; i < N; i++)
-    {
-        m_data[i] = other.m_data[i];
-    }
-}
-
-template <int N>
-void Vector<N>::toArray(float (&data)[N])
+constexpr void Vector<N>::toArray(float (&data)[N]) const
 {
     for (int i = 0; i < N; i++)
     {
@@ -28,14 +19,14 @@ void Vector<N>::toArray(float (&data)[N])
 }
 
 template <int N>
-float Vector<N>::get(const int i)
+constexpr float Vector<N>::get(const int i) const
 {
     // TODO assert wrong index
     return m_data[i];
 }
 
 template <int N>
-void Vector<N>::set(const int i, const float value)
+constexpr void Vector<N>::set(const int i, const float value)
 {
     m_data[i] = value;
 }
@@ -49,4 +40,61 @@ float Vector<N>::length() const
         l += m_data[i] * m_data[i];
     }
     return std::sqrt(l);
-}
\ No newline at end of file
+}
+
+template <int N>
+constexpr float Vector<N>::dot(const Vector<N> &other) const
+{
+    float d = 0;
+    for (int i = 0; i < N; i++)
+    {
+        d += m_data[i] * other.m_data[i];
+    }
+    return d;
+}
+
+template <int N>
+constexpr Vector<N> Vector<N>::operator+(const Vector<N> &other) const
+{
+    Vector<N> result;
+    for (int i = 0; i < N; i++)
+    {
+        result.m_data[i] = m_data[i] + other.m_data[i];
+    }
+    return result;
+}
+
+template <int N>
+constexpr Vector<N> Vector<N>::operator-(const Vector<N> &other) const
+{
+    Vector<N> result;
+    for (int i = 0; i < N; i++)
+    {
+        result.m_data[i] = m_data[i] - other.m_data[i];
+    }
+    return result;
+}
+
+template <int N>
+constexpr Vector<N> Vector<N>::operator*(const float scalar) const
+{
+    Vector<N> result;
+    for (int i = 0; i < N; i++)
+    {
+        result.m_data[i] = m_data[i] * scalar;
+    }
+    return result;
+}
+
+template <int N>
+constexpr bool Vector<N>::operator==(const Vector<N> &other) const
+{
+    for (int i = 0; i < N; i++)
+    {
+        if (m_data[i] != other.m_data[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
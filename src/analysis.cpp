@@ -0,0 +1,285 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#include <nlohmann/json.hpp>
+
+#include "analysis.hpp"
+#include "pose_log.hpp"
+#include "recording.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+
+// value at fraction p of a sorted vector
+double percentile(const std::vector<double>& sorted, double p)
+{
+	if (sorted.empty())
+	{
+		return 0;
+	}
+	size_t index = (size_t)std::lround(p * (sorted.size() - 1));
+	return sorted[index];
+}
+
+SensorSummary summarize_sensor(int sensor, const std::vector<const Sample*>& samples, double gap_factor)
+{
+	SensorSummary summary = {};
+	summary.sensor = sensor;
+	summary.samples = samples.size();
+
+	std::vector<double> intervals;
+	std::vector<double> quality;
+	bool pressed = false;
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		const Sample& sample = *samples[i];
+		if (i > 0)
+		{
+			intervals.push_back(sample.timestamp - samples[i - 1]->timestamp);
+		}
+		if (sample.fields & SAMPLE_QUALITY)
+		{
+			quality.push_back(sample.quality);
+		}
+		if (sample.fields & SAMPLE_BUTTON)
+		{
+			if (sample.button && !pressed)
+			{
+				summary.button_presses++;
+			}
+			pressed = sample.button;
+		}
+	}
+
+	if (!intervals.empty())
+	{
+		summary.duration = samples.back()->timestamp - samples.front()->timestamp;
+		summary.rate = summary.duration > 0 ? intervals.size() / summary.duration : 0;
+		summary.mean_interval = summary.duration / intervals.size();
+
+		double squares = 0;
+		for (double interval : intervals)
+		{
+			double deviation = interval - summary.mean_interval;
+			squares += deviation * deviation;
+		}
+		summary.jitter = std::sqrt(squares / intervals.size());
+
+		std::sort(intervals.begin(), intervals.end());
+		summary.median_interval = percentile(intervals, 0.5);
+		summary.max_interval = intervals.back();
+		for (auto it = intervals.rbegin(); it != intervals.rend() && *it > gap_factor * summary.median_interval; ++it)
+		{
+			summary.gaps++;
+			summary.gap_time += *it - summary.median_interval;
+		}
+	}
+
+	if (!quality.empty())
+	{
+		std::sort(quality.begin(), quality.end());
+		double sum = 0;
+		for (double q : quality)
+		{
+			sum += q;
+		}
+		summary.quality_samples = quality.size();
+		summary.quality_min = quality.front();
+		summary.quality_mean = sum / quality.size();
+		summary.quality_p50 = percentile(quality, 0.5);
+		summary.quality_p95 = percentile(quality, 0.95);
+		summary.quality_max = quality.back();
+	}
+	return summary;
+}
+
+json sensor_to_json(const SensorSummary& s)
+{
+	return {
+		{"sensor", s.sensor},
+		{"samples", s.samples},
+		{"duration", s.duration},
+		{"rate", s.rate},
+		{"interval", {
+			{"mean", s.mean_interval},
+			{"median", s.median_interval},
+			{"jitter", s.jitter},
+			{"max", s.max_interval}
+		}},
+		{"gaps", s.gaps},
+		{"gap_time", s.gap_time},
+		{"button_presses", s.button_presses},
+		{"quality", {
+			{"samples", s.quality_samples},
+			{"min", s.quality_min},
+			{"mean", s.quality_mean},
+			{"p50", s.quality_p50},
+			{"p95", s.quality_p95},
+			{"max", s.quality_max}
+		}}
+	};
+}
+
+std::string csv_escape(const std::string& value)
+{
+	if (value.find_first_of(",\"\n") == std::string::npos)
+	{
+		return value;
+	}
+	std::string escaped = "\"";
+	for (char c : value)
+	{
+		escaped += c == '"' ? "\"\"" : std::string(1, c);
+	}
+	return escaped + "\"";
+}
+
+}
+
+SessionSummary summarize_samples(const std::vector<Sample>& samples, double gap_factor)
+{
+	SessionSummary summary = {};
+	summary.samples = samples.size();
+	if (!samples.empty())
+	{
+		summary.start = samples.front().timestamp;
+		summary.duration = samples.back().timestamp - samples.front().timestamp;
+	}
+
+	std::map<int, std::vector<const Sample*>> by_sensor;
+	for (const auto& sample : samples)
+	{
+		by_sensor[sample.sensor].push_back(&sample);
+	}
+	for (const auto& it : by_sensor)
+	{
+		summary.sensors.push_back(summarize_sensor(it.first, it.second, gap_factor));
+	}
+	return summary;
+}
+
+std::string read_capture(const std::string& filename, std::vector<Sample>& samples, int threads, double* clock_offset)
+{
+	char magic[8] = {0};
+	FILE* file = fopen(filename.c_str(), "rb");
+	if (file)
+	{
+		if (fread(magic, sizeof(magic), 1, file) != 1)
+		{
+			magic[0] = 0;
+		}
+		fclose(file);
+	}
+
+	samples.clear();
+	if (memcmp(magic, POSE_LOG_MAGIC, 8) == 0)
+	{
+		PoseLogReader reader;
+		reader.open(filename);
+		reader.read_all(samples, threads);
+		if (clock_offset)
+		{
+			*clock_offset = reader.clock_offset();
+		}
+		return "pose log";
+	}
+	if (memcmp(magic, RECORDING_MAGIC, 8) == 0)
+	{
+		RecordingReader reader;
+		reader.open(filename);
+		samples.resize(reader.size());
+		size_t n = 0;
+		while (n < samples.size() && reader.read(samples[n]))
+		{
+			n++;
+		}
+		samples.resize(n);
+		if (clock_offset)
+		{
+			*clock_offset = reader.clock_offset();
+		}
+		return "raw";
+	}
+	throw std::runtime_error(file ? "Unknown capture format." : "Could not open file.");
+}
+
+SessionSummary summarize_file(const std::string& filename, double gap_factor)
+{
+	SessionSummary summary = {};
+	try
+	{
+		std::vector<Sample> samples;
+		// files are already processed in parallel
+		double clock_offset = 0;
+		std::string format = read_capture(filename, samples, 1, &clock_offset);
+		summary = summarize_samples(samples, gap_factor);
+		summary.format = format;
+		if (summary.samples > 0)
+		{
+			summary.start += clock_offset;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		summary.error = e.what();
+	}
+	summary.file = filename;
+	return summary;
+}
+
+std::string sessions_to_json(const std::vector<SessionSummary>& sessions)
+{
+	json result = json::array();
+	for (const auto& session : sessions)
+	{
+		json entry = {
+			{"file", session.file},
+			{"format", session.format},
+			{"samples", session.samples},
+			{"start", session.start},
+			{"duration", session.duration},
+			{"sensors", json::array()}
+		};
+		if (!session.error.empty())
+		{
+			entry["error"] = session.error;
+		}
+		for (const auto& sensor : session.sensors)
+		{
+			entry["sensors"].push_back(sensor_to_json(sensor));
+		}
+		result.push_back(entry);
+	}
+	return result.dump(2) + "\n";
+}
+
+std::string sessions_to_csv(const std::vector<SessionSummary>& sessions)
+{
+	std::stringstream csv;
+	csv.precision(9);
+	csv << "file,format,sensor,samples,duration,rate,mean_interval,median_interval,jitter,max_interval,"
+		<< "gaps,gap_time,button_presses,quality_samples,quality_min,quality_mean,quality_p50,quality_p95,quality_max,error\n";
+	for (const auto& session : sessions)
+	{
+		if (session.sensors.empty())
+		{
+			csv << csv_escape(session.file) << "," << session.format << ",,,,,,,,,,,,,,,,,," << csv_escape(session.error) << "\n";
+		}
+		for (const auto& s : session.sensors)
+		{
+			csv << csv_escape(session.file) << "," << session.format << "," << s.sensor << "," << s.samples << ","
+				<< s.duration << "," << s.rate << "," << s.mean_interval << "," << s.median_interval << ","
+				<< s.jitter << "," << s.max_interval << "," << s.gaps << "," << s.gap_time << ","
+				<< s.button_presses << "," << s.quality_samples << "," << s.quality_min << ","
+				<< s.quality_mean << "," << s.quality_p50 << "," << s.quality_p95 << "," << s.quality_max << ","
+				<< csv_escape(session.error) << "\n";
+		}
+	}
+	return csv.str();
+}
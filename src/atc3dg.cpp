@@ -1,4 +1,7 @@
+#include <algorithm>
+#include <cerrno>
 #include <chrono>
+#include <deque>
 #include <exception>
 #include <thread>
 #include <sstream>
@@ -17,49 +20,1034 @@ void log_debug(std::string string)
 #endif
 }
 
+double atc3dg_time()
+{
+	auto now = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration<double>(now).count();
+}
+
+double atc3dg_wall_time(double time)
+{
+	static const double offset = std::chrono::duration<double>(
+		std::chrono::system_clock::now().time_since_epoch()).count() - atc3dg_time();
+	return time + offset;
+}
+
+int atc3dg_parameter_size(int parameter)
+{
+	switch (parameter)
+	{
+	case ATC_RATE_COUNT:
+	case ATC_DATA_READY:
+	case ATC_DATA_READY_CHAR:
+	case ATC_ERROR_CODE:
+	case ATC_SUDDENCHANGE:
+	case ATC_REFERENCE_FRAME:
+	case ATC_TX_MODE:
+	case ATC_ADDRESS_MODE:
+	case ATC_ADDRESS:
+	case ATC_GROUP_MODE:
+		return 1;
+	case ATC_STATUS:
+	case ATC_REVISION:
+	case ATC_SPEED:
+	case ATC_POSITION_SCALING:
+	case ATC_FILTER:
+	case ATC_RATE:
+	case ATC_ERROR_BEHAVIOR:
+	case ATC_SYSTEM_ERROR:
+	case ATC_HEMISPHERE:
+	case ATC_SERIAL_NUMBER:
+	case ATC_RX_SERIAL_NUMBER:
+	case ATC_TX_SERIAL_NUMBER:
+	case ATC_DELAY:
+	case ATC_TRACKER_STATUS:
+		return 2;
+	case ATC_AUTOCONFIG:
+		return 5;
+	case ATC_ANGLE_ALIGN2:
+	case ATC_REFERENCE_FRAME2:
+		return 6;
+	case ATC_IDENTIFICATION:
+		return 10;
+	case ATC_DC_ALPHA_MIN:
+	case ATC_DC_VM:
+	case ATC_DC_ALPHA_MAX:
+		return 14;
+	case ATC_ROM:
+		return 64;
+	default:
+		return 0;
+	}
+}
+
+int ParameterValue::word(int index) const
+{
+	size_t i = index * 2;
+	if (i + 1 >= bytes.size())
+	{
+		throw std::runtime_error("Parameter value has no word " + std::to_string(index) + ".");
+	}
+	return bytes[i] | (bytes[i + 1] << 8);
+}
+
+double ParameterValue::fixed(int index) const
+{
+	return word(index) / 256.0;
+}
+
+std::string ParameterValue::text() const
+{
+	std::string text;
+	for (unsigned char c : bytes)
+	{
+		if (c >= ' ')
+		{
+			text += (char)c;
+		}
+	}
+	return text;
+}
+
+size_t ParameterBatch::examine(int parameter, int unit, int size)
+{
+	if (size <= 0)
+	{
+		size = atc3dg_parameter_size(parameter);
+	}
+	if (size <= 0)
+	{
+		throw std::runtime_error("Response size of parameter " + std::to_string(parameter) + " is unknown.");
+	}
+
+	Operation operation = {{ATC_CMD_EXAMINE, parameter}, size, m_values.size(), true};
+	if (unit >= 0)
+	{
+		operation.request.insert(operation.request.begin(), 0xF1 + unit);
+	}
+	m_operations.push_back(operation);
+	m_values.emplace_back();
+	return m_values.size() - 1;
+}
+
+void ParameterBatch::change(int parameter, const std::vector<int>& value, int unit)
+{
+	Operation operation = {{ATC_CMD_CHANGE, parameter}, 0, 0, false};
+	if (unit >= 0)
+	{
+		operation.request.insert(operation.request.begin(), 0xF1 + unit);
+	}
+	operation.request.insert(operation.request.end(), value.begin(), value.end());
+	m_operations.push_back(operation);
+}
+
+void ParameterBatch::change_word(int parameter, int value, int unit)
+{
+	change(parameter, {value & 0xFF, (value >> 8) & 0xFF}, unit);
+}
+
+size_t ParameterBatch::model_string(ATC3DGComponent component, int port)
+{
+	return p_string(component, port, 0x0A, 11);
+}
+
+size_t ParameterBatch::part_number(ATC3DGComponent component, int port)
+{
+	return p_string(component, port, 0x70, 15);
+}
+
+/**
+ * Identification strings are read one character per request, the
+ * requests of a string are pipelined like all others.
+ */
+size_t ParameterBatch::p_string(ATC3DGComponent component, int port, int offset, int length)
+{
+	size_t value = m_values.size();
+	m_values.emplace_back();
+	for (int b = 0; b < length; b++)
+	{
+		Operation operation = {{ATC_CMD_MODELSTRING, offset + b, component}, 1, value, b == length - 1};
+		// only receivers are addressed
+		if (component == ATC_COMPONENT_RX)
+		{
+			operation.request.insert(operation.request.begin(), 0xF1 + port);
+		}
+		m_operations.push_back(operation);
+	}
+	return value;
+}
+
+size_t ParameterBatch::size() const
+{
+	return m_values.size();
+}
+
+const ParameterValue& ParameterBatch::operator[](size_t index) const
+{
+	return m_values.at(index);
+}
+
+void ParameterBatch::clear()
+{
+	m_operations.clear();
+	m_values.clear();
+}
+
 ATC3DGTracker::ATC3DGTracker() : m_scaling(1),
 								 m_rate(80),
-								 m_good(false)
+								 m_timestamp(0),
+								 m_good(false),
+								 m_sequence(0),
+								 m_next_subscriber(0),
+								 m_acquiring(false),
+								 m_auto_recover(true),
+								 m_needs_init(true),
+								 m_rate_set(false),
+								 m_outage_start(0),
+								 m_stats(),
+								 m_transaction_budget(USB_TIMEOUT),
+								 m_pipeline_depth(ATC_PIPELINE_DEPTH),
+								 m_consecutive_errors(0),
+								 m_stale(false),
+								 m_tracker_status(-1),
+								 m_adaptive(false),
+								 m_history(nullptr),
+								 m_device(nullptr),
+								 m_handle(nullptr)
+{
+	for (int port = 0; port < ATC_MAX_SENSORS; port++)
+	{
+		m_topology[port].port = port;
+		m_topology[port].attached = false;
+		m_topology[port].serial = 0;
+	}
+}
+
+ATC3DGTracker::~ATC3DGTracker()
+{
+	stop();
+	if (m_good)
+	{
+		disconnect();
+	}
+}
+
+void ATC3DGTracker::connect()
+{
+	log_debug("connecting to ATC 3D Guidance tracker");
+	usb_init();
+	usb_find_busses();
+	usb_find_devices();
+
+	m_device = p_find_device();
+	if (m_device == nullptr)
+	{
+		throw std::runtime_error("Could not find USB device.");
+	}
+
+	p_open();
+
+	log_debug("Initializing trakSTAR unit...");
+	atc_init();
+	log_debug("Connected to trakSTAR 3D Guidance tracker.");
+	m_needs_init = false;
+	m_good = true;
+}
+
+bool ATC3DGTracker::recover(int timeout)
 {
+	std::lock_guard<std::recursive_mutex> lock(m_io_mutex);
+	if (m_good)
+	{
+		return true;
+	}
+	if (m_outage_start <= 0)
+	{
+		m_outage_start = atc3dg_time();
+	}
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+	p_close();
+
+	while (std::chrono::steady_clock::now() < deadline)
+	{
+		// libusb 0.1 has no hot-plug events, rescan the bus instead
+		usb_find_busses();
+		usb_find_devices();
+		m_device = p_find_device();
+		if (m_device == nullptr)
+		{
+			// unplugged or power cycled, the unit lost its configuration
+			m_needs_init = true;
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			continue;
+		}
+
+		try
+		{
+			p_open();
+			if (m_needs_init || !p_reconfigure())
+			{
+				log_debug("Tracker lost its configuration, reinitializing...");
+				atc_init();
+				if (m_rate_set)
+				{
+					set_rate(m_rate);
+				}
+				m_stats.reinitializations++;
+			}
+		}
+		catch (const std::exception& e)
+		{
+			log_debug(std::string("Recovery attempt failed: ") + e.what());
+			p_close();
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			continue;
+		}
+
+		double outage = atc3dg_time() - m_outage_start;
+		m_outage_start = 0;
+		m_needs_init = false;
+		m_stats.recoveries++;
+		m_stats.last_outage = outage;
+		m_stats.total_outage += outage;
+		if (outage > m_stats.max_outage)
+		{
+			m_stats.max_outage = outage;
+		}
+		m_good = true;
+		return true;
+	}
+
+	return false;
+}
+
+void ATC3DGTracker::set_auto_recover(bool enabled)
+{
+	m_auto_recover = enabled;
+}
+
+ATC3DGStats ATC3DGTracker::get_stats() const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_io_mutex);
+	return m_stats;
+}
+
+void ATC3DGTracker::set_transaction_budget(int milliseconds)
+{
+	m_transaction_budget = milliseconds < 1 ? 1 : milliseconds;
+}
+
+int ATC3DGTracker::get_transaction_budget() const
+{
+	return m_transaction_budget;
+}
+
+void ATC3DGTracker::set_pipeline_depth(int depth)
+{
+	m_pipeline_depth = std::min(std::max(depth, 1), ATC_MAX_SENSORS);
+}
+
+int ATC3DGTracker::get_pipeline_depth() const
+{
+	return m_pipeline_depth;
+}
+
+void ATC3DGTracker::disconnect()
+{
+	stop();
+	std::lock_guard<std::recursive_mutex> lock(m_io_mutex);
+	m_good = false;
+	if (!m_handle)
+	{
+		return;
+	}
+	log_debug("Disconnecting trakSTAR 3D Guidance tracker...");
+	atc_select_tx(0xFF);
+	p_write({0x3F});
+	p_write({0x3F});
+	p_write({0xF1, ATC_CMD_CHANGE, ATC_GROUP_MODE, 0x00});
+	p_write({ATC_CMD_CHANGE, 0x94, 0x01});
+	atc_sleep(0);
+	p_close();
+}
+
+void ATC3DGTracker::execute(ParameterBatch& batch)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_io_mutex);
+	for (auto& value : batch.m_values)
+	{
+		value.ok = false;
+		value.bytes.clear();
+	}
+
+	// reads in flight, oldest first; responses arrive in request order
+	std::deque<const ParameterBatch::Operation*> outstanding;
+	int depth = m_pipeline_depth > 1 ? ATC_BATCH_DEPTH : 1;
+	size_t next = 0;
+	const auto& operations = batch.m_operations;
+	while (next < operations.size() || !outstanding.empty())
+	{
+		while (next < operations.size() && (int)outstanding.size() < depth)
+		{
+			const ParameterBatch::Operation& operation = operations[next++];
+			p_write(operation.request);
+			if (operation.response > 0)
+			{
+				outstanding.push_back(&operation);
+			}
+		}
+		if (outstanding.empty())
+		{
+			continue;
+		}
+
+		const ParameterBatch::Operation& operation = *outstanding.front();
+		ParameterValue& value = batch.m_values[operation.value];
+		Deadline deadline = p_deadline();
+		// long responses arrive in packets of 32 bytes
+		for (int offset = 0; offset < operation.response; offset += 32)
+		{
+			int bytes = std::min(operation.response - offset, 32);
+			p_read(bytes, deadline);
+			value.bytes.insert(value.bytes.end(), m_input_buf, m_input_buf + bytes);
+		}
+		value.ok = operation.last;
+		outstanding.pop_front();
+	}
+}
+
+ParameterValue ATC3DGTracker::examine(int parameter, int unit, int size)
+{
+	ParameterBatch batch;
+	batch.examine(parameter, unit, size);
+	execute(batch);
+	return batch[0];
+}
+
+int ATC3DGTracker::get_number_sensors()
+{
+	std::lock_guard<std::recursive_mutex> lock(m_io_mutex);
+	int n_sensors = 0;
+	for (const auto& info : m_topology)
+	{
+		if (info.attached)
+		{
+			n_sensors++;
+		}
+	}
+	return n_sensors;
+}
+
+std::vector<SensorInfo> ATC3DGTracker::get_topology() const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_io_mutex);
+	return std::vector<SensorInfo>(m_topology, m_topology + ATC_MAX_SENSORS);
+}
+
+bool ATC3DGTracker::is_attached(int port) const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_io_mutex);
+	return port >= 0 && port < ATC_MAX_SENSORS && m_topology[port].attached;
+}
+
+bool ATC3DGTracker::refresh_topology()
+{
+	std::vector<SensorInfo> changed;
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_io_mutex);
+		if (!m_good)
+		{
+			return false;
+		}
+
+		// the status word changes when sensors are plugged or unplugged,
+		// only then are the ports probed again
+		int status = examine(ATC_TRACKER_STATUS).word();
+		if (status == m_tracker_status)
+		{
+			return false;
+		}
+		m_tracker_status = status;
+
+		SensorInfo before[ATC_MAX_SENSORS];
+		std::copy(m_topology, m_topology + ATC_MAX_SENSORS, before);
+		p_probe_sensors();
+		for (int port = 0; port < ATC_MAX_SENSORS; port++)
+		{
+			if (before[port].attached != m_topology[port].attached || before[port].serial != m_topology[port].serial)
+			{
+				changed.push_back(m_topology[port]);
+			}
+		}
+	}
+
+	p_report_topology(changed);
+	return !changed.empty();
+}
+
+void ATC3DGTracker::p_report_topology(const std::vector<SensorInfo>& changed)
+{
+	TopologyCallback callback;
+	{
+		std::lock_guard<std::mutex> lock(m_subscriber_mutex);
+		callback = m_topology_callback;
+	}
+	if (callback)
+	{
+		for (const auto& info : changed)
+		{
+			callback(info);
+		}
+	}
+}
+
+void ATC3DGTracker::set_raw_history(RawHistory* history)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_io_mutex);
+	m_history = history;
+}
+
+void ATC3DGTracker::set_topology_callback(TopologyCallback callback)
+{
+	std::lock_guard<std::mutex> lock(m_subscriber_mutex);
+	m_topology_callback = callback;
+}
+
+int16_t ATC3DGTracker::p_get_word(int byte1, int byte2)
+{
+	if (byte2 < 0) {
+		byte2 = byte1 + 1;
+	}
+	
+	return ((m_input_buf[byte2] << 7) | (m_input_buf[byte1] & 0x7F)) << 2;
+}
+
+void ATC3DGTracker::update(
+	int sensor,
+	double &x, double &y, double &z,
+	double &ax, double &ay, double &az,
+	double (&matrix)[3][3],
+	double &q0, double &qi, double &qj, double &qk,
+	double &quality,
+	bool &button)
+{
+	Sample sample;
+	if (!poll(sensor, sample, SAMPLE_ALL))
+	{
+		return;
+	}
+
+	x = sample.position[0];
+	y = sample.position[1];
+	z = sample.position[2];
+
+	ax = sample.angles[0];
+	ay = sample.angles[1];
+	az = sample.angles[2];
+
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			matrix[i][j] = sample.matrix[i][j];
+		}
+	}
+
+	q0 = sample.quaternion[0];
+	qi = sample.quaternion[1];
+	qj = sample.quaternion[2];
+	qk = sample.quaternion[3];
+
+	quality = sample.quality;
+	button = sample.button;
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+}
+
+void ATC3DGTracker::update(
+	int sensor,
+	double *position,
+	double *orientation,
+	double (&matrix)[3][3],
+	double *quaternion,
+	double *quality,
+	bool *button)
+{
+	this->update(
+		sensor,
+		position[0], position[1], position[2],
+		orientation[0], orientation[1], orientation[2],
+		matrix,
+		quaternion[0], quaternion[1], quaternion[2], quaternion[3],
+		*quality,
+		*button);
+}
+
+bool ATC3DGTracker::poll(int sensor, Sample& sample, unsigned fields)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_io_mutex);
+	if (!m_good)
+	{
+		return false;
+	}
+
+	// request and response share one budget
+	Deadline deadline = p_deadline();
+	sample.request_time = atc3dg_time();
+	try
+	{
+		p_write({0xF1 + sensor, ATC_CMD_POINT}, deadline);
+		p_read(53, deadline);
+		if (!(m_input_buf[0] & 0x80))
+		{
+			p_resync(53, deadline);
+		}
+	}
+	catch (const ATC3DGError& e)
+	{
+		if (!m_good)
+		{
+			throw;
+		}
+		log_debug(std::string("Record lost: ") + e.what());
+		m_stats.dropped_records++;
+		return false;
+	}
+	sample.timestamp = atc3dg_time();
+	m_timestamp = sample.timestamp;
+
+	p_decode(sensor, sample, fields);
+	return true;
+}
+
+size_t ATC3DGTracker::poll_all(const std::vector<int>& sensors, std::vector<Sample>& samples, unsigned fields)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_io_mutex);
+	samples.clear();
+	if (!m_good)
+	{
+		return 0;
+	}
+
+	// addresses and request times of the requests in flight, oldest first
+	std::deque<std::pair<int, double>> outstanding;
+	size_t next = 0;
+	int depth = m_pipeline_depth;
+	try
+	{
+		while (next < sensors.size() || !outstanding.empty())
+		{
+			while (next < sensors.size() && (int)outstanding.size() < depth)
+			{
+				outstanding.push_back({sensors[next], atc3dg_time()});
+				p_write({0xF1 + sensors[next], ATC_CMD_POINT});
+				next++;
+			}
+
+			Deadline deadline = p_deadline();
+			p_read(53, deadline);
+			if (!(m_input_buf[0] & 0x80))
+			{
+				p_resync(53, deadline);
+			}
+
+			Sample sample;
+			sample.request_time = outstanding.front().second;
+			sample.timestamp = atc3dg_time();
+			m_timestamp = sample.timestamp;
+			p_decode(outstanding.front().first, sample, fields);
+			outstanding.pop_front();
+			samples.push_back(sample);
+		}
+	}
+	catch (const ATC3DGError& e)
+	{
+		if (!m_good)
+		{
+			throw;
+		}
+		// responses still in flight are drained before the next request,
+		// sensors not requested yet get no record this time either
+		log_debug(std::string("Record lost: ") + e.what());
+		m_stats.dropped_records += outstanding.size() + (sensors.size() - next);
+	}
+	return samples.size();
+}
+
+size_t ATC3DGTracker::read_batch(const int* sensors, int n_sensors, size_t n, const SampleBatch& batch)
+{
+	unsigned fields = sample_batch_fields(batch);
+	auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<double>(1.0 / get_rate()));
+	auto next = std::chrono::steady_clock::now();
+
+	std::vector<int> list(sensors, sensors + n_sensors);
+	std::vector<Sample> samples;
+	Sample sample;
+	size_t row = 0;
+	try
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			poll_all(list, samples, fields);
+			for (int k = 0; k < n_sensors; k++)
+			{
+				if (k < (int)samples.size())
+				{
+					sample_batch_store(batch, row++, samples[k]);
+					continue;
+				}
+				// the records after a lost one are requested again, for
+				// at most one transaction budget
+				Deadline deadline = p_deadline();
+				while (!poll(sensors[k], sample, fields))
+				{
+					if (!m_good || std::chrono::steady_clock::now() >= deadline)
+					{
+						return row;
+					}
+				}
+				sample_batch_store(batch, row++, sample);
+			}
+
+			if (i + 1 < n)
+			{
+				next += period;
+				std::this_thread::sleep_until(next);
+			}
+		}
+	}
+	catch (const ATC3DGError& e)
+	{
+		// the tracker went offline, the rows written so far are kept
+		log_debug(std::string("Batch ended: ") + e.what());
+	}
+	return row;
+}
+
+int ATC3DGTracker::subscribe(SampleCallback callback, unsigned fields, int sensor)
+{
+	std::lock_guard<std::mutex> lock(m_subscriber_mutex);
+	int id = m_next_subscriber++;
+	m_subscribers.push_back({id, fields, sensor, std::make_shared<const SampleCallback>(std::move(callback))});
+	return id;
+}
+
+int ATC3DGTracker::subscribe(SampleRing& ring, unsigned fields, int sensor)
+{
+	SampleRing* sink = &ring;
+	return subscribe([sink](const Sample& sample) { sink->push(sample); }, fields, sensor);
+}
+
+void ATC3DGTracker::unsubscribe(int id)
+{
+	std::lock_guard<std::mutex> lock(m_subscriber_mutex);
+	for (auto it = m_subscribers.begin(); it != m_subscribers.end(); ++it)
+	{
+		if (it->id == id)
+		{
+			m_subscribers.erase(it);
+			break;
+		}
+	}
+}
+
+void ATC3DGTracker::start(const std::vector<int>& sensors)
+{
+	if (m_acquiring)
+	{
+		return;
+	}
+	if (m_thread.joinable())
+	{
+		// acquisition ended on its own after an error
+		m_thread.join();
+	}
+
+	std::vector<int> polled = sensors;
+	if (polled.empty())
+	{
+		for (const auto& info : get_topology())
+		{
+			polled.push_back(info.port);
+		}
+	}
+
+	m_acquiring = true;
+	m_thread = std::thread(&ATC3DGTracker::p_acquire, this, polled);
+}
+
+void ATC3DGTracker::stop()
+{
+	m_acquiring = false;
+	if (m_thread.joinable() && m_thread.get_id() != std::this_thread::get_id())
+	{
+		m_thread.join();
+	}
+}
+
+bool ATC3DGTracker::acquiring() const
+{
+	return m_acquiring;
+}
+
+void ATC3DGTracker::set_adaptive_polling(bool enabled, const SchedulerOptions& options)
+{
+	std::lock_guard<std::mutex> lock(m_scheduler_mutex);
+	m_adaptive = enabled;
+	m_scheduler.set_options(options);
+}
+
+std::vector<SensorSchedule> ATC3DGTracker::get_schedule() const
+{
+	std::lock_guard<std::mutex> lock(m_scheduler_mutex);
+	return m_scheduler.get_schedule();
+}
+
+void ATC3DGTracker::set_realtime(const RealtimeOptions& options)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_io_mutex);
+	m_realtime = options;
+}
+
+std::vector<std::string> ATC3DGTracker::get_realtime_errors() const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_io_mutex);
+	return m_realtime_errors;
+}
+
+GapStats ATC3DGTracker::get_gap_stats() const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_io_mutex);
+	return m_gap_stats;
+}
+
+void ATC3DGTracker::set_rate(double rate)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_io_mutex);
+	if (rate >= get_min_rate() && rate <= get_max_rate())
+	{
+		m_rate = rate;
+		m_rate_set = true;
+		short s_rate = (short)(rate * 256);
+		p_write({ATC_CMD_CHANGE, ATC_RATE, s_rate & 0xFF, s_rate >> 8});
+	}
+}
+
+double ATC3DGTracker::get_rate() const
+{
+	return m_rate;
+}
+
+double ATC3DGTracker::get_min_rate() const
+{
+	return 20;
+}
+
+double ATC3DGTracker::get_max_rate() const
+{
+	return 255;
+}
+
+bool ATC3DGTracker::good() const
+{
+	return m_good;
+}
+
+double ATC3DGTracker::get_timestamp() const
+{
+	return m_timestamp;
+}
+
+void ATC3DGTracker::p_decode(int sensor, Sample& sample, unsigned fields)
+{
+	// the words are kept for the history, fields are decoded from them
+	RawSample raw;
+	raw.request_time = sample.request_time;
+	raw.timestamp = sample.timestamp;
+	raw.sequence = m_sequence++;
+	for (int i = 0; i < RAW_SAMPLE_WORDS; i++)
+	{
+		raw.words[i] = p_get_word(i * 2);
+	}
+	raw.button = m_input_buf[52] & 1;
+	raw.scaling = (uint8_t)m_scaling;
+	if (m_history)
+	{
+		m_history->push(sensor, raw);
+	}
+
+	// timestamp
+	// TODO @henry EMTS timestamp [44:51]
+	raw_sample_decode(sensor, raw, fields, sample);
+}
+
+void ATC3DGTracker::p_acquire(std::vector<int> sensors)
+{
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_io_mutex);
+		m_realtime_errors = apply_realtime(m_realtime);
+		for (const auto& error : m_realtime_errors)
+		{
+			fprintf(stderr, "Acquisition thread: %s\n", error.c_str());
+		}
+		m_gap_stats.reset();
+	}
+	bool adaptive;
+	{
+		std::lock_guard<std::mutex> lock(m_scheduler_mutex);
+		adaptive = m_adaptive;
+	}
+
+	auto next = std::chrono::steady_clock::now();
+	auto next_refresh = next + std::chrono::seconds(1);
+	std::vector<int> attached;
+	std::vector<int> scheduled;
+	std::vector<Sample> samples;
+
+	while (m_acquiring)
+	{
+		// decode what the current subscribers need, once per record
+		unsigned fields = p_subscribed_fields();
+		bool refresh = std::chrono::steady_clock::now() >= next_refresh;
+		{
+			std::lock_guard<std::recursive_mutex> lock(m_io_mutex);
+			m_gap_stats.add(atc3dg_time());
+		}
+
+		std::string error = "tracker not connected";
+		try
+		{
+			if (refresh)
+			{
+				refresh_topology();
+				next_refresh = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+			}
+			attached.clear();
+			for (int sensor : sensors)
+			{
+				if (is_attached(sensor))
+				{
+					attached.push_back(sensor);
+				}
+			}
+			if (!adaptive)
+			{
+				// a lost record leaves the rest of the frame to the next one
+				poll_all(attached, samples, fields);
+			}
+			else
+			{
+				// the scheduler measures motion on every sample it gets
+				fields |= SAMPLE_POSITION | SAMPLE_QUATERNION;
+				{
+					std::lock_guard<std::mutex> lock(m_scheduler_mutex);
+					m_scheduler.next(attached, get_rate(), atc3dg_time(), scheduled);
+				}
+				double started = atc3dg_time();
+				poll_all(scheduled, samples, fields);
+				std::lock_guard<std::mutex> lock(m_scheduler_mutex);
+				m_scheduler.account(samples.size(), atc3dg_time() - started);
+				for (const Sample& sample : samples)
+				{
+					m_scheduler.update(sample);
+				}
+			}
+		}
+		catch (const std::exception& e)
+		{
+			samples.clear();
+			error = e.what();
+		}
+
+		for (const Sample& sample : samples)
+		{
+			p_dispatch(sample);
+		}
+
+		if (!good())
+		{
+			if (!m_auto_recover)
+			{
+				fprintf(stderr, "Acquisition stopped: %s\n", error.c_str());
+				m_acquiring = false;
+				break;
+			}
+
+			fprintf(stderr, "Tracker connection lost, recovering: %s\n", error.c_str());
+			while (m_acquiring && !recover(1000))
+			{
+			}
+			if (good())
+			{
+				fprintf(stderr, "Tracker recovered after %.0f ms.\n", get_stats().last_outage * 1000);
+			}
+		}
+
+		next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double>(1.0 / get_rate()));
+		auto now = std::chrono::steady_clock::now();
+		if (next < now)
+		{
+			// fell behind, don't try to catch up with a burst
+			next = now;
+		}
+		std::this_thread::sleep_until(next);
+	}
+}
+
+void ATC3DGTracker::p_dispatch(const Sample& sample)
+{
+	{
+		// callbacks are called unlocked, they may (un)subscribe
+		std::lock_guard<std::mutex> lock(m_subscriber_mutex);
+		m_dispatching.clear();
+		for (const auto& subscriber : m_subscribers)
+		{
+			if (subscriber.sensor < 0 || subscriber.sensor == sample.sensor)
+			{
+				m_dispatching.push_back(subscriber.callback);
+			}
+		}
+	}
+	for (const auto& callback : m_dispatching)
+	{
+		(*callback)(sample);
+	}
+	m_dispatching.clear();
 }
 
-ATC3DGTracker::~ATC3DGTracker()
+unsigned ATC3DGTracker::p_subscribed_fields()
 {
-	if (m_good)
+	std::lock_guard<std::mutex> lock(m_subscriber_mutex);
+	unsigned fields = 0;
+	for (const auto& subscriber : m_subscribers)
 	{
-		disconnect();
+		fields |= subscriber.fields;
 	}
+	return fields;
 }
 
-void ATC3DGTracker::connect()
+struct usb_device* ATC3DGTracker::p_find_device()
 {
-	log_debug("connecting to ATC 3D Guidance tracker");
-	usb_init();
-	usb_find_busses();
-	usb_find_devices();
-
-	struct usb_bus *bus = nullptr;
-	struct usb_device *dev = nullptr;
-
-	for (bus = usb_busses; bus; bus = bus->next)
+	for (struct usb_bus* bus = usb_busses; bus; bus = bus->next)
 	{
-		for (dev = bus->devices; dev; dev = dev->next)
+		for (struct usb_device* dev = bus->devices; dev; dev = dev->next)
 		{
 			int vendor = dev->descriptor.idVendor;
 			int product = dev->descriptor.idProduct;
 			if (vendor == VENDOR_TRAKSTAR2G && product == PRODUCT_TRAKSTAR2G)
 			{
-				m_device = dev;
-				break;
+				return dev;
 			}
 		}
 	}
-	
-	if (m_device == nullptr)
-	{
-		throw std::runtime_error("Could not find USB device.");
-	}
+	return nullptr;
+}
 
+void ATC3DGTracker::p_open()
+{
 	m_handle = usb_open(m_device);
 	if (!m_handle)
 	{
@@ -92,181 +1080,110 @@ void ATC3DGTracker::connect()
 
 	// clear pipe
 	usb_bulk_read(m_handle, ENDPOINT_IN, m_input_buf, 64, USB_TIMEOUT);
-
-	log_debug("Initializing trakSTAR unit...");
-	atc_init();
-	log_debug("Connected to trakSTAR 3D Guidance tracker.");
-	m_good = true;
+	m_stale = false;
+	m_consecutive_errors = 0;
 }
 
-void ATC3DGTracker::disconnect()
+void ATC3DGTracker::p_close()
 {
-	m_good = false;
-	log_debug("Disconnecting trakSTAR 3D Guidance tracker...");
-	atc_select_tx(0xFF);
-	p_write({0x3F});
-	p_write({0x3F});
-	p_write({0xF1, ATC_CMD_CHANGE, ATC_GROUP_MODE, 0x00});
-	p_write({ATC_CMD_CHANGE, 0x94, 0x01});
-	atc_sleep(0);
-	usb_close(m_handle);
+	if (m_handle)
+	{
+		usb_release_interface(m_handle, 0);
+		usb_close(m_handle);
+		m_handle = nullptr;
+	}
 }
 
-int ATC3DGTracker::get_number_sensors()
+/**
+ * Re-applies the cached configuration to a unit that stayed powered.
+ * \return false if the unit does not respond like an initialized tracker
+ */
+bool ATC3DGTracker::p_reconfigure()
 {
-	int n_sensors = 0;
-	for (int i = 0; i < 4; i++)
+	try
 	{
-		p_write({0xF1 + i, ATC_CMD_EXAMINE, ATC_RX_SERIAL_NUMBER});
-		p_read(2);
-		if (m_input_buf[0] != 0 && m_input_buf[1] != 0)
-		{
-			printf("%x%x\n", m_input_buf[0], m_input_buf[1]);
-			n_sensors++;
-		}
+		examine(ATC_POSITION_SCALING);
 	}
-	return n_sensors;
+	catch (const std::exception&)
+	{
+		return false;
+	}
+
+	ParameterBatch batch;
+	batch.change(ATC_GROUP_MODE, {0x00});
+	if (m_rate_set)
+	{
+		batch.change_word(ATC_RATE, (short)(m_rate * 256), -1);
+	}
+	execute(batch);
+	return true;
 }
 
-double ATC3DGTracker::p_get_double(int byte1, int byte2)
+void ATC3DGTracker::p_discover_topology()
 {
-	if (byte2 < 0) {
-		byte2 = byte1 + 1;
-	}
-	
-	short v = ((m_input_buf[byte2] << 7) | (m_input_buf[byte1] & 0x7F)) << 2;
-	return (double)v / 0x8000;
+	p_probe_sensors();
+	m_tracker_status = examine(ATC_TRACKER_STATUS).word();
 }
 
-void ATC3DGTracker::update(
-	int sensor,
-	double &x, double &y, double &z,
-	double &ax, double &ay, double &az,
-	double (&matrix)[3][3],
-	double &q0, double &qi, double &qj, double &qk,
-	double &quality,
-	bool &button)
+/**
+ * Reads the serial numbers of all ports and, for newly attached sensors,
+ * their model and part number strings into the topology cache, in one
+ * batch each.
+ */
+void ATC3DGTracker::p_probe_sensors()
 {
-	if (!m_good)
+	ParameterBatch serials;
+	for (int port = 0; port < ATC_MAX_SENSORS; port++)
 	{
-		return;
+		serials.examine(ATC_RX_SERIAL_NUMBER, port);
 	}
-	button = false;
-
-	p_write({0xF1 + sensor, ATC_CMD_POINT});
-	p_read(53);
-
-	// positions
-	x = 36.0 * m_scaling * p_get_double(0) * 25.4;
-	y = 36.0 * m_scaling * p_get_double(2) * 25.4;
-	z = 36.0 * m_scaling * p_get_double(4) * 25.4;
-
-	// angles
-	ax = 180.0 * p_get_double(24);
-	ay = 180.0 * p_get_double(26);
-	az = 180.0 * p_get_double(28);
-
-	double d2r = M_PI / 180.0;
-	double r2d = 180.0 / M_PI;
-	/*matrix[0][0] =  cos(d2r * ay) * cos(d2r * az);
-	matrix[0][1] =  cos(d2r * ay) * sin(d2r * az);
-	matrix[0][2] = -sin(d2r * ay);
-	matrix[1][0] = -(cos(d2r * ax) * sin(d2r * az)) + (sin(d2r * ax) * sin(d2r * ay) * cos(d2r * az));
-	matrix[1][1] =  (cos(d2r * ax) * cos(d2r * az)) + (sin(d2r * ax) * sin(d2r * ay) * sin(d2r * az));
-	matrix[1][2] =  sin(d2r * ax) * cos(d2r * ay);
-	matrix[2][0] =  (sin(d2r * ax) * sin(d2r * az)) + (cos(d2r * ax) * sin(d2r * ay) * cos(d2r * az));
-	matrix[2][1] = -(sin(d2r * ax) * cos(d2r * az)) + (cos(d2r * ax) * sin(d2r * ay) * sin(d2r * az));
-	matrix[2][2] =  cos(d2r * ax) * cos(d2r * ay);*/
-
-	// matrix
-	int offset = 6;
-	for (int i = 0; i < 3; i++)
+	execute(serials);
+
+	ParameterBatch strings;
+	// port and index of its model string, the part number follows
+	std::vector<std::pair<int, size_t>> probed;
+	for (int port = 0; port < ATC_MAX_SENSORS; port++)
 	{
-		for (int j = 0; j < 3; j++)
+		SensorInfo& info = m_topology[port];
+		const ParameterValue& value = serials[port];
+		bool attached = value.bytes[0] != 0 && value.bytes[1] != 0;
+		if (!attached)
 		{
-			int idx = i * 3 + j;
-			matrix[i][j] = p_get_double(offset + idx * 2);
+			info.attached = false;
+			info.serial = 0;
+			info.model.clear();
+			info.part.clear();
 		}
-	}
-	
-	
-
-	/*if (sensor == 0)
-	{	
-		std::cout << "\n---" << std::endl;
-		// Print raw two byte packages
-		for (int i = 0; i < 53/2; i++)
+		else if (!info.attached || info.serial != value.word())
 		{
-			std::cout << "Byte " << i*2 << "to" << i*2+1 << ": " << std::setprecision(2) << std::fixed << p_get_double(i*2) << std::endl;
+			probed.push_back({port, strings.model_string(ATC_COMPONENT_RX, port)});
+			strings.part_number(ATC_COMPONENT_RX, port);
 		}
-	}*/
-	
-
-	q0 = p_get_double(30);
-	qi = p_get_double(32);
-	qj = p_get_double(34);
-	qk = p_get_double(36);
-
-	// quality
-	quality = p_get_double(36, 37);
-	// timestamp
-	// TODO @henry EMTS timestamp [44:51]
-
-	if ((m_input_buf[52] & 1) == 1)
+	}
+	if (strings.size() > 0)
 	{
-		button = true;
+		execute(strings);
 	}
 
-	std::this_thread::sleep_for(std::chrono::milliseconds(10));
-}
-
-void ATC3DGTracker::update(
-	int sensor,
-	double *position,
-	double *orientation,
-	double (&matrix)[3][3],
-	double *quaternion,
-	double *quality,
-	bool *button)
-{
-	this->update(
-		sensor,
-		position[0], position[1], position[2],
-		orientation[0], orientation[1], orientation[2],
-		matrix,
-		quaternion[0], quaternion[1], quaternion[2], quaternion[3],
-		*quality,
-		*button);
-}
-
-void ATC3DGTracker::set_rate(double rate)
-{
-	if (rate >= get_min_rate() && rate <= get_max_rate())
+	// sensors only count as attached once their strings are known
+	for (const auto& it : probed)
 	{
-		m_rate = rate;
-		short s_rate = (short)(rate * 256);
-		p_write({ATC_CMD_CHANGE, ATC_RATE, s_rate & 0xFF, s_rate >> 8});
+		SensorInfo& info = m_topology[it.first];
+		info.model = strings[it.second].text();
+		info.part = strings[it.second + 1].text();
+		info.attached = true;
+		info.serial = serials[it.first].word();
 	}
 }
 
-double ATC3DGTracker::get_rate() const
-{
-	return m_rate;
-}
-
-double ATC3DGTracker::get_min_rate() const
-{
-	return 20;
-}
-
-double ATC3DGTracker::get_max_rate() const
-{
-	return 255;
-}
-
-bool ATC3DGTracker::good() const
+void ATC3DGTracker::p_fail()
 {
-	return m_good;
+	if (m_good)
+	{
+		m_good = false;
+		m_outage_start = atc3dg_time();
+		m_stats.failures++;
+	}
 }
 
 /** -=-=-= trakSTAR interface functions =-=-=- **/
@@ -290,48 +1207,40 @@ void ATC3DGTracker::atc_init()
 
 	p_write({0x3F});
 
-	p_write({0xF1, ATC_CMD_CHANGE, 0x64, 0x01});
-
-	p_write({0xF1, ATC_CMD_CHANGE, 0x7B, 0x00, 0x00});
-	p_write({0xF1, ATC_CMD_EXAMINE, 0x7B});
-	p_read(2);
-
-	p_write({0xF1, ATC_CMD_CHANGE, 0x7B, 0x01, 0x00});
-	p_write({0xF1, ATC_CMD_EXAMINE, 0x7B});
-	p_read(2);
-
+	// the 81 ROM pages were read one round trip after another, now as a
+	// single batch; 0x7B selects the page
+	ParameterBatch rom;
+	rom.change(0x64, {0x01});
+	rom.change(0x7B, {0x00, 0x00});
+	rom.examine(0x7B, 0, 2);
+	rom.change(0x7B, {0x01, 0x00});
+	rom.examine(0x7B, 0, 2);
 	for (int j = 0; j < 9; j++)
 	{
 		for (int i = 0; i < 9; i++)
 		{
-			p_write({0xF1, ATC_CMD_CHANGE, 0x7B, 0x01 + i, 0x00 + j});
-			p_write({0xF1, ATC_CMD_EXAMINE, ATC_ROM});
-			p_read(32);
-			p_read(32);
+			rom.change(0x7B, {0x01 + i, 0x00 + j});
+			rom.examine(ATC_ROM);
 		}
 	}
-
-	p_write({0xF1, ATC_CMD_EXAMINE, ATC_POSITION_SCALING});
-	p_read(2);
+	size_t scaling = rom.examine(ATC_POSITION_SCALING);
+	rom.examine(0x94, 0, 1);
+	rom.change(0x94, {0x01});
+	rom.change(0x64, {0x01});
+	execute(rom);
 
 	m_scaling = 1;
-	if (m_input_buf[0] == 1)
+	if (rom[scaling].bytes[0] == 1)
 	{
 		m_scaling = 2;
 	}
 
-	p_write({0xF1, ATC_CMD_EXAMINE, 0x94});
-	p_read(1);
-
-	p_write({0xF1, ATC_CMD_CHANGE, 0x94, 0x01});
-	p_write({0xF1, ATC_CMD_CHANGE, 0x64, 0x01});
 	atc_sleep(0);
 
-	p_write({0xF1, ATC_CMD_EXAMINE, 0x95});
-	p_read(1);
-
-	p_write({0xF1, ATC_CMD_EXAMINE, 0x34});
-	p_read(2);
+	ParameterBatch status;
+	status.examine(0x95, 0, 1);
+	status.examine(0x34, 0, 2);
+	execute(status);
 
 	std::this_thread::sleep_for(std::chrono::milliseconds(200));
 
@@ -340,21 +1249,23 @@ void ATC3DGTracker::atc_init()
 	atc_autoconfig(0);
 	atc_sleep(600);
 
-	p_write({0xF1, ATC_CMD_EXAMINE, ATC_AUTOCONFIG});
-	p_read(5);
-
-	p_write({0xF1, ATC_CMD_EXAMINE, 0x46});
-	p_read(1);
+	ParameterBatch autoconfig;
+	autoconfig.examine(ATC_AUTOCONFIG);
+	autoconfig.examine(0x46, 0, 1);
+	execute(autoconfig);
 
 	p_write({0x7A});
 
-	p_write({0xF1, ATC_CMD_EXAMINE, ATC_SERIAL_NUMBER});
-	p_read(2);
-
-	atc_get_modelstring_pcb();
-	atc_get_partnum_pcb();
-	atc_get_modelstring_tx();
-	atc_get_partnum_tx();
+	// 52 characters, one request each
+	ParameterBatch identification;
+	identification.examine(ATC_SERIAL_NUMBER);
+	size_t pcb = identification.model_string(ATC_COMPONENT_PCB);
+	identification.part_number(ATC_COMPONENT_PCB);
+	size_t tx = identification.model_string(ATC_COMPONENT_TX);
+	identification.part_number(ATC_COMPONENT_TX);
+	execute(identification);
+	log_debug("board " + identification[pcb].text() + " " + identification[pcb + 1].text()
+		+ ", transmitter " + identification[tx].text() + " " + identification[tx + 1].text());
 
 	p_write({0x3F});
 
@@ -366,18 +1277,17 @@ void ATC3DGTracker::atc_init()
 		p_write({0xF1 + rx, ATC_CMD_CHANGE, 0x80, 0x01});
 	}
 
-	p_write({0xF1, ATC_CMD_CHANGE, ATC_STREAM, 0x01});
-	p_write({0xF1, ATC_CMD_EXAMINE, ATC_SYSTEM_ERROR});
-	p_read(2);
-	p_write({0xF1, ATC_CMD_EXAMINE, 0x7A});
-	p_read(32);
-	p_write({0xF1, ATC_CMD_EXAMINE, ATC_SYSTEM_ERROR});
-	p_read(2);
-	p_write({0xF1, ATC_CMD_CHANGE, ATC_STREAM, 0x00});
-
-	p_write({ATC_CMD_EXAMINE, 0});
-	p_read(2);
-	printf("%x %x\n", m_input_buf[0], m_input_buf[1]);
+	ParameterBatch errors;
+	errors.change(ATC_STREAM, {0x01});
+	errors.examine(ATC_SYSTEM_ERROR);
+	errors.examine(0x7A, 0, 32);
+	errors.examine(ATC_SYSTEM_ERROR);
+	errors.change(ATC_STREAM, {0x00});
+	size_t system_status = errors.examine(ATC_STATUS, -1);
+	execute(errors);
+	printf("%x %x\n", errors[system_status].bytes[0], errors[system_status].bytes[1]);
+
+	p_discover_topology();
 }
 
 void ATC3DGTracker::atc_select_tx(int tx, int delay)
@@ -392,174 +1302,210 @@ void ATC3DGTracker::atc_get_status()
 	p_read(2);
 }
 
-std::string ATC3DGTracker::atc_get_modelstring_pcb()
+void ATC3DGTracker::atc_autoconfig(int units, int delay)
 {
-	std::stringstream strstr;
+	p_write({0xF1, ATC_CMD_CHANGE, ATC_AUTOCONFIG, units});
+	std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+}
 
-	for (int b = 0; b < 11; b++)
-	{
-		p_write({ATC_CMD_MODELSTRING, 0x0A + b, 0x00});
-		p_read(1);
-		if (m_input_buf[0] >= ' ')
-		{
-			strstr << m_input_buf[0];
-		}
-	}
+void ATC3DGTracker::atc_reset(int delay)
+{
+	p_write({ATC_CMD_RESET});
+	std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+}
 
-	return strstr.str();
+void ATC3DGTracker::atc_sleep(int delay)
+{
+	p_write({ATC_CMD_SLEEP});
+	std::this_thread::sleep_for(std::chrono::milliseconds(delay));
 }
 
-std::string ATC3DGTracker::atc_get_partnum_pcb()
+/**
+ * \param bytes number of bytes to read
+ */
+void ATC3DGTracker::p_read(int bytes, Deadline deadline)
 {
-	std::stringstream strstr;
+	if (bytes >= BUF_SIZE)
+	{
+		throw std::runtime_error("Tried to read more than 64 bytes from USB. This is a bug.");
+	}
+	if (deadline == Deadline())
+	{
+		deadline = p_deadline();
+	}
 
-	for (int b = 0; b < 15; b++)
+	int r = p_transfer(ENDPOINT_IN, m_input_buf, bytes, deadline);
+	if (r != bytes)
 	{
-		p_write({ATC_CMD_MODELSTRING, 0x70 + b, 0x00});
-		p_read(1);
-		if (m_input_buf[0] >= ' ')
-		{
-			strstr << m_input_buf[0];
-		}
+		fprintf(stderr, "Attempted to read %d bytes, read %d.\n", bytes, r);
+		p_error(ATC_ERROR_PROTOCOL, "Short read from USB.");
 	}
 
-	return strstr.str();
+	m_consecutive_errors = 0;
+	m_input_buf[bytes] = '\0';
 }
 
-std::string ATC3DGTracker::atc_get_modelstring_tx()
+/**
+ * \param list vector of arguments
+ */
+void ATC3DGTracker::p_write(std::vector<int> list, Deadline deadline)
 {
-	std::stringstream strstr;
-
-	for (int b = 0; b < 11; b++)
+	int length = 0;
+	for (auto it : list)
 	{
-		p_write({ATC_CMD_MODELSTRING, 0x0A + b, 0x02});
-		p_read(1);
-		if (m_input_buf[0] >= ' ')
-		{
-			strstr << m_input_buf[0];
-		}
+		m_output_buf[length] = it;
+		length++;
+	}
+	if (deadline == Deadline())
+	{
+		deadline = p_deadline();
 	}
 
-	return strstr.str();
-}
-
-std::string ATC3DGTracker::atc_get_partnum_tx()
-{
-	std::stringstream strstr;
+	// don't let a late response pass for the answer to this request
+	if (m_stale)
+	{
+		p_drain();
+	}
 
-	for (int b = 0; b < 15; b++)
+	int r = p_transfer(ENDPOINT_OUT, m_output_buf, length, deadline);
+	if (r != length)
 	{
-		p_write({ATC_CMD_MODELSTRING, 0x70 + b, 0x02});
-		p_read(1);
-		if (m_input_buf[0] >= ' ')
-		{
-			strstr << m_input_buf[0];
-		}
+		fprintf(stderr, "Attempted to write %d bytes, wrote %d.\n", length, r);
+		p_error(ATC_ERROR_PROTOCOL, "Short write to USB.");
 	}
+}
 
-	return strstr.str();
+ATC3DGTracker::Deadline ATC3DGTracker::p_deadline() const
+{
+	return std::chrono::steady_clock::now() + std::chrono::milliseconds(m_transaction_budget);
 }
 
-std::string ATC3DGTracker::atc_get_modelstring_rx(int rx)
+/**
+ * One bulk transfer that ends by the deadline. Zero-length transfers are
+ * retried up to ATC_MAX_RETRIES times, failures throw ATC3DGError.
+ * \return number of bytes transferred
+ */
+int ATC3DGTracker::p_transfer(int endpoint, char* buffer, int bytes, Deadline deadline)
 {
-	std::stringstream strstr;
+	if (!m_handle)
+	{
+		p_error(ATC_ERROR_DISCONNECT, "Tracker is not connected.");
+	}
 
-	for (int b = 0; b < 11; b++)
+	for (int attempt = 0; attempt <= ATC_MAX_RETRIES; attempt++)
 	{
-		p_write({0xF1 + rx, ATC_CMD_MODELSTRING, 0x0A + b, 0x01});
-		p_read(1);
-		if (m_input_buf[0] >= ' ')
+		auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+			deadline - std::chrono::steady_clock::now()).count();
+		if (remaining <= 0)
 		{
-			strstr << m_input_buf[0];
+			break;
 		}
-	}
-
-	return strstr.str();
-}
 
-std::string ATC3DGTracker::atc_get_partnum_rx(int rx)
-{
-	std::stringstream strstr;
+		// libusb 0.1 treats a timeout of 0 as infinite, remaining is at least 1
+		int r = endpoint == ENDPOINT_IN
+			? usb_bulk_read(m_handle, endpoint, buffer, bytes, (int)remaining)
+			: usb_bulk_write(m_handle, endpoint, buffer, bytes, (int)remaining);
+		if (r > 0)
+		{
+			return r;
+		}
+		if (r == 0)
+		{
+			continue;
+		}
 
-	for (int b = 0; b < 15; b++)
-	{
-		p_write({0xF1 + rx, ATC_CMD_MODELSTRING, 0x70 + b, 0x01});
-		p_read(1);
-		if (m_input_buf[0] >= ' ')
+		switch (-r)
 		{
-			strstr << m_input_buf[0];
+		case ETIMEDOUT:
+		case EAGAIN:
+			p_error(ATC_ERROR_TIMEOUT, usb_strerror());
+		case EPIPE:
+			usb_clear_halt(m_handle, endpoint);
+			p_error(ATC_ERROR_STALL, usb_strerror());
+		case EPROTO:
+		case EILSEQ:
+		case EOVERFLOW:
+			p_error(ATC_ERROR_PROTOCOL, usb_strerror());
+		default:
+			// ENODEV, ESHUTDOWN, EIO and friends: unplugged or powered off
+			p_error(ATC_ERROR_DISCONNECT, usb_strerror());
 		}
 	}
 
-	return strstr.str();
-}
-
-void ATC3DGTracker::atc_autoconfig(int units, int delay)
-{
-	p_write({0xF1, ATC_CMD_CHANGE, ATC_AUTOCONFIG, units});
-	std::this_thread::sleep_for(std::chrono::milliseconds(delay));
-}
-
-void ATC3DGTracker::atc_reset(int delay)
-{
-	p_write({ATC_CMD_RESET});
-	std::this_thread::sleep_for(std::chrono::milliseconds(delay));
-}
-
-void ATC3DGTracker::atc_sleep(int delay)
-{
-	p_write({ATC_CMD_SLEEP});
-	std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+	p_error(ATC_ERROR_TIMEOUT, "USB transaction exceeded its budget.");
 }
 
 /**
- * \param bytes number of bytes to read
+ * Counts a failed transaction and throws it. The tracker goes offline on
+ * disconnects and after ATC_MAX_FAILURES failures in a row.
  */
-void ATC3DGTracker::p_read(int bytes)
+void ATC3DGTracker::p_error(ATC3DGErrorKind kind, const std::string& message)
 {
-	int r = 0;
-
-	if (bytes >= BUF_SIZE)
+	switch (kind)
 	{
-		throw std::runtime_error("Tried to read more than 64 bytes from USB. This is a bug.");
+	case ATC_ERROR_TIMEOUT:
+		m_stats.timeouts++;
+		break;
+	case ATC_ERROR_STALL:
+		m_stats.stalls++;
+		break;
+	case ATC_ERROR_PROTOCOL:
+		m_stats.protocol_errors++;
+		break;
+	case ATC_ERROR_DISCONNECT:
+		break;
 	}
 
-	do
+	m_stale = kind != ATC_ERROR_DISCONNECT;
+	m_consecutive_errors++;
+	if (kind == ATC_ERROR_DISCONNECT || m_consecutive_errors >= ATC_MAX_FAILURES)
 	{
-		r = usb_bulk_read(m_handle, ENDPOINT_IN, m_input_buf, bytes, USB_TIMEOUT);
-	} while (r == 0);
+		p_fail();
+	}
+	throw ATC3DGError(kind, message);
+}
 
-	if (r != bytes)
+/**
+ * Discards responses the tracker still has queued, e.g. the late answer
+ * to a request that timed out.
+ */
+void ATC3DGTracker::p_drain()
+{
+	char discard[BUF_SIZE];
+	m_stale = false;
+	for (int i = 0; i < ATC_MAX_DRAIN && m_handle; i++)
 	{
-		fprintf(stderr, "Attempted to read %d bytes, read %d.\n", bytes, r);
-		throw std::runtime_error(usb_strerror());
+		if (usb_bulk_read(m_handle, ENDPOINT_IN, discard, BUF_SIZE, 2) <= 0)
+		{
+			break;
+		}
 	}
-
-	m_input_buf[bytes] = '\0';
 }
 
 /**
- * \param list vector of arguments
+ * Realigns a record that does not start with the phasing bit (the MSB is
+ * only set in the first byte of a record). The bytes before the next
+ * phasing byte are the tail of an older record and are dropped, the
+ * missing rest of the record is read within the deadline.
  */
-void ATC3DGTracker::p_write(std::vector<int> list)
+void ATC3DGTracker::p_resync(int bytes, Deadline deadline)
 {
-	int length = 0;
-	for (auto it : list)
+	int start = 1;
+	while (start < bytes && !(m_input_buf[start] & 0x80))
 	{
-		m_output_buf[length] = it;
-		length++;
+		start++;
 	}
-
-	int r = 0;
-
-	do
+	if (start == bytes)
 	{
-		r = usb_bulk_write(m_handle, ENDPOINT_OUT, m_output_buf, length, USB_TIMEOUT);
-	} while (r == 0);
+		p_error(ATC_ERROR_PROTOCOL, "Record without phasing bit.");
+	}
 
-	if (r != length)
+	memmove(m_input_buf, m_input_buf + start, bytes - start);
+	int offset = bytes - start;
+	while (offset < bytes)
 	{
-		fprintf(stderr, "Attempted to write %d bytes, read %d.\n", length, r);
-		throw std::runtime_error(usb_strerror());
+		offset += p_transfer(ENDPOINT_IN, m_input_buf + offset, bytes - offset, deadline);
 	}
+	m_input_buf[bytes] = '\0';
+	m_stats.resyncs++;
 }
@@ -0,0 +1,184 @@
+#include <exception>
+#include <string>
+
+#include "atc3dg.hpp"
+#include "atc3dg_c.h"
+#include "recording.hpp"
+
+struct atc_tracker {
+	ATC3DGTracker tracker;
+};
+
+struct atc_recording {
+	RecordingReader reader;
+};
+
+namespace {
+
+thread_local std::string last_error;
+
+int fail(const std::exception& e)
+{
+	last_error = e.what();
+	return -1;
+}
+
+SampleBatch to_batch(const atc_sample_batch* batch)
+{
+	SampleBatch result;
+	result.position = batch->position;
+	result.angles = batch->angles;
+	result.matrix = batch->matrix;
+	result.quaternion = batch->quaternion;
+	result.quality = batch->quality;
+	result.timestamp = batch->timestamp;
+	result.button = batch->button;
+	result.sensor = batch->sensor;
+	result.sequence = batch->sequence;
+	return result;
+}
+
+}
+
+int atc_api_version(void)
+{
+	return ATC3DG_C_API_VERSION;
+}
+
+const char* atc_last_error(void)
+{
+	return last_error.c_str();
+}
+
+atc_tracker* atc_tracker_create(void)
+{
+	try
+	{
+		return new atc_tracker();
+	}
+	catch (const std::exception& e)
+	{
+		fail(e);
+		return nullptr;
+	}
+}
+
+void atc_tracker_destroy(atc_tracker* tracker)
+{
+	delete tracker;
+}
+
+int atc_tracker_connect(atc_tracker* tracker)
+{
+	try
+	{
+		tracker->tracker.connect();
+		return 0;
+	}
+	catch (const std::exception& e)
+	{
+		return fail(e);
+	}
+}
+
+int atc_tracker_disconnect(atc_tracker* tracker)
+{
+	try
+	{
+		tracker->tracker.disconnect();
+		return 0;
+	}
+	catch (const std::exception& e)
+	{
+		return fail(e);
+	}
+}
+
+int atc_tracker_number_sensors(atc_tracker* tracker)
+{
+	try
+	{
+		return tracker->tracker.get_number_sensors();
+	}
+	catch (const std::exception& e)
+	{
+		return fail(e);
+	}
+}
+
+int atc_tracker_set_rate(atc_tracker* tracker, double rate)
+{
+	try
+	{
+		tracker->tracker.set_rate(rate);
+		return 0;
+	}
+	catch (const std::exception& e)
+	{
+		return fail(e);
+	}
+}
+
+int64_t atc_tracker_read_batch(atc_tracker* tracker, const int32_t* sensors, int32_t n_sensors, size_t n, const atc_sample_batch* batch)
+{
+	static_assert(sizeof(int32_t) == sizeof(int), "sensor indices are passed as int");
+	try
+	{
+		return tracker->tracker.read_batch(reinterpret_cast<const int*>(sensors), n_sensors, n, to_batch(batch));
+	}
+	catch (const std::exception& e)
+	{
+		return fail(e);
+	}
+}
+
+atc_recording* atc_recording_open(const char* filename)
+{
+	atc_recording* recording = new atc_recording();
+	try
+	{
+		recording->reader.open(filename);
+		return recording;
+	}
+	catch (const std::exception& e)
+	{
+		delete recording;
+		fail(e);
+		return nullptr;
+	}
+}
+
+void atc_recording_close(atc_recording* recording)
+{
+	delete recording;
+}
+
+int64_t atc_recording_size(atc_recording* recording)
+{
+	return recording->reader.size();
+}
+
+int atc_recording_seek(atc_recording* recording, int64_t index)
+{
+	try
+	{
+		recording->reader.seek(index < 0 ? 0 : index);
+		return 0;
+	}
+	catch (const std::exception& e)
+	{
+		return fail(e);
+	}
+}
+
+int64_t atc_recording_read_batch(atc_recording* recording, const int32_t* sensors, int32_t n_sensors, size_t n, const atc_sample_batch* batch)
+{
+	try
+	{
+		return recording->reader.read_batch(reinterpret_cast<const int*>(sensors), n_sensors, n, to_batch(batch));
+	}
+	catch (const std::exception& e)
+	{
+		return fail(e);
+	}
+}
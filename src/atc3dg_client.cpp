@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include "atc3dg_client.hpp"
+
+ATC3DGClient::ATC3DGClient(const std::string& name) : m_name(name)
+{
+	std::fill(m_cursors, m_cursors + TRACKER_SHM_MAX_SENSORS, 0);
+}
+
+ATC3DGClient::~ATC3DGClient()
+{
+	// the acquisition thread calls into this object
+	stop();
+}
+
+void ATC3DGClient::connect()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	p_attach();
+	if (!p_alive())
+	{
+		m_reader.close();
+		throw std::runtime_error("The tracker daemon at " + m_name + " is not running.");
+	}
+	m_known_topology = p_topology();
+}
+
+void ATC3DGClient::disconnect()
+{
+	stop();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_reader.close();
+}
+
+bool ATC3DGClient::recover(int timeout)
+{
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+	while (true)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			try
+			{
+				// a restarted daemon creates a new segment
+				p_attach();
+				if (p_alive())
+				{
+					return true;
+				}
+			}
+			catch (const std::runtime_error&)
+			{
+			}
+		}
+		if (std::chrono::steady_clock::now() >= deadline)
+		{
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+}
+
+int ATC3DGClient::get_number_sensors()
+{
+	std::vector<SensorInfo> topology = get_topology();
+	return (int)std::count_if(topology.begin(), topology.end(), [](const SensorInfo& info) { return info.attached; });
+}
+
+std::vector<SensorInfo> ATC3DGClient::get_topology() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return p_topology();
+}
+
+bool ATC3DGClient::is_attached(int port) const
+{
+	for (const SensorInfo& info : get_topology())
+	{
+		if (info.port == port)
+		{
+			return info.attached;
+		}
+	}
+	return false;
+}
+
+bool ATC3DGClient::refresh_topology()
+{
+	std::vector<SensorInfo> changed;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::vector<SensorInfo> topology = p_topology();
+		for (const SensorInfo& info : topology)
+		{
+			auto known = std::find_if(m_known_topology.begin(), m_known_topology.end(), [&](const SensorInfo& k) { return k.port == info.port; });
+			if (known == m_known_topology.end() ? info.attached : (known->attached != info.attached || known->serial != info.serial))
+			{
+				changed.push_back(info);
+			}
+		}
+		for (const SensorInfo& known : m_known_topology)
+		{
+			auto current = std::find_if(topology.begin(), topology.end(), [&](const SensorInfo& info) { return info.port == known.port; });
+			if (current == topology.end() && known.attached)
+			{
+				changed.push_back({known.port, false, 0, "", ""});
+			}
+		}
+		m_known_topology = topology;
+	}
+
+	p_report_topology(changed);
+	return !changed.empty();
+}
+
+void ATC3DGClient::set_rate(double /* rate */)
+{
+	throw std::runtime_error("The tracker daemon owns the rate, restart it with another --rate.");
+}
+
+double ATC3DGClient::get_rate() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_reader.is_open() || m_reader.rate() <= 0)
+	{
+		return ATC3DGTracker::get_rate();
+	}
+	return m_reader.rate();
+}
+
+bool ATC3DGClient::good() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_reader.is_open() && p_alive();
+}
+
+bool ATC3DGClient::poll(int sensor, Sample& sample, unsigned /* fields */)
+{
+	if (sensor < 0 || sensor >= TRACKER_SHM_MAX_SENSORS)
+	{
+		return false;
+	}
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(get_transaction_budget());
+	while (true)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_reader.is_open())
+			{
+				return false;
+			}
+
+			uint64_t& cursor = m_cursors[sensor];
+			uint64_t latest = m_reader.latest(sensor);
+			if (latest > cursor)
+			{
+				// samples of all sensors share the history, skip what was
+				// overwritten
+				uint64_t published = m_reader.published();
+				uint64_t first = published > TRACKER_SHM_HISTORY ? published - TRACKER_SHM_HISTORY : 0;
+				for (uint64_t number = std::max(cursor, first); number < latest; number++)
+				{
+					if (m_reader.read(number, sample) && sample.sensor == sensor)
+					{
+						cursor = number + 1;
+						return true;
+					}
+				}
+				cursor = latest;
+			}
+			if (!p_alive())
+			{
+				return false;
+			}
+		}
+		if (std::chrono::steady_clock::now() >= deadline)
+		{
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+	}
+}
+
+size_t ATC3DGClient::poll_all(const std::vector<int>& sensors, std::vector<Sample>& samples, unsigned fields)
+{
+	samples.clear();
+	Sample sample;
+	for (int sensor : sensors)
+	{
+		if (poll(sensor, sample, fields))
+		{
+			samples.push_back(sample);
+		}
+	}
+	return samples.size();
+}
+
+void ATC3DGClient::p_attach()
+{
+	m_reader.open(m_name);
+	// only samples published from now on
+	for (int sensor = 0; sensor < TRACKER_SHM_MAX_SENSORS; sensor++)
+	{
+		m_cursors[sensor] = m_reader.latest(sensor);
+	}
+}
+
+bool ATC3DGClient::p_alive() const
+{
+	return m_reader.good() && atc3dg_time() - m_reader.heartbeat() < TRACKER_SHM_TIMEOUT;
+}
+
+std::vector<SensorInfo> ATC3DGClient::p_topology() const
+{
+	std::vector<SensorInfo> topology;
+	if (!m_reader.is_open())
+	{
+		return topology;
+	}
+	TrackerShmSensor sensors[TRACKER_SHM_MAX_SENSORS];
+	m_reader.topology(sensors);
+	for (const TrackerShmSensor& sensor : sensors)
+	{
+		if (sensor.port >= 0)
+		{
+			topology.push_back({sensor.port, sensor.attached != 0, sensor.serial,
+								std::string(sensor.model, strnlen(sensor.model, TRACKER_SHM_STRING_LENGTH)),
+								std::string(sensor.part, strnlen(sensor.part, TRACKER_SHM_STRING_LENGTH))});
+		}
+	}
+	return topology;
+}
@@ -0,0 +1,482 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+#include "calibration.hpp"
+
+namespace {
+
+// poses per thread below which starting a thread costs more than it saves
+const size_t MIN_CHUNK = 1024;
+
+// partial sums of a chunk of poses; plain arrays, so the loops over them
+// vectorize
+template <int N>
+struct Sums {
+	double v[N] = {};
+	double max = 0;
+
+	Sums& operator+=(const Sums& other)
+	{
+		for (int i = 0; i < N; i++)
+		{
+			v[i] += other.v[i];
+		}
+		max = std::max(max, other.max);
+		return *this;
+	}
+};
+
+/**
+ * Calls add(sums, i) for i in [0, n), contiguous chunks on separate threads
+ * with a Sums each. The chunks are added in order, so the result does not
+ * depend on scheduling.
+ */
+template <typename S, typename Add>
+S accumulate(size_t n, int threads, Add add)
+{
+	if (threads <= 0)
+	{
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	threads = std::min<size_t>(threads, std::max<size_t>(1, n / MIN_CHUNK));
+
+	std::vector<S> partial(threads);
+	auto work = [&](int chunk) {
+		// local, so the threads do not write to the same cache lines
+		S sums;
+		size_t end = n * (chunk + 1) / threads;
+		for (size_t i = n * chunk / threads; i < end; i++)
+		{
+			add(sums, i);
+		}
+		partial[chunk] = sums;
+	};
+
+	std::vector<std::thread> workers;
+	for (int chunk = 1; chunk < threads; chunk++)
+	{
+		workers.emplace_back(work, chunk);
+	}
+	work(0);
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+
+	S total;
+	for (const auto& sums : partial)
+	{
+		total += sums;
+	}
+	return total;
+}
+
+void rotation_matrix(const double (&q)[4], double (&r)[3][3])
+{
+	double w = q[0], x = q[1], y = q[2], z = q[3];
+	r[0][0] = 1 - 2 * (y * y + z * z);
+	r[0][1] = 2 * (x * y - z * w);
+	r[0][2] = 2 * (x * z + y * w);
+	r[1][0] = 2 * (x * y + z * w);
+	r[1][1] = 1 - 2 * (x * x + z * z);
+	r[1][2] = 2 * (y * z - x * w);
+	r[2][0] = 2 * (x * z - y * w);
+	r[2][1] = 2 * (y * z + x * w);
+	r[2][2] = 1 - 2 * (x * x + y * y);
+}
+
+/**
+ * Solves the n x n system a x = b in place by Gaussian elimination with
+ * partial pivoting, x is left in b. Returns false if a is singular.
+ */
+bool solve(double* a, double* b, int n)
+{
+	double scale = 0;
+	for (int i = 0; i < n * n; i++)
+	{
+		scale = std::max(scale, std::fabs(a[i]));
+	}
+
+	for (int column = 0; column < n; column++)
+	{
+		int pivot = column;
+		for (int row = column + 1; row < n; row++)
+		{
+			if (std::fabs(a[row * n + column]) > std::fabs(a[pivot * n + column]))
+			{
+				pivot = row;
+			}
+		}
+		if (std::fabs(a[pivot * n + column]) <= 1e-9 * scale)
+		{
+			return false;
+		}
+		if (pivot != column)
+		{
+			for (int j = 0; j < n; j++)
+			{
+				std::swap(a[pivot * n + j], a[column * n + j]);
+			}
+			std::swap(b[pivot], b[column]);
+		}
+		for (int row = column + 1; row < n; row++)
+		{
+			double factor = a[row * n + column] / a[column * n + column];
+			for (int j = column; j < n; j++)
+			{
+				a[row * n + j] -= factor * a[column * n + j];
+			}
+			b[row] -= factor * b[column];
+		}
+	}
+
+	for (int row = n - 1; row >= 0; row--)
+	{
+		for (int j = row + 1; j < n; j++)
+		{
+			b[row] -= a[row * n + j] * b[j];
+		}
+		b[row] /= a[row * n + row];
+	}
+	return true;
+}
+
+/**
+ * Eigenvalues and eigenvectors of a symmetric 4x4 matrix by cyclic Jacobi
+ * rotations; eigenvector i is column i of vectors.
+ */
+void symmetric_eigen(double (&a)[4][4], double (&values)[4], double (&vectors)[4][4])
+{
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			vectors[i][j] = i == j ? 1 : 0;
+		}
+	}
+
+	for (int sweep = 0; sweep < 50; sweep++)
+	{
+		double off = 0;
+		for (int p = 0; p < 4; p++)
+		{
+			for (int q = p + 1; q < 4; q++)
+			{
+				off += a[p][q] * a[p][q];
+			}
+		}
+		if (off < 1e-30)
+		{
+			break;
+		}
+
+		for (int p = 0; p < 4; p++)
+		{
+			for (int q = p + 1; q < 4; q++)
+			{
+				if (a[p][q] == 0)
+				{
+					continue;
+				}
+				double theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+				double t = (theta >= 0 ? 1 : -1) / (std::fabs(theta) + std::sqrt(theta * theta + 1));
+				double c = 1 / std::sqrt(t * t + 1);
+				double s = t * c;
+				for (int k = 0; k < 4; k++)
+				{
+					double akp = a[k][p], akq = a[k][q];
+					a[k][p] = c * akp - s * akq;
+					a[k][q] = s * akp + c * akq;
+				}
+				for (int k = 0; k < 4; k++)
+				{
+					double apk = a[p][k], aqk = a[q][k];
+					a[p][k] = c * apk - s * aqk;
+					a[q][k] = s * apk + c * aqk;
+				}
+				for (int k = 0; k < 4; k++)
+				{
+					double vkp = vectors[k][p], vkq = vectors[k][q];
+					vectors[k][p] = c * vkp - s * vkq;
+					vectors[k][q] = s * vkp + c * vkq;
+				}
+			}
+		}
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		values[i] = a[i][i];
+	}
+}
+
+// p * q = left(p) q
+void left_matrix(const double (&p)[4], double (&m)[4][4])
+{
+	double w = p[0], x = p[1], y = p[2], z = p[3];
+	double l[4][4] = {{w, -x, -y, -z}, {x, w, -z, y}, {y, z, w, -x}, {z, -y, x, w}};
+	std::copy(&l[0][0], &l[0][0] + 16, &m[0][0]);
+}
+
+// q * p = right(p) q
+void right_matrix(const double (&p)[4], double (&m)[4][4])
+{
+	double w = p[0], x = p[1], y = p[2], z = p[3];
+	double r[4][4] = {{w, -x, -y, -z}, {x, w, z, -y}, {y, -z, w, x}, {z, y, -x, w}};
+	std::copy(&r[0][0], &r[0][0] + 16, &m[0][0]);
+}
+
+}
+
+PivotCalibration calibrate_pivot(const std::vector<Pose>& poses, int threads)
+{
+	if (poses.size() < 3)
+	{
+		throw std::runtime_error("Pivot calibration needs at least 3 poses.");
+	}
+	size_t n = poses.size();
+
+	// with A_i = [R_i, -I] and b_i = -t_i the normal equations only need
+	// the sums of R_i (0-8), R_i^T t_i (9-11) and t_i (12-14)
+	Sums<15> sums = accumulate<Sums<15>>(n, threads, [&](Sums<15>& s, size_t i) {
+		double r[3][3];
+		rotation_matrix(poses[i].q, r);
+		const double* t = poses[i].t;
+		for (int row = 0; row < 3; row++)
+		{
+			for (int column = 0; column < 3; column++)
+			{
+				s.v[row * 3 + column] += r[row][column];
+				s.v[9 + column] += r[row][column] * t[row];
+			}
+			s.v[12 + row] += t[row];
+		}
+	});
+
+	// [n I, -S^T; -S, n I] [tip; pivot] = [-sum R^T t; sum t]
+	double a[6][6] = {};
+	double x[6];
+	for (int i = 0; i < 3; i++)
+	{
+		a[i][i] = n;
+		a[3 + i][3 + i] = n;
+		for (int j = 0; j < 3; j++)
+		{
+			a[i][3 + j] = -sums.v[j * 3 + i];
+			a[3 + i][j] = -sums.v[i * 3 + j];
+		}
+		x[i] = -sums.v[9 + i];
+		x[3 + i] = sums.v[12 + i];
+	}
+	if (!solve(&a[0][0], x, 6))
+	{
+		throw std::runtime_error("Poses do not rotate enough to locate the tip.");
+	}
+
+	PivotCalibration result = {};
+	std::copy(x, x + 3, result.tip);
+	std::copy(x + 3, x + 6, result.pivot);
+	result.poses = n;
+
+	Sums<1> residuals = accumulate<Sums<1>>(n, threads, [&](Sums<1>& s, size_t i) {
+		double tip[3];
+		poses[i].apply(result.tip, tip);
+		double squared = 0;
+		for (int j = 0; j < 3; j++)
+		{
+			squared += (tip[j] - result.pivot[j]) * (tip[j] - result.pivot[j]);
+		}
+		s.v[0] += squared;
+		s.max = std::max(s.max, squared);
+	});
+	result.rms = std::sqrt(residuals.v[0] / n);
+	result.max_error = std::sqrt(residuals.max);
+	return result;
+}
+
+HandEyeCalibration calibrate_hand_eye(const std::vector<Pose>& hand, const std::vector<Pose>& eye, int threads)
+{
+	if (hand.size() != eye.size())
+	{
+		throw std::runtime_error("Hand and eye poses must be paired.");
+	}
+	if (hand.size() < 3)
+	{
+		throw std::runtime_error("Hand-eye calibration needs at least 3 pose pairs.");
+	}
+	size_t lag = hand.size() / 2;
+	size_t n = hand.size() - lag;
+
+	auto motions = [&](size_t i, Pose& a, Pose& b) {
+		a = hand[i].inverse() * hand[i + lag];
+		b = eye[i].inverse() * eye[i + lag];
+		// B = X^-1 A X, so both quaternions have the same scalar part up
+		// to the sign of q and -q
+		if (a.q[0] * b.q[0] < 0)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				b.q[j] = -b.q[j];
+			}
+		}
+	};
+
+	// rotation: (left(q_A) - right(q_B)) q_X = 0 for every motion, q_X is
+	// the eigenvector of the smallest eigenvalue of the sum of D^T D
+	Sums<16> rotation = accumulate<Sums<16>>(n, threads, [&](Sums<16>& s, size_t i) {
+		Pose a, b;
+		motions(i, a, b);
+		double l[4][4], r[4][4];
+		left_matrix(a.q, l);
+		right_matrix(b.q, r);
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				l[row][column] -= r[row][column];
+			}
+		}
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				double sum = 0;
+				for (int k = 0; k < 4; k++)
+				{
+					sum += l[k][row] * l[k][column];
+				}
+				s.v[row * 4 + column] += sum;
+			}
+		}
+	});
+
+	double m[4][4];
+	std::copy(rotation.v, rotation.v + 16, &m[0][0]);
+	double values[4], vectors[4][4];
+	symmetric_eigen(m, values, vectors);
+	int order[4] = {0, 1, 2, 3};
+	std::sort(order, order + 4, [&](int i, int j) { return values[i] < values[j]; });
+	// motions about a single axis leave a second solution
+	if (values[order[1]] <= 1e-6 * values[order[3]])
+	{
+		throw std::runtime_error("Motions do not rotate about two different axes.");
+	}
+
+	HandEyeCalibration result = {};
+	for (int i = 0; i < 4; i++)
+	{
+		result.x.q[i] = vectors[i][order[0]];
+	}
+	if (result.x.q[0] < 0)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			result.x.q[i] = -result.x.q[i];
+		}
+	}
+	result.x.normalize();
+	result.motions = n;
+
+	// translation: (R_A - I) t_X = R_X t_B - t_A, normal matrix (0-8) and
+	// right-hand side (9-11)
+	Sums<12> translation = accumulate<Sums<12>>(n, threads, [&](Sums<12>& s, size_t i) {
+		Pose a, b;
+		motions(i, a, b);
+		double r[3][3];
+		rotation_matrix(a.q, r);
+		double rhs[3];
+		result.x.rotate(b.t, rhs);
+		for (int j = 0; j < 3; j++)
+		{
+			r[j][j] -= 1;
+			rhs[j] -= a.t[j];
+		}
+		for (int row = 0; row < 3; row++)
+		{
+			for (int column = 0; column < 3; column++)
+			{
+				s.v[row * 3 + column] += r[0][row] * r[0][column] + r[1][row] * r[1][column] + r[2][row] * r[2][column];
+			}
+			s.v[9 + row] += r[0][row] * rhs[0] + r[1][row] * rhs[1] + r[2][row] * rhs[2];
+		}
+	});
+	if (!solve(translation.v, translation.v + 9, 3))
+	{
+		throw std::runtime_error("Motions do not rotate about two different axes.");
+	}
+	std::copy(translation.v + 9, translation.v + 12, result.x.t);
+
+	Sums<2> residuals = accumulate<Sums<2>>(n, threads, [&](Sums<2>& s, size_t i) {
+		Pose a, b;
+		motions(i, a, b);
+		Pose ax = a * result.x;
+		Pose xb = result.x * b;
+		Pose error = ax.inverse() * xb;
+		double angle = 2 * std::acos(std::min(1.0, std::fabs(error.q[0])));
+		s.v[0] += angle * angle;
+		for (int j = 0; j < 3; j++)
+		{
+			s.v[1] += (ax.t[j] - xb.t[j]) * (ax.t[j] - xb.t[j]);
+		}
+	});
+	result.rotation_rms = std::sqrt(residuals.v[0] / n) * 180.0 / M_PI;
+	result.translation_rms = std::sqrt(residuals.v[1] / n);
+	return result;
+}
+
+std::vector<Pose> sensor_poses(const std::vector<Sample>& samples, int sensor)
+{
+	std::vector<Pose> poses;
+	for (const auto& sample : samples)
+	{
+		if (sample.sensor == sensor && (sample.fields & SAMPLE_QUATERNION) && (sample.fields & SAMPLE_POSITION))
+		{
+			poses.push_back(Pose::from_sample(sample));
+		}
+	}
+	return poses;
+}
+
+void paired_poses(const std::vector<Sample>& samples, int hand_sensor, int eye_sensor,
+	std::vector<Pose>& hand, std::vector<Pose>& eye, double max_offset)
+{
+	const unsigned fields = SAMPLE_QUATERNION | SAMPLE_POSITION;
+	std::vector<const Sample*> hand_samples;
+	std::vector<const Sample*> eye_samples;
+	for (const auto& sample : samples)
+	{
+		if ((sample.fields & fields) != fields)
+		{
+			continue;
+		}
+		if (sample.sensor == hand_sensor)
+		{
+			hand_samples.push_back(&sample);
+		}
+		else if (sample.sensor == eye_sensor)
+		{
+			eye_samples.push_back(&sample);
+		}
+	}
+
+	hand.clear();
+	eye.clear();
+	size_t j = 0;
+	for (const Sample* sample : hand_samples)
+	{
+		// closest eye sample in time, every one is used once
+		while (j + 1 < eye_samples.size() &&
+			std::fabs(eye_samples[j + 1]->timestamp - sample->timestamp) <= std::fabs(eye_samples[j]->timestamp - sample->timestamp))
+		{
+			j++;
+		}
+		if (j < eye_samples.size() && std::fabs(eye_samples[j]->timestamp - sample->timestamp) <= max_offset)
+		{
+			hand.push_back(Pose::from_sample(*sample));
+			eye.push_back(Pose::from_sample(*eye_samples[j]));
+			j++;
+		}
+	}
+}
@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "poll_scheduler.hpp"
+
+PollScheduler::PollScheduler(const SchedulerOptions& options) : m_options(options),
+																m_cost(0),
+																m_credit(0)
+{
+}
+
+void PollScheduler::set_options(const SchedulerOptions& options)
+{
+	m_options = options;
+}
+
+const SchedulerOptions& PollScheduler::get_options() const
+{
+	return m_options;
+}
+
+void PollScheduler::next(const std::vector<int>& attached, double rate, double now, std::vector<int>& sensors)
+{
+	sensors.clear();
+	if (attached.empty() || rate <= 0)
+	{
+		return;
+	}
+	p_allocate(attached, rate);
+
+	double budget = get_budget();
+	double n = attached.size();
+	m_credit = std::min(m_credit + (budget > 0 ? budget / rate : n), n);
+
+	// sensors due within this frame, most overdue first
+	std::vector<int> due;
+	for (int sensor : attached)
+	{
+		SensorState& state = p_state(sensor);
+		if (!state.seen)
+		{
+			state.seen = true;
+			state.due = now;
+		}
+		if (state.due <= now + 0.5 / rate)
+		{
+			due.push_back(sensor);
+		}
+	}
+	std::stable_sort(due.begin(), due.end(), [&](int a, int b) { return p_state(a).due < p_state(b).due; });
+	due.resize(std::min<size_t>(due.size(), (size_t)m_credit));
+	m_credit -= due.size();
+
+	for (int sensor : due)
+	{
+		SensorState& state = p_state(sensor);
+		double period = 1.0 / state.rate;
+		// a sensor that fell behind does not catch up with a burst
+		state.due = std::max(state.due, now - period) + period;
+		state.polls++;
+	}
+	for (int sensor : attached)
+	{
+		if (std::find(due.begin(), due.end(), sensor) != due.end())
+		{
+			sensors.push_back(sensor);
+		}
+	}
+}
+
+void PollScheduler::update(const Sample& sample)
+{
+	const unsigned fields = SAMPLE_POSITION | SAMPLE_QUATERNION;
+	if ((sample.fields & fields) != fields || sample.sensor < 0)
+	{
+		return;
+	}
+
+	SensorState& state = p_state(sample.sensor);
+	if (state.has_pose)
+	{
+		double dt = sample.timestamp - state.time;
+		if (dt <= 0)
+		{
+			return;
+		}
+		double distance = 0;
+		double dot = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			distance += (sample.position[i] - state.position[i]) * (sample.position[i] - state.position[i]);
+		}
+		for (int i = 0; i < 4; i++)
+		{
+			dot += sample.quaternion[i] * state.quaternion[i];
+		}
+		double angle = 2 * std::acos(std::min(1.0, std::fabs(dot)));
+		double moved = std::sqrt(distance) + angle * m_options.lever;
+
+		// measured against the last pose that moved by at least the
+		// deadband, so noise neither adds up nor hides slow motion, and
+		// fast polls do not bias the speed
+		if (moved < m_options.deadband && dt < m_options.time_constant)
+		{
+			return;
+		}
+		double speed = moved < m_options.deadband ? 0 : moved / dt;
+		double alpha = 1 - std::exp(-dt / m_options.time_constant);
+		state.motion += alpha * (speed - state.motion);
+	}
+
+	std::copy(sample.position, sample.position + 3, state.position);
+	std::copy(sample.quaternion, sample.quaternion + 4, state.quaternion);
+	state.time = sample.timestamp;
+	state.has_pose = true;
+}
+
+void PollScheduler::account(size_t polls, double seconds)
+{
+	if (polls == 0 || seconds <= 0)
+	{
+		return;
+	}
+	double cost = seconds / polls;
+	m_cost = m_cost > 0 ? m_cost + 0.1 * (cost - m_cost) : cost;
+}
+
+double PollScheduler::get_budget() const
+{
+	if (m_options.budget > 0)
+	{
+		return m_options.budget;
+	}
+	return m_cost > 0 ? m_options.utilization / m_cost : 0;
+}
+
+std::vector<SensorSchedule> PollScheduler::get_schedule() const
+{
+	std::vector<SensorSchedule> schedule;
+	for (size_t sensor = 0; sensor < m_states.size(); sensor++)
+	{
+		const SensorState& state = m_states[sensor];
+		if (state.seen)
+		{
+			schedule.push_back({(int)sensor, p_priority(sensor), state.motion, state.rate, state.polls});
+		}
+	}
+	return schedule;
+}
+
+PollScheduler::SensorState& PollScheduler::p_state(int sensor)
+{
+	if (sensor < 0)
+	{
+		throw std::runtime_error("Invalid sensor " + std::to_string(sensor) + ".");
+	}
+	if (sensor >= (int)m_states.size())
+	{
+		m_states.resize(sensor + 1);
+	}
+	return m_states[sensor];
+}
+
+double PollScheduler::p_priority(int sensor) const
+{
+	if (sensor < (int)m_options.priorities.size())
+	{
+		return std::max(0.0, m_options.priorities[sensor]);
+	}
+	return 1;
+}
+
+void PollScheduler::p_allocate(const std::vector<int>& attached, double rate)
+{
+	double n = attached.size();
+	double budget = get_budget();
+	// until the cost of a poll is known, or if the link carries every
+	// sensor in every frame, nothing needs to be shared
+	if (budget <= 0 || budget >= rate * n)
+	{
+		for (int sensor : attached)
+		{
+			p_state(sensor).rate = rate;
+		}
+		return;
+	}
+
+	// the minimum rate first, the rest by weight, capped at the tracker
+	// rate with the excess going to the others
+	double minimum = std::min({m_options.min_rate, budget / n, rate});
+	double remaining = budget - minimum * n;
+	std::vector<int> open;
+	for (int sensor : attached)
+	{
+		p_state(sensor).rate = minimum;
+		open.push_back(sensor);
+	}
+
+	while (!open.empty() && remaining > 0)
+	{
+		double total = 0;
+		for (int sensor : open)
+		{
+			total += p_priority(sensor) * (p_state(sensor).motion + m_options.base_motion);
+		}
+		if (total <= 0)
+		{
+			break;
+		}
+
+		// sharing out the excess only raises the others, so every sensor
+		// over the cap in this pass stays over it
+		double shared = remaining;
+		bool capped = false;
+		for (auto it = open.begin(); it != open.end();)
+		{
+			SensorState& state = p_state(*it);
+			double share = shared * p_priority(*it) * (state.motion + m_options.base_motion) / total;
+			if (state.rate + share >= rate)
+			{
+				remaining -= rate - state.rate;
+				state.rate = rate;
+				it = open.erase(it);
+				capped = true;
+			}
+			else
+			{
+				++it;
+			}
+		}
+		if (!capped)
+		{
+			for (int sensor : open)
+			{
+				SensorState& state = p_state(sensor);
+				state.rate += remaining * p_priority(sensor) * (state.motion + m_options.base_motion) / total;
+			}
+			break;
+		}
+	}
+}
@@ -0,0 +1,130 @@
+#include <cmath>
+
+#include "pose.hpp"
+
+Pose Pose::from_matrix(const QuadMatrix<4>& m)
+{
+	Pose pose;
+	double (&q)[4] = pose.q;
+	double trace = m.get(0, 0) + m.get(1, 1) + m.get(2, 2);
+	if (trace > 0)
+	{
+		double s = 2.0 * std::sqrt(trace + 1.0);
+		q[0] = 0.25 * s;
+		q[1] = (m.get(2, 1) - m.get(1, 2)) / s;
+		q[2] = (m.get(0, 2) - m.get(2, 0)) / s;
+		q[3] = (m.get(1, 0) - m.get(0, 1)) / s;
+	}
+	else if (m.get(0, 0) > m.get(1, 1) && m.get(0, 0) > m.get(2, 2))
+	{
+		double s = 2.0 * std::sqrt(1.0 + m.get(0, 0) - m.get(1, 1) - m.get(2, 2));
+		q[0] = (m.get(2, 1) - m.get(1, 2)) / s;
+		q[1] = 0.25 * s;
+		q[2] = (m.get(0, 1) + m.get(1, 0)) / s;
+		q[3] = (m.get(0, 2) + m.get(2, 0)) / s;
+	}
+	else if (m.get(1, 1) > m.get(2, 2))
+	{
+		double s = 2.0 * std::sqrt(1.0 + m.get(1, 1) - m.get(0, 0) - m.get(2, 2));
+		q[0] = (m.get(0, 2) - m.get(2, 0)) / s;
+		q[1] = (m.get(0, 1) + m.get(1, 0)) / s;
+		q[2] = 0.25 * s;
+		q[3] = (m.get(1, 2) + m.get(2, 1)) / s;
+	}
+	else
+	{
+		double s = 2.0 * std::sqrt(1.0 + m.get(2, 2) - m.get(0, 0) - m.get(1, 1));
+		q[0] = (m.get(1, 0) - m.get(0, 1)) / s;
+		q[1] = (m.get(0, 2) + m.get(2, 0)) / s;
+		q[2] = (m.get(1, 2) + m.get(2, 1)) / s;
+		q[3] = 0.25 * s;
+	}
+
+	// matrices from files or the device are not exactly orthonormal
+	pose.normalize();
+	for (int i = 0; i < 3; i++)
+	{
+		pose.t[i] = m.get(i, 3);
+	}
+	return pose;
+}
+
+Pose Pose::from_sample(const Sample& sample)
+{
+	// the trakSTAR's matrix is the transpose of the rotation its quaternion
+	// describes, the pose keeps the matrix as the server always sent it
+	Pose pose;
+	pose.q[0] = sample.quaternion[0];
+	for (int i = 1; i < 4; i++)
+	{
+		pose.q[i] = -sample.quaternion[i];
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		pose.t[i] = sample.position[i];
+	}
+	pose.normalize();
+	return pose;
+}
+
+QuadMatrix<4> Pose::matrix() const
+{
+	float m[4][4];
+	to_matrix(m);
+	return QuadMatrix<4>(m);
+}
+
+void Pose::to_matrix(float (&m)[4][4]) const
+{
+	double w = q[0], x = q[1], y = q[2], z = q[3];
+
+	m[0][0] = 1 - 2 * (y * y + z * z);
+	m[0][1] = 2 * (x * y - z * w);
+	m[0][2] = 2 * (x * z + y * w);
+	m[1][0] = 2 * (x * y + z * w);
+	m[1][1] = 1 - 2 * (x * x + z * z);
+	m[1][2] = 2 * (y * z - x * w);
+	m[2][0] = 2 * (x * z - y * w);
+	m[2][1] = 2 * (y * z + x * w);
+	m[2][2] = 1 - 2 * (x * x + y * y);
+	for (int i = 0; i < 3; i++)
+	{
+		m[i][3] = t[i];
+		m[3][i] = 0;
+	}
+	m[3][3] = 1;
+}
+
+Pose Pose::slerp(const Pose& a, const Pose& b, double alpha)
+{
+	double dot = a.q[0] * b.q[0] + a.q[1] * b.q[1] + a.q[2] * b.q[2] + a.q[3] * b.q[3];
+	double sign = 1;
+	// take the shorter arc
+	if (dot < 0)
+	{
+		dot = -dot;
+		sign = -1;
+	}
+
+	double wa = 1 - alpha;
+	double wb = alpha;
+	if (dot < 0.9995)
+	{
+		double theta = std::acos(dot);
+		double sin_theta = std::sin(theta);
+		wa = std::sin((1 - alpha) * theta) / sin_theta;
+		wb = std::sin(alpha * theta) / sin_theta;
+	}
+
+	Pose pose;
+	for (int i = 0; i < 4; i++)
+	{
+		pose.q[i] = wa * a.q[i] + sign * wb * b.q[i];
+	}
+	pose.normalize();
+	for (int i = 0; i < 3; i++)
+	{
+		pose.t[i] = a.t[i] + alpha * (b.t[i] - a.t[i]);
+	}
+	return pose;
+}
@@ -0,0 +1,584 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "atc3dg.hpp"
+#include "pose_log.hpp"
+
+// largest sensor index a log accepts
+#define POSE_LOG_MAX_SENSOR 255
+
+namespace {
+
+struct ValueGroup {
+	unsigned field;
+	int first;
+	int count;
+	double step;
+};
+
+// where the fields of a sample go in the flat value array
+const ValueGroup groups[] = {
+	{SAMPLE_POSITION, 0, 3, POSE_LOG_POSITION_STEP},
+	{SAMPLE_ANGLES, 3, 3, POSE_LOG_ANGLE_STEP},
+	{SAMPLE_MATRIX, 6, 9, POSE_LOG_UNIT_STEP},
+	{SAMPLE_QUATERNION, 15, 4, POSE_LOG_UNIT_STEP},
+	{SAMPLE_QUALITY, 19, 1, POSE_LOG_UNIT_STEP}
+};
+
+void flatten(const Sample& sample, double (&values)[POSE_LOG_VALUES])
+{
+	memcpy(values + 0, sample.position, sizeof(sample.position));
+	memcpy(values + 3, sample.angles, sizeof(sample.angles));
+	memcpy(values + 6, sample.matrix, sizeof(sample.matrix));
+	memcpy(values + 15, sample.quaternion, sizeof(sample.quaternion));
+	values[19] = sample.quality;
+}
+
+void unflatten(const double (&values)[POSE_LOG_VALUES], Sample& sample)
+{
+	memcpy(sample.position, values + 0, sizeof(sample.position));
+	memcpy(sample.angles, values + 3, sizeof(sample.angles));
+	memcpy(sample.matrix, values + 6, sizeof(sample.matrix));
+	memcpy(sample.quaternion, values + 15, sizeof(sample.quaternion));
+	sample.quality = values[19];
+}
+
+int64_t quantize(double value, double step)
+{
+	return std::llround(value / step);
+}
+
+void put_varint(std::vector<uint8_t>& out, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((uint8_t)value);
+}
+
+// zigzag, small magnitudes of either sign become short varints
+void put_signed(std::vector<uint8_t>& out, int64_t value)
+{
+	put_varint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+class BlockDecoder {
+public:
+	BlockDecoder(const uint8_t* data, size_t size) : m_data(data), m_end(data + size) {}
+
+	bool done() const
+	{
+		return m_data == m_end;
+	}
+
+	uint64_t varint()
+	{
+		uint64_t value = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			if (m_data == m_end)
+			{
+				break;
+			}
+			uint8_t byte = *m_data++;
+			value |= (uint64_t)(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+			{
+				return value;
+			}
+		}
+		throw std::runtime_error("Corrupt pose log block.");
+	}
+
+	int64_t signed_varint()
+	{
+		uint64_t value = varint();
+		return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+	}
+
+private:
+	const uint8_t* m_data;
+	const uint8_t* m_end;
+};
+
+bool read_at(int fd, void* buffer, size_t size, uint64_t offset)
+{
+	char* data = static_cast<char*>(buffer);
+	while (size > 0)
+	{
+		ssize_t r = pread(fd, data, size, offset);
+		if (r <= 0)
+		{
+			return false;
+		}
+		data += r;
+		size -= r;
+		offset += r;
+	}
+	return true;
+}
+
+}
+
+PoseLogWriter::PoseLogWriter() : m_file(nullptr),
+								 m_block_samples(POSE_LOG_BLOCK_SAMPLES),
+								 m_previous_time(0),
+								 m_current()
+{
+}
+
+PoseLogWriter::~PoseLogWriter()
+{
+	close();
+}
+
+void PoseLogWriter::open(const std::string& filename, int block_samples)
+{
+	close();
+	m_file = fopen(filename.c_str(), "wb");
+	if (!m_file)
+	{
+		throw std::runtime_error("Could not create pose log " + filename + ".");
+	}
+
+	m_block_samples = block_samples < 1 ? 1 : block_samples;
+	m_index.clear();
+	m_current = PoseLogBlock();
+
+	char header[POSE_LOG_HEADER_SIZE] = {0};
+	uint32_t version = POSE_LOG_VERSION;
+	uint32_t samples = m_block_samples;
+	double clock_offset = atc3dg_wall_time(0);
+	memcpy(header, POSE_LOG_MAGIC, 8);
+	memcpy(header + 8, &version, 4);
+	memcpy(header + 12, &samples, 4);
+	memcpy(header + 16, &clock_offset, 8);
+	if (fwrite(header, POSE_LOG_HEADER_SIZE, 1, m_file) != 1)
+	{
+		throw std::runtime_error("Could not write pose log " + filename + ".");
+	}
+}
+
+void PoseLogWriter::write(const Sample& sample)
+{
+	if (!m_file)
+	{
+		throw std::runtime_error("Pose log is not open.");
+	}
+	if (sample.sensor < 0 || sample.sensor > POSE_LOG_MAX_SENSOR)
+	{
+		throw std::runtime_error("Sensor index out of range for a pose log.");
+	}
+
+	if (m_current.count == 0)
+	{
+		// every block starts from scratch
+		m_block.clear();
+		m_previous.clear();
+		m_previous_time = 0;
+		m_current.first_timestamp = sample.timestamp;
+	}
+	if (sample.sensor >= (int)m_previous.size())
+	{
+		m_previous.resize(sample.sensor + 1, State());
+	}
+	State& previous = m_previous[sample.sensor];
+
+	unsigned fields = sample.fields & SAMPLE_ALL;
+	int64_t time = quantize(sample.timestamp, POSE_LOG_TIME_STEP);
+	put_varint(m_block, sample.sensor);
+	put_varint(m_block, fields);
+	put_signed(m_block, (int64_t)(sample.sequence - previous.sequence));
+	put_signed(m_block, time - m_previous_time);
+	put_signed(m_block, time - quantize(sample.request_time, POSE_LOG_TIME_STEP));
+	previous.sequence = sample.sequence;
+	m_previous_time = time;
+
+	double values[POSE_LOG_VALUES];
+	flatten(sample, values);
+	for (const auto& group : groups)
+	{
+		if (!(fields & group.field))
+		{
+			continue;
+		}
+		for (int i = group.first; i < group.first + group.count; i++)
+		{
+			int64_t value = quantize(values[i], group.step);
+			put_signed(m_block, value - previous.values[i]);
+			previous.values[i] = value;
+		}
+	}
+	if (fields & SAMPLE_BUTTON)
+	{
+		m_block.push_back(sample.button ? 1 : 0);
+	}
+
+	m_current.last_timestamp = sample.timestamp;
+	m_current.count++;
+	if ((int)m_current.count >= m_block_samples)
+	{
+		p_flush();
+	}
+}
+
+void PoseLogWriter::close()
+{
+	if (!m_file)
+	{
+		return;
+	}
+
+	p_flush();
+	uint64_t index_offset = ftell(m_file);
+	bool ok = m_index.empty() || fwrite(m_index.data(), sizeof(PoseLogBlock), m_index.size(), m_file) == m_index.size();
+
+	char trailer[POSE_LOG_TRAILER_SIZE] = {0};
+	memcpy(trailer, &index_offset, 8);
+	memcpy(trailer + 8, POSE_LOG_INDEX_MAGIC, 8);
+	ok = ok && fwrite(trailer, POSE_LOG_TRAILER_SIZE, 1, m_file) == 1;
+
+	fclose(m_file);
+	m_file = nullptr;
+	if (!ok)
+	{
+		throw std::runtime_error("Could not write pose log index.");
+	}
+}
+
+void PoseLogWriter::p_flush()
+{
+	if (m_current.count == 0)
+	{
+		return;
+	}
+
+	// the header makes the block self-delimiting, see PoseLogReader::open()
+	char header[POSE_LOG_BLOCK_HEADER_SIZE] = {0};
+	uint32_t count = m_current.count;
+	m_current.bytes = m_block.size();
+	memcpy(header, POSE_LOG_BLOCK_MAGIC, 4);
+	memcpy(header + 4, &count, 4);
+	memcpy(header + 8, &m_current.bytes, 8);
+	memcpy(header + 16, &m_current.first_timestamp, 8);
+	memcpy(header + 24, &m_current.last_timestamp, 8);
+	m_current.offset = ftell(m_file) + POSE_LOG_BLOCK_HEADER_SIZE;
+	if (fwrite(header, POSE_LOG_BLOCK_HEADER_SIZE, 1, m_file) != 1
+		|| fwrite(m_block.data(), 1, m_block.size(), m_file) != m_block.size()
+		|| fflush(m_file) != 0)
+	{
+		throw std::runtime_error("Could not write to pose log.");
+	}
+
+	m_index.push_back(m_current);
+	uint64_t first = m_current.first + m_current.count;
+	m_current = PoseLogBlock();
+	m_current.first = first;
+}
+
+PoseLogReader::PoseLogReader() : m_fd(-1),
+								 m_size(0),
+								 m_clock_offset(0),
+								 m_block(0),
+								 m_consumed(0)
+{
+}
+
+PoseLogReader::~PoseLogReader()
+{
+	close();
+}
+
+void PoseLogReader::open(const std::string& filename)
+{
+	close();
+	m_fd = ::open(filename.c_str(), O_RDONLY);
+	if (m_fd < 0)
+	{
+		throw std::runtime_error("Could not open pose log " + filename + ".");
+	}
+
+	struct stat info;
+	char header[POSE_LOG_HEADER_SIZE] = {0};
+	uint32_t version = 0;
+	bool ok = fstat(m_fd, &info) == 0
+		&& info.st_size >= POSE_LOG_HEADER_SIZE
+		&& read_at(m_fd, header, POSE_LOG_HEADER_SIZE, 0);
+	if (ok)
+	{
+		memcpy(&version, header + 8, 4);
+		memcpy(&m_clock_offset, header + 16, 8);
+	}
+	if (!ok || memcmp(header, POSE_LOG_MAGIC, 8) != 0 || version != POSE_LOG_VERSION)
+	{
+		close();
+		throw std::runtime_error(filename + " is not a pose log.");
+	}
+
+	try
+	{
+		if (!p_read_index(filename, info.st_size))
+		{
+			// interrupted recording
+			p_scan_blocks(info.st_size);
+		}
+	}
+	catch (...)
+	{
+		close();
+		throw;
+	}
+}
+
+bool PoseLogReader::p_read_index(const std::string& filename, uint64_t size)
+{
+	char trailer[POSE_LOG_TRAILER_SIZE] = {0};
+	uint64_t index_offset = 0;
+	if (size < POSE_LOG_HEADER_SIZE + POSE_LOG_TRAILER_SIZE
+		|| !read_at(m_fd, trailer, POSE_LOG_TRAILER_SIZE, size - POSE_LOG_TRAILER_SIZE))
+	{
+		return false;
+	}
+	memcpy(&index_offset, trailer, 8);
+	uint64_t index_end = size - POSE_LOG_TRAILER_SIZE;
+	if (memcmp(trailer + 8, POSE_LOG_INDEX_MAGIC, 8) != 0
+		|| index_offset < POSE_LOG_HEADER_SIZE || index_offset > index_end
+		|| (index_end - index_offset) % sizeof(PoseLogBlock) != 0)
+	{
+		return false;
+	}
+
+	m_index.resize((index_end - index_offset) / sizeof(PoseLogBlock));
+	if (!m_index.empty() && !read_at(m_fd, m_index.data(), m_index.size() * sizeof(PoseLogBlock), index_offset))
+	{
+		throw std::runtime_error("Could not read the index of " + filename + ".");
+	}
+	for (const auto& block : m_index)
+	{
+		if (block.first != m_size || block.offset + block.bytes > index_offset)
+		{
+			throw std::runtime_error("Corrupt index in " + filename + ".");
+		}
+		m_size += block.count;
+	}
+	return true;
+}
+
+void PoseLogReader::p_scan_blocks(uint64_t size)
+{
+	uint64_t offset = POSE_LOG_HEADER_SIZE;
+	char header[POSE_LOG_BLOCK_HEADER_SIZE];
+	while (offset + POSE_LOG_BLOCK_HEADER_SIZE <= size
+		&& read_at(m_fd, header, POSE_LOG_BLOCK_HEADER_SIZE, offset)
+		&& memcmp(header, POSE_LOG_BLOCK_MAGIC, 4) == 0)
+	{
+		PoseLogBlock block = PoseLogBlock();
+		uint32_t count = 0;
+		memcpy(&count, header + 4, 4);
+		memcpy(&block.bytes, header + 8, 8);
+		memcpy(&block.first_timestamp, header + 16, 8);
+		memcpy(&block.last_timestamp, header + 24, 8);
+		block.offset = offset + POSE_LOG_BLOCK_HEADER_SIZE;
+		if (count == 0 || block.bytes > size - block.offset)
+		{
+			// the block being written when the recording stopped
+			break;
+		}
+		block.first = m_size;
+		block.count = count;
+		m_index.push_back(block);
+		m_size += count;
+		offset = block.offset + block.bytes;
+	}
+}
+
+void PoseLogReader::close()
+{
+	if (m_fd >= 0)
+	{
+		::close(m_fd);
+		m_fd = -1;
+	}
+	m_index.clear();
+	m_samples.clear();
+	m_size = 0;
+	m_clock_offset = 0;
+	m_block = 0;
+	m_consumed = 0;
+}
+
+size_t PoseLogReader::size() const
+{
+	return m_size;
+}
+
+double PoseLogReader::clock_offset() const
+{
+	return m_clock_offset;
+}
+
+const std::vector<PoseLogBlock>& PoseLogReader::blocks() const
+{
+	return m_index;
+}
+
+bool PoseLogReader::seek_time(double timestamp)
+{
+	// first block that ends at or after the timestamp
+	auto it = std::lower_bound(m_index.begin(), m_index.end(), timestamp,
+		[](const PoseLogBlock& block, double t) { return block.last_timestamp < t; });
+	if (it == m_index.end())
+	{
+		m_block = m_index.size();
+		m_samples.clear();
+		m_consumed = 0;
+		return false;
+	}
+
+	m_block = it - m_index.begin();
+	decode_block(m_block++, m_samples);
+	auto sample = std::lower_bound(m_samples.begin(), m_samples.end(), timestamp,
+		[](const Sample& s, double t) { return s.timestamp < t; });
+	m_consumed = sample - m_samples.begin();
+	return true;
+}
+
+bool PoseLogReader::read(Sample& sample)
+{
+	while (m_consumed == m_samples.size())
+	{
+		if (m_block >= m_index.size())
+		{
+			return false;
+		}
+		decode_block(m_block++, m_samples);
+		m_consumed = 0;
+	}
+	sample = m_samples[m_consumed++];
+	return true;
+}
+
+void PoseLogReader::decode_block(size_t block, std::vector<Sample>& samples) const
+{
+	if (m_fd < 0 || block >= m_index.size())
+	{
+		throw std::runtime_error("Pose log block out of range.");
+	}
+
+	const PoseLogBlock& info = m_index[block];
+	std::vector<uint8_t> data(info.bytes);
+	if (!read_at(m_fd, data.data(), data.size(), info.offset))
+	{
+		throw std::runtime_error("Could not read pose log block.");
+	}
+
+	BlockDecoder decoder(data.data(), data.size());
+	std::vector<uint64_t> sequences;
+	std::vector<int64_t> previous;
+	int64_t time = 0;
+
+	samples.resize(info.count);
+	for (auto& sample : samples)
+	{
+		sample = Sample();
+		uint64_t sensor = decoder.varint();
+		if (sensor > POSE_LOG_MAX_SENSOR)
+		{
+			throw std::runtime_error("Corrupt pose log block.");
+		}
+		if (sensor >= sequences.size())
+		{
+			sequences.resize(sensor + 1, 0);
+			previous.resize((sensor + 1) * POSE_LOG_VALUES, 0);
+		}
+
+		sample.sensor = (int)sensor;
+		sample.fields = decoder.varint() & SAMPLE_ALL;
+		sequences[sensor] += decoder.signed_varint();
+		sample.sequence = sequences[sensor];
+		time += decoder.signed_varint();
+		sample.timestamp = time * POSE_LOG_TIME_STEP;
+		sample.request_time = (time - decoder.signed_varint()) * POSE_LOG_TIME_STEP;
+
+		double values[POSE_LOG_VALUES] = {0};
+		int64_t* state = &previous[sensor * POSE_LOG_VALUES];
+		for (const auto& group : groups)
+		{
+			if (!(sample.fields & group.field))
+			{
+				continue;
+			}
+			for (int i = group.first; i < group.first + group.count; i++)
+			{
+				state[i] += decoder.signed_varint();
+				values[i] = state[i] * group.step;
+			}
+		}
+		unflatten(values, sample);
+		if (sample.fields & SAMPLE_BUTTON)
+		{
+			sample.button = decoder.varint() != 0;
+		}
+	}
+	if (!decoder.done())
+	{
+		throw std::runtime_error("Corrupt pose log block.");
+	}
+}
+
+void PoseLogReader::read_all(std::vector<Sample>& samples, int threads) const
+{
+	if (threads <= 0)
+	{
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	threads = std::min<int>(threads, std::max<size_t>(1, m_index.size()));
+
+	samples.resize(m_size);
+	std::atomic<size_t> next(0);
+	std::vector<std::string> errors(threads);
+	auto work = [&](int worker) {
+		std::vector<Sample> block;
+		try
+		{
+			for (size_t i = next++; i < m_index.size(); i = next++)
+			{
+				decode_block(i, block);
+				std::copy(block.begin(), block.end(), samples.begin() + m_index[i].first);
+			}
+		}
+		catch (const std::exception& e)
+		{
+			errors[worker] = e.what();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (int worker = 1; worker < threads; worker++)
+	{
+		workers.emplace_back(work, worker);
+	}
+	work(0);
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+
+	for (const auto& error : errors)
+	{
+		if (!error.empty())
+		{
+			throw std::runtime_error(error);
+		}
+	}
+}
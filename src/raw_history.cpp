@@ -0,0 +1,184 @@
+#include <algorithm>
+
+#include "raw_history.hpp"
+
+namespace {
+
+double fraction(int16_t word)
+{
+	return (double)word / 0x8000;
+}
+
+}
+
+void raw_sample_decode(int sensor, const RawSample& raw, unsigned fields, Sample& sample)
+{
+	sample.sensor = sensor;
+	sample.sequence = raw.sequence;
+	sample.request_time = raw.request_time;
+	sample.timestamp = raw.timestamp;
+	sample.fields = fields;
+
+	if (fields & SAMPLE_POSITION)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			sample.position[i] = 36.0 * raw.scaling * fraction(raw.words[RAW_WORD_POSITION + i]) * 25.4;
+		}
+	}
+
+	if (fields & SAMPLE_MATRIX)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				sample.matrix[i][j] = fraction(raw.words[RAW_WORD_MATRIX + i * 3 + j]);
+			}
+		}
+	}
+
+	if (fields & SAMPLE_ANGLES)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			sample.angles[i] = 180.0 * fraction(raw.words[RAW_WORD_ANGLES + i]);
+		}
+	}
+
+	if (fields & SAMPLE_QUATERNION)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			sample.quaternion[i] = fraction(raw.words[RAW_WORD_QUATERNION + i]);
+		}
+	}
+
+	if (fields & SAMPLE_QUALITY)
+	{
+		sample.quality = fraction(raw.words[RAW_WORD_QUALITY]);
+	}
+
+	if (fields & SAMPLE_BUTTON)
+	{
+		sample.button = raw.button != 0;
+	}
+}
+
+RawHistory::RawHistory(size_t capacity, int sensors) : m_sensors(std::max(sensors, 1))
+{
+	// one slot more, the one the producer writes next
+	size_t size = 2;
+	while (size < capacity + 1)
+	{
+		size <<= 1;
+	}
+	m_mask = size - 1;
+	m_slots.resize(size * m_sensors);
+	m_heads.reset(new std::atomic<uint64_t>[m_sensors]());
+}
+
+void RawHistory::push(int sensor, const RawSample& raw)
+{
+	if (!p_valid(sensor))
+	{
+		return;
+	}
+	uint64_t head = m_heads[sensor].load(std::memory_order_relaxed);
+	m_slots[sensor * (m_mask + 1) + (head & m_mask)] = raw;
+	m_heads[sensor].store(head + 1, std::memory_order_release);
+}
+
+uint64_t RawHistory::count(int sensor) const
+{
+	return p_valid(sensor) ? m_heads[sensor].load(std::memory_order_acquire) : 0;
+}
+
+size_t RawHistory::capacity() const
+{
+	return m_mask;
+}
+
+int RawHistory::sensors() const
+{
+	return m_sensors;
+}
+
+size_t RawHistory::memory() const
+{
+	return m_slots.size() * sizeof(RawSample);
+}
+
+size_t RawHistory::latest(int sensor, size_t n, std::vector<RawSample>& raw) const
+{
+	raw.clear();
+	if (!p_valid(sensor))
+	{
+		return 0;
+	}
+
+	size_t size = m_mask + 1;
+	const RawSample* slots = m_slots.data() + sensor * size;
+	uint64_t head = m_heads[sensor].load(std::memory_order_acquire);
+	uint64_t first = head - std::min<uint64_t>({(uint64_t)n, head, (uint64_t)capacity()});
+	for (uint64_t i = first; i < head; i++)
+	{
+		raw.push_back(slots[i & m_mask]);
+	}
+
+	// the producer may be writing sample now over sample now - size
+	std::atomic_thread_fence(std::memory_order_acquire);
+	uint64_t now = m_heads[sensor].load(std::memory_order_relaxed);
+	uint64_t valid = now >= size ? now - size + 1 : 0;
+	if (valid > first)
+	{
+		raw.erase(raw.begin(), raw.begin() + std::min<uint64_t>(valid - first, raw.size()));
+	}
+	return raw.size();
+}
+
+size_t RawHistory::decode(int sensor, size_t n, unsigned fields, std::vector<Sample>& samples) const
+{
+	std::vector<RawSample> raw;
+	latest(sensor, n, raw);
+	samples.resize(raw.size());
+	for (size_t i = 0; i < raw.size(); i++)
+	{
+		raw_sample_decode(sensor, raw[i], fields, samples[i]);
+	}
+	return samples.size();
+}
+
+size_t RawHistory::decode_range(int sensor, double begin, double end, unsigned fields, std::vector<Sample>& samples) const
+{
+	samples.clear();
+	std::vector<RawSample> raw;
+	latest(sensor, capacity(), raw);
+	// timestamps increase, the first after begin is found by bisection
+	auto from = std::lower_bound(raw.begin(), raw.end(), begin, [](const RawSample& r, double t) { return r.timestamp < t; });
+	for (auto it = from; it != raw.end() && it->timestamp <= end; ++it)
+	{
+		samples.emplace_back();
+		raw_sample_decode(sensor, *it, fields, samples.back());
+	}
+	return samples.size();
+}
+
+size_t RawHistory::read_batch(int sensor, size_t n, const SampleBatch& batch) const
+{
+	std::vector<RawSample> raw;
+	latest(sensor, n, raw);
+	unsigned fields = sample_batch_fields(batch);
+	Sample sample;
+	for (size_t row = 0; row < raw.size(); row++)
+	{
+		raw_sample_decode(sensor, raw[row], fields, sample);
+		sample_batch_store(batch, row, sample);
+	}
+	return raw.size();
+}
+
+bool RawHistory::p_valid(int sensor) const
+{
+	return sensor >= 0 && sensor < m_sensors;
+}
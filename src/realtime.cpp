@@ -0,0 +1,153 @@
+#include <alloca.h>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "realtime.hpp"
+
+namespace {
+
+void prefault_stack(size_t bytes)
+{
+	volatile unsigned char* stack = static_cast<volatile unsigned char*>(alloca(bytes));
+	long page = sysconf(_SC_PAGESIZE);
+	for (size_t i = 0; i < bytes; i += page)
+	{
+		stack[i] = 0;
+	}
+}
+
+}
+
+std::vector<std::string> apply_realtime(const RealtimeOptions& options)
+{
+	std::vector<std::string> errors;
+
+	if (options.lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+	{
+		errors.push_back(std::string("Could not lock memory: ") + strerror(errno) +
+			" (needs CAP_IPC_LOCK or a larger RLIMIT_MEMLOCK)");
+	}
+
+	if (!options.cpus.empty())
+	{
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (int cpu : options.cpus)
+		{
+			CPU_SET(cpu, &set);
+		}
+		int r = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+		if (r != 0)
+		{
+			errors.push_back(std::string("Could not set CPU affinity: ") + strerror(r));
+		}
+	}
+
+	if (options.priority > 0)
+	{
+		sched_param param;
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = options.priority;
+		int r = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if (r != 0)
+		{
+			errors.push_back("Could not use SCHED_FIFO priority " + std::to_string(options.priority) + ": " +
+				strerror(r) + " (needs CAP_SYS_NICE or an rtprio limit)");
+		}
+	}
+
+	if (options.prefault_stack > 0)
+	{
+		prefault_stack(options.prefault_stack);
+	}
+
+	return errors;
+}
+
+GapStats::GapStats(double threshold) : m_threshold(threshold)
+{
+	reset();
+}
+
+void GapStats::add(double timestamp)
+{
+	if (m_last > 0)
+	{
+		double gap = timestamp - m_last;
+		m_count++;
+		m_sum += gap;
+		m_sum_squares += gap * gap;
+		if (gap > m_max)
+		{
+			m_max = gap;
+		}
+		if (gap > m_threshold)
+		{
+			m_over_threshold++;
+		}
+	}
+	m_last = timestamp;
+}
+
+void GapStats::reset()
+{
+	m_last = 0;
+	m_count = 0;
+	m_sum = 0;
+	m_sum_squares = 0;
+	m_max = 0;
+	m_over_threshold = 0;
+}
+
+uint64_t GapStats::count() const
+{
+	return m_count;
+}
+
+double GapStats::mean() const
+{
+	return m_count > 0 ? m_sum / m_count : 0;
+}
+
+double GapStats::stddev() const
+{
+	if (m_count < 2)
+	{
+		return 0;
+	}
+	double mean = this->mean();
+	double variance = m_sum_squares / m_count - mean * mean;
+	return variance > 0 ? std::sqrt(variance) : 0;
+}
+
+double GapStats::max() const
+{
+	return m_max;
+}
+
+double GapStats::threshold() const
+{
+	return m_threshold;
+}
+
+uint64_t GapStats::over_threshold() const
+{
+	return m_over_threshold;
+}
+
+std::string GapStats::summary() const
+{
+	std::stringstream strstr;
+	strstr.precision(2);
+	strstr << std::fixed << m_count << " frame intervals, mean " << mean() * 1000 << " ms, stddev "
+		   << stddev() * 1000 << " ms, max " << max() * 1000 << " ms, " << m_over_threshold
+		   << " gaps over " << m_threshold * 1000 << " ms";
+	return strstr.str();
+}
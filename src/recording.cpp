@@ -0,0 +1,246 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "atc3dg.hpp"
+#include "recording.hpp"
+
+// records read ahead per fread()
+#define RECORDING_READ_AHEAD 256
+
+namespace {
+
+void encode_record(const Sample& sample, char* record)
+{
+	int32_t sensor = sample.sensor;
+	uint32_t fields = sample.fields;
+	uint8_t button = sample.button ? 1 : 0;
+
+	memset(record, 0, RECORDING_RECORD_SIZE);
+	memcpy(record + 0, &sensor, 4);
+	memcpy(record + 4, &fields, 4);
+	memcpy(record + 8, &sample.sequence, 8);
+	memcpy(record + 16, &sample.request_time, 8);
+	memcpy(record + 24, &sample.timestamp, 8);
+	memcpy(record + 32, sample.position, 24);
+	memcpy(record + 56, sample.angles, 24);
+	memcpy(record + 80, sample.matrix, 72);
+	memcpy(record + 152, sample.quaternion, 32);
+	memcpy(record + 184, &sample.quality, 8);
+	memcpy(record + 192, &button, 1);
+}
+
+void decode_record(const char* record, Sample& sample)
+{
+	int32_t sensor;
+	uint32_t fields;
+	uint8_t button;
+
+	memcpy(&sensor, record + 0, 4);
+	memcpy(&fields, record + 4, 4);
+	memcpy(&sample.sequence, record + 8, 8);
+	memcpy(&sample.request_time, record + 16, 8);
+	memcpy(&sample.timestamp, record + 24, 8);
+	memcpy(sample.position, record + 32, 24);
+	memcpy(sample.angles, record + 56, 24);
+	memcpy(sample.matrix, record + 80, 72);
+	memcpy(sample.quaternion, record + 152, 32);
+	memcpy(&sample.quality, record + 184, 8);
+	memcpy(&button, record + 192, 1);
+
+	sample.sensor = sensor;
+	sample.fields = fields;
+	sample.button = button != 0;
+}
+
+}
+
+RecordingWriter::RecordingWriter() : m_file(nullptr)
+{
+}
+
+RecordingWriter::~RecordingWriter()
+{
+	close();
+}
+
+void RecordingWriter::open(const std::string& filename)
+{
+	close();
+	m_file = fopen(filename.c_str(), "wb");
+	if (!m_file)
+	{
+		throw std::runtime_error("Could not create capture " + filename + ".");
+	}
+
+	char header[RECORDING_HEADER_SIZE] = {0};
+	uint32_t version = RECORDING_VERSION;
+	uint32_t record_size = RECORDING_RECORD_SIZE;
+	double clock_offset = atc3dg_wall_time(0);
+	memcpy(header, RECORDING_MAGIC, 8);
+	memcpy(header + 8, &version, 4);
+	memcpy(header + 12, &record_size, 4);
+	memcpy(header + 16, &clock_offset, 8);
+	if (fwrite(header, RECORDING_HEADER_SIZE, 1, m_file) != 1)
+	{
+		throw std::runtime_error("Could not write capture " + filename + ".");
+	}
+}
+
+void RecordingWriter::write(const Sample& sample)
+{
+	if (!m_file)
+	{
+		throw std::runtime_error("Capture is not open.");
+	}
+
+	char record[RECORDING_RECORD_SIZE];
+	encode_record(sample, record);
+	if (fwrite(record, RECORDING_RECORD_SIZE, 1, m_file) != 1)
+	{
+		throw std::runtime_error("Could not write to capture.");
+	}
+}
+
+void RecordingWriter::close()
+{
+	if (m_file)
+	{
+		fclose(m_file);
+		m_file = nullptr;
+	}
+}
+
+RecordingReader::RecordingReader() : m_file(nullptr),
+									 m_size(0),
+									 m_header_size(RECORDING_HEADER_SIZE),
+									 m_clock_offset(0),
+									 m_buffered(0),
+									 m_consumed(0)
+{
+}
+
+RecordingReader::~RecordingReader()
+{
+	close();
+}
+
+void RecordingReader::open(const std::string& filename)
+{
+	close();
+	m_file = fopen(filename.c_str(), "rb");
+	if (!m_file)
+	{
+		throw std::runtime_error("Could not open capture " + filename + ".");
+	}
+
+	char header[RECORDING_HEADER_SIZE] = {0};
+	uint32_t version = 0;
+	uint32_t record_size = 0;
+	// version 1 headers end before the clock offset
+	if (fread(header, 16, 1, m_file) == 1)
+	{
+		memcpy(&version, header + 8, 4);
+		memcpy(&record_size, header + 12, 4);
+	}
+	m_header_size = version == 1 ? 16 : RECORDING_HEADER_SIZE;
+	m_clock_offset = 0;
+	if (version == RECORDING_VERSION && fread(header + 16, RECORDING_HEADER_SIZE - 16, 1, m_file) == 1)
+	{
+		memcpy(&m_clock_offset, header + 16, 8);
+	}
+	else if (version != 1)
+	{
+		version = 0;
+	}
+	if (memcmp(header, RECORDING_MAGIC, 8) != 0 || version == 0 || record_size != RECORDING_RECORD_SIZE)
+	{
+		close();
+		throw std::runtime_error(filename + " is not a supported capture.");
+	}
+
+	fseek(m_file, 0, SEEK_END);
+	long length = ftell(m_file);
+	m_size = (length - m_header_size) / RECORDING_RECORD_SIZE;
+	seek(0);
+
+	m_buffer.resize(RECORDING_READ_AHEAD * RECORDING_RECORD_SIZE);
+}
+
+void RecordingReader::close()
+{
+	if (m_file)
+	{
+		fclose(m_file);
+		m_file = nullptr;
+	}
+	m_size = 0;
+	m_clock_offset = 0;
+	m_buffered = 0;
+	m_consumed = 0;
+}
+
+size_t RecordingReader::size() const
+{
+	return m_size;
+}
+
+double RecordingReader::clock_offset() const
+{
+	return m_clock_offset;
+}
+
+void RecordingReader::seek(size_t index)
+{
+	if (!m_file)
+	{
+		throw std::runtime_error("Capture is not open.");
+	}
+	if (index > m_size)
+	{
+		index = m_size;
+	}
+	fseek(m_file, m_header_size + (long)index * RECORDING_RECORD_SIZE, SEEK_SET);
+	m_buffered = 0;
+	m_consumed = 0;
+}
+
+bool RecordingReader::read(Sample& sample)
+{
+	if (m_consumed == m_buffered && !p_fill())
+	{
+		return false;
+	}
+	decode_record(&m_buffer[m_consumed * RECORDING_RECORD_SIZE], sample);
+	m_consumed++;
+	return true;
+}
+
+size_t RecordingReader::read_batch(const int* sensors, int n_sensors, size_t n, const SampleBatch& batch)
+{
+	Sample sample;
+	size_t row = 0;
+	while (row < n && read(sample))
+	{
+		bool wanted = n_sensors == 0;
+		for (int k = 0; k < n_sensors && !wanted; k++)
+		{
+			wanted = sensors[k] == sample.sensor;
+		}
+		if (wanted)
+		{
+			sample_batch_store(batch, row++, sample);
+		}
+	}
+	return row;
+}
+
+bool RecordingReader::p_fill()
+{
+	if (!m_file)
+	{
+		return false;
+	}
+	m_buffered = fread(m_buffer.data(), RECORDING_RECORD_SIZE, RECORDING_READ_AHEAD, m_file);
+	m_consumed = 0;
+	return m_buffered > 0;
+}
@@ -0,0 +1,110 @@
+#include "resampler.hpp"
+
+Resampler::Resampler(int history) : m_capacity(history < 2 ? 2 : history)
+{
+}
+
+void Resampler::push(int sensor, double timestamp, const Pose& pose)
+{
+	if (sensor < 0)
+	{
+		return;
+	}
+	if (sensor >= (int)m_histories.size())
+	{
+		m_histories.resize(sensor + 1);
+	}
+
+	History& history = m_histories[sensor];
+	if (history.entries.empty())
+	{
+		history.entries.resize(m_capacity);
+		history.head = 0;
+		history.count = 0;
+	}
+
+	history.head = (history.head + 1) % m_capacity;
+	if (history.count < m_capacity)
+	{
+		history.count++;
+	}
+
+	Entry& entry = history.entries[history.head];
+	entry.timestamp = timestamp;
+	entry.pose = pose;
+}
+
+void Resampler::clear()
+{
+	m_histories.clear();
+}
+
+double Resampler::latest(int sensor) const
+{
+	if (sensor < 0 || sensor >= (int)m_histories.size() || m_histories[sensor].count == 0)
+	{
+		return 0;
+	}
+	return p_entry(m_histories[sensor], 0).timestamp;
+}
+
+double Resampler::common_timestamp(const std::vector<int>& sensors) const
+{
+	double timestamp = 0;
+	bool first = true;
+	for (int sensor : sensors)
+	{
+		double t = latest(sensor);
+		if (t <= 0)
+		{
+			continue;
+		}
+		if (first || t < timestamp)
+		{
+			timestamp = t;
+			first = false;
+		}
+	}
+	return timestamp;
+}
+
+bool Resampler::sample(int sensor, double timestamp, Pose& pose) const
+{
+	if (sensor < 0 || sensor >= (int)m_histories.size() || m_histories[sensor].count == 0)
+	{
+		return false;
+	}
+
+	const History& history = m_histories[sensor];
+
+	// walk back from the newest sample to the pair enclosing the timestamp
+	const Entry* newer = &p_entry(history, 0);
+	if (timestamp >= newer->timestamp)
+	{
+		pose = newer->pose;
+		return true;
+	}
+
+	for (int age = 1; age < history.count; age++)
+	{
+		const Entry* older = &p_entry(history, age);
+		if (older->timestamp <= timestamp)
+		{
+			double span = newer->timestamp - older->timestamp;
+			double alpha = span > 0 ? (timestamp - older->timestamp) / span : 1.0;
+
+			pose = Pose::slerp(older->pose, newer->pose, alpha);
+			return true;
+		}
+		newer = older;
+	}
+
+	// older than the whole history
+	pose = newer->pose;
+	return true;
+}
+
+const Resampler::Entry& Resampler::p_entry(const History& history, int age) const
+{
+	return history.entries[(history.head - age + m_capacity) % m_capacity];
+}
@@ -0,0 +1,309 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "synthetic_tracker.hpp"
+
+// seconds a step position is held
+#define SYNTHETIC_STEP_PERIOD 2.0
+// seconds a button press lasts
+#define SYNTHETIC_PRESS_DURATION 0.1
+// random walks stay within this distance (mm) of the sensor's home
+#define SYNTHETIC_WALK_RANGE 150.0
+
+namespace {
+
+const double pi = 3.14159265358979323846;
+
+// indexed by SyntheticMotion
+const char* motion_names[] = {"static", "sine", "walk", "step", "mixed"};
+
+// cheap deterministic hash, see splitmix64
+uint64_t mix(uint64_t x)
+{
+	x += 0x9E3779B97F4A7C15ull;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
+}
+
+// uniform in [0, 1) from a hash of the arguments
+double uniform(uint64_t seed, uint64_t sensor, uint64_t slot, uint64_t channel)
+{
+	uint64_t h = mix(mix(mix(mix(seed) ^ sensor) ^ slot) ^ channel);
+	return (h >> 11) * (1.0 / 9007199254740992.0);
+}
+
+SyntheticMotion sensor_motion(SyntheticMotion motion, int sensor)
+{
+	if (motion != SYNTHETIC_MIXED)
+	{
+		return motion;
+	}
+	const SyntheticMotion cycle[] = {SYNTHETIC_SINE, SYNTHETIC_RANDOM_WALK, SYNTHETIC_STEP};
+	return cycle[sensor % 3];
+}
+
+// matrix and quaternion of azimuth (z), elevation (y) and roll (x) in
+// degrees; like the trakSTAR's, the matrix is the transpose of the rotation
+// of the quaternion
+void set_orientation(Sample& sample)
+{
+	double a = sample.angles[0] * pi / 180;
+	double e = sample.angles[1] * pi / 180;
+	double r = sample.angles[2] * pi / 180;
+	double ca = std::cos(a), sa = std::sin(a);
+	double ce = std::cos(e), se = std::sin(e);
+	double cr = std::cos(r), sr = std::sin(r);
+
+	sample.matrix[0][0] = ca * ce;
+	sample.matrix[0][1] = sa * ce;
+	sample.matrix[0][2] = -se;
+	sample.matrix[1][0] = ca * se * sr - sa * cr;
+	sample.matrix[1][1] = sa * se * sr + ca * cr;
+	sample.matrix[1][2] = ce * sr;
+	sample.matrix[2][0] = ca * se * cr + sa * sr;
+	sample.matrix[2][1] = sa * se * cr - ca * sr;
+	sample.matrix[2][2] = ce * cr;
+
+	double cha = std::cos(a / 2), sha = std::sin(a / 2);
+	double che = std::cos(e / 2), she = std::sin(e / 2);
+	double chr = std::cos(r / 2), shr = std::sin(r / 2);
+	sample.quaternion[0] = cha * che * chr + sha * she * shr;
+	sample.quaternion[1] = cha * che * shr - sha * she * chr;
+	sample.quaternion[2] = cha * she * chr + sha * che * shr;
+	sample.quaternion[3] = sha * che * chr - cha * she * shr;
+}
+
+}
+
+SyntheticMotion synthetic_motion(const std::string& name)
+{
+	for (int motion = SYNTHETIC_STATIC; motion <= SYNTHETIC_MIXED; motion++)
+	{
+		if (name == motion_names[motion])
+		{
+			return (SyntheticMotion)motion;
+		}
+	}
+	throw std::runtime_error("Unknown synthetic motion " + name + ".");
+}
+
+SyntheticTracker::SyntheticTracker(const SyntheticOptions& options) : m_options(options),
+																	  m_start(0),
+																	  m_connected(false),
+																	  m_synthetic_sequence(0)
+{
+	if (m_options.sensors < 1)
+	{
+		m_options.sensors = 1;
+	}
+	m_options.rate = std::min(std::max(m_options.rate, get_min_rate()), get_max_rate());
+}
+
+SyntheticTracker::~SyntheticTracker()
+{
+	// the acquisition thread calls into this object
+	stop();
+}
+
+void SyntheticTracker::connect()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_states.clear();
+	m_states.resize(m_options.sensors);
+	for (int sensor = 0; sensor < m_options.sensors; sensor++)
+	{
+		SensorState& state = m_states[sensor];
+		state.random.seed((unsigned)mix(m_options.seed * 1000003ull + sensor));
+		std::fill(state.walk, state.walk + 6, 0.0);
+		state.last_time = 0;
+	}
+	m_start = atc3dg_time();
+	m_synthetic_sequence = 0;
+	m_connected = true;
+}
+
+void SyntheticTracker::disconnect()
+{
+	stop();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_connected = false;
+}
+
+bool SyntheticTracker::recover(int /* timeout */)
+{
+	return good();
+}
+
+int SyntheticTracker::get_number_sensors()
+{
+	return m_options.sensors;
+}
+
+std::vector<SensorInfo> SyntheticTracker::get_topology() const
+{
+	std::vector<SensorInfo> topology;
+	for (int port = 0; port < m_options.sensors; port++)
+	{
+		topology.push_back({port, true, 1000 + port, "Synthetic", std::string("SYN-") + motion_names[sensor_motion(m_options.motion, port)]});
+	}
+	return topology;
+}
+
+bool SyntheticTracker::is_attached(int port) const
+{
+	return port >= 0 && port < m_options.sensors;
+}
+
+bool SyntheticTracker::refresh_topology()
+{
+	return false;
+}
+
+void SyntheticTracker::set_rate(double rate)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_options.rate = std::min(std::max(rate, get_min_rate()), get_max_rate());
+}
+
+double SyntheticTracker::get_rate() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_options.rate;
+}
+
+double SyntheticTracker::get_min_rate() const
+{
+	return 1;
+}
+
+double SyntheticTracker::get_max_rate() const
+{
+	return 10000;
+}
+
+bool SyntheticTracker::good() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_connected;
+}
+
+bool SyntheticTracker::poll(int sensor, Sample& sample, unsigned fields)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_connected || !is_attached(sensor))
+	{
+		return false;
+	}
+
+	sample.request_time = atc3dg_time();
+	p_pose(sensor, sample.request_time - m_start, sample);
+
+	std::normal_distribution<double> noise(0, m_options.noise);
+	SensorState& state = m_states[sensor];
+	for (int i = 0; i < 3 && m_options.noise > 0; i++)
+	{
+		sample.position[i] += noise(state.random);
+	}
+
+	sample.sequence = m_synthetic_sequence++;
+	sample.timestamp = sample.request_time;
+	sample.fields = fields;
+	return true;
+}
+
+size_t SyntheticTracker::poll_all(const std::vector<int>& sensors, std::vector<Sample>& samples, unsigned fields)
+{
+	samples.clear();
+	Sample sample;
+	for (int sensor : sensors)
+	{
+		if (poll(sensor, sample, fields))
+		{
+			samples.push_back(sample);
+		}
+	}
+	return samples.size();
+}
+
+void SyntheticTracker::pose(int sensor, double t, Sample& sample)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (sensor < 0 || sensor >= (int)m_states.size())
+	{
+		throw std::runtime_error("No synthetic sensor " + std::to_string(sensor) + ".");
+	}
+	p_pose(sensor, t, sample);
+}
+
+void SyntheticTracker::p_pose(int sensor, double t, Sample& sample)
+{
+	SensorState& state = m_states[sensor];
+	uint64_t seed = m_options.seed;
+
+	sample.sensor = sensor;
+	// sensors are spread over a grid in front of the transmitter
+	double home[3] = {250.0 + 25 * (sensor % 8), -100.0 + 25 * (sensor / 8 % 8), 100.0 - 25 * (sensor / 64 % 8)};
+	double offset[6] = {0, 0, 0, 0, 0, 0};
+
+	switch (sensor_motion(m_options.motion, sensor))
+	{
+	case SYNTHETIC_STATIC:
+	case SYNTHETIC_MIXED:
+		break;
+	case SYNTHETIC_SINE:
+	{
+		// each axis at its own frequency around 0.2-0.5 Hz
+		for (int i = 0; i < 6; i++)
+		{
+			double frequency = 0.2 + 0.3 * uniform(seed, sensor, 0, i);
+			double phase = 2 * pi * uniform(seed, sensor, 1, i);
+			double amplitude = i < 3 ? 50 : (i == 4 ? 20 : 45);
+			offset[i] = amplitude * std::sin(2 * pi * frequency * t + phase);
+		}
+		break;
+	}
+	case SYNTHETIC_RANDOM_WALK:
+	{
+		std::normal_distribution<double> normal;
+		double dt = std::max(0.0, t - state.last_time);
+		state.last_time = std::max(t, state.last_time);
+		for (int i = 0; i < 6; i++)
+		{
+			// 20 mm and 10 degrees per square root second
+			double sigma = i < 3 ? 20 : 10;
+			state.walk[i] += sigma * std::sqrt(dt) * normal(state.random);
+			double range = i < 3 ? SYNTHETIC_WALK_RANGE : 80;
+			if (std::fabs(state.walk[i]) > range)
+			{
+				// reflect at the border
+				state.walk[i] = std::copysign(2 * range - std::fabs(state.walk[i]), state.walk[i]);
+			}
+			offset[i] = state.walk[i];
+		}
+		break;
+	}
+	case SYNTHETIC_STEP:
+	{
+		uint64_t slot = (uint64_t)std::floor(t / SYNTHETIC_STEP_PERIOD + uniform(seed, sensor, 0, 99));
+		for (int i = 0; i < 6; i++)
+		{
+			double range = i < 3 ? 100 : 60;
+			offset[i] = range * (2 * uniform(seed, sensor, slot, i) - 1);
+		}
+		break;
+	}
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		sample.position[i] = home[i] + offset[i];
+		sample.angles[i] = offset[3 + i];
+	}
+	set_orientation(sample);
+	sample.quality = 0;
+
+	uint64_t press = (uint64_t)std::floor(t / SYNTHETIC_PRESS_DURATION);
+	sample.button = uniform(seed, sensor, press, 1000) < m_options.button_rate * SYNTHETIC_PRESS_DURATION;
+}
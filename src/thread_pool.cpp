@@ -0,0 +1,128 @@
+#include <algorithm>
+
+#include "thread_pool.hpp"
+
+ThreadPool::ThreadPool(int threads) : m_next_queue(0),
+									  m_steals(0),
+									  m_queued(0),
+									  m_pending(0),
+									  m_stopping(false)
+{
+	if (threads <= 0)
+	{
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	for (int i = 0; i < threads; i++)
+	{
+		m_queues.emplace_back(new Queue());
+	}
+	for (int i = 0; i < threads; i++)
+	{
+		m_workers.emplace_back(&ThreadPool::p_work, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_work.notify_all();
+	for (auto& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+	// counted first, so a worker never sees more tasks than are counted
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queued++;
+		m_pending++;
+	}
+	Queue& queue = *m_queues[m_next_queue++ % m_queues.size()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+	}
+	m_work.notify_one();
+}
+
+void ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this] { return m_pending == 0; });
+}
+
+int ThreadPool::size() const
+{
+	return (int)m_workers.size();
+}
+
+uint64_t ThreadPool::steals() const
+{
+	return m_steals;
+}
+
+void ThreadPool::p_work(int worker)
+{
+	std::function<void()> task;
+	while (true)
+	{
+		if (p_take(worker, task))
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_queued--;
+			}
+			task();
+			task = nullptr;
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (--m_pending == 0)
+			{
+				m_done.notify_all();
+			}
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		// queued tasks are finished before the pool stops
+		m_work.wait(lock, [this] { return m_stopping || m_queued > 0; });
+		if (m_stopping && m_queued == 0)
+		{
+			return;
+		}
+	}
+}
+
+bool ThreadPool::p_take(int worker, std::function<void()>& task)
+{
+	{
+		Queue& own = *m_queues[worker];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.tasks.empty())
+		{
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			return true;
+		}
+	}
+
+	int n = (int)m_queues.size();
+	for (int i = 1; i < n; i++)
+	{
+		Queue& victim = *m_queues[(worker + i) % n];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			m_steals++;
+			return true;
+		}
+	}
+	return false;
+}
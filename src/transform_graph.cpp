@@ -0,0 +1,328 @@
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <nlohmann/json.hpp>
+
+#include "transform_graph.hpp"
+
+using json = nlohmann::json;
+
+TransformGraph::TransformGraph() : m_evaluations(0)
+{
+}
+
+TransformGraph TransformGraph::default_graph()
+{
+	TransformGraph graph;
+	graph.add_sensor("Reference", 0);
+	graph.add_sensor("Tool", 1);
+	graph.add_relative("ToolToReference", "Tool", "Reference");
+	return graph;
+}
+
+void TransformGraph::load(const std::string& filename)
+{
+	std::ifstream file(filename);
+	if (!file)
+	{
+		throw std::runtime_error("Could not open transform configuration " + filename + ".");
+	}
+
+	std::stringstream strstr;
+	strstr << file.rdbuf();
+	parse(strstr.str());
+}
+
+/**
+ * \param text JSON document with a "transforms" array, e.g.
+ *
+ * {"transforms": [
+ *     {"name": "Reference", "type": "sensor", "port": 0},
+ *     {"name": "Tool", "type": "sensor", "port": 1},
+ *     {"name": "StylusTip", "type": "fixed", "parent": "Tool",
+ *      "matrix": [[1, 0, 0, 0], [0, 1, 0, 0], [0, 0, 1, 150], [0, 0, 0, 1]]},
+ *     {"name": "StylusTipToReference", "type": "relative", "from": "StylusTip", "to": "Reference"}
+ * ]}
+ */
+void TransformGraph::parse(const std::string& text)
+{
+	json config;
+	try
+	{
+		config = json::parse(text);
+	}
+	catch (const json::exception& e)
+	{
+		throw std::runtime_error(std::string("Invalid transform configuration: ") + e.what());
+	}
+
+	if (!config.contains("transforms") || !config["transforms"].is_array())
+	{
+		throw std::runtime_error("Transform configuration has no \"transforms\" array.");
+	}
+
+	m_nodes.clear();
+	m_port_nodes.clear();
+	try
+	{
+		for (const auto& entry : config["transforms"])
+		{
+			std::string name = entry.at("name").get<std::string>();
+			std::string type = entry.at("type").get<std::string>();
+
+			if (type == "sensor")
+			{
+				add_sensor(name, entry.at("port").get<int>());
+			}
+			else if (type == "fixed")
+			{
+				QuadMatrix<4> offset;
+				const auto& rows = entry.at("matrix");
+				if (rows.size() != 4)
+				{
+					throw std::runtime_error("Fixed transform " + name + " needs a 4x4 matrix.");
+				}
+				for (int i = 0; i < 4; i++)
+				{
+					if (rows[i].size() != 4)
+					{
+						throw std::runtime_error("Fixed transform " + name + " needs a 4x4 matrix.");
+					}
+					for (int j = 0; j < 4; j++)
+					{
+						offset.set(i, j, rows[i][j].get<float>());
+					}
+				}
+				// fixed transforms are rigid, the rotation part is orthonormalized
+				add_fixed(name, Pose::from_matrix(offset), entry.value("parent", std::string()));
+			}
+			else if (type == "relative")
+			{
+				add_relative(name, entry.at("from").get<std::string>(), entry.at("to").get<std::string>());
+			}
+			else
+			{
+				throw std::runtime_error("Unknown transform type \"" + type + "\" for " + name + ".");
+			}
+		}
+	}
+	catch (const json::exception& e)
+	{
+		throw std::runtime_error(std::string("Invalid transform configuration: ") + e.what());
+	}
+}
+
+int TransformGraph::add_sensor(const std::string& name, int port)
+{
+	if (port < 0 || port > TRANSFORM_MAX_PORT)
+	{
+		throw std::runtime_error("Sensor " + name + " refers to invalid port " + std::to_string(port) + ".");
+	}
+
+	TransformNode node;
+	node.name = name;
+	node.type = TRANSFORM_SENSOR;
+	node.port = port;
+	node.input = -1;
+	node.reference = -1;
+	return p_add(node);
+}
+
+int TransformGraph::add_fixed(const std::string& name, const Pose& offset, const std::string& parent)
+{
+	TransformNode node;
+	node.name = name;
+	node.type = TRANSFORM_FIXED;
+	node.port = -1;
+	node.input = parent.empty() ? -1 : p_lookup(parent);
+	node.reference = -1;
+	node.offset = offset;
+	return p_add(node);
+}
+
+int TransformGraph::add_relative(const std::string& name, const std::string& from, const std::string& to)
+{
+	TransformNode node;
+	node.name = name;
+	node.type = TRANSFORM_RELATIVE;
+	node.port = -1;
+	node.input = p_lookup(from);
+	node.reference = p_lookup(to);
+	return p_add(node);
+}
+
+void TransformGraph::begin_frame()
+{
+	for (auto& node : m_nodes)
+	{
+		node.changed = false;
+	}
+}
+
+void TransformGraph::set_sensor(int port, const Pose& pose)
+{
+	if (port < 0 || port >= (int)m_port_nodes.size())
+	{
+		return;
+	}
+	for (int index : m_port_nodes[port])
+	{
+		TransformNode& node = m_nodes[index];
+		node.value = pose;
+		node.valid = true;
+		node.changed = true;
+	}
+}
+
+void TransformGraph::clear_sensor(int port)
+{
+	if (port < 0 || port >= (int)m_port_nodes.size())
+	{
+		return;
+	}
+	for (int index : m_port_nodes[port])
+	{
+		TransformNode& node = m_nodes[index];
+		node.changed = node.changed || node.valid;
+		node.valid = false;
+	}
+}
+
+void TransformGraph::evaluate()
+{
+	m_evaluations = 0;
+
+	// inputs always precede their dependents, a single pass suffices
+	for (auto& node : m_nodes)
+	{
+		if (node.type == TRANSFORM_FIXED)
+		{
+			if (node.input < 0)
+			{
+				if (!node.valid)
+				{
+					node.value = node.offset;
+					node.valid = true;
+					node.changed = true;
+				}
+				continue;
+			}
+
+			TransformNode& parent = m_nodes[node.input];
+			if (!parent.valid)
+			{
+				node.changed = node.changed || node.valid;
+				node.valid = false;
+			}
+			else if (parent.changed || !node.valid)
+			{
+				node.value = parent.value * node.offset;
+				node.valid = true;
+				node.changed = true;
+				m_evaluations++;
+			}
+		}
+		else if (node.type == TRANSFORM_RELATIVE)
+		{
+			TransformNode& from = m_nodes[node.input];
+			TransformNode& to = m_nodes[node.reference];
+			if (!from.valid || !to.valid)
+			{
+				node.changed = node.changed || node.valid;
+				node.valid = false;
+			}
+			else if (from.changed || to.changed || !node.valid)
+			{
+				node.value = to.value.inverse() * from.value;
+				node.valid = true;
+				node.changed = true;
+				m_evaluations++;
+			}
+		}
+	}
+}
+
+int TransformGraph::find(const std::string& name) const
+{
+	for (int i = 0; i < (int)m_nodes.size(); i++)
+	{
+		if (m_nodes[i].name == name)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+int TransformGraph::size() const
+{
+	return m_nodes.size();
+}
+
+const TransformNode& TransformGraph::node(int index) const
+{
+	return m_nodes.at(index);
+}
+
+std::vector<int> TransformGraph::ports() const
+{
+	std::vector<int> ports;
+	for (const auto& node : m_nodes)
+	{
+		if (node.type != TRANSFORM_SENSOR)
+		{
+			continue;
+		}
+		bool known = false;
+		for (int port : ports)
+		{
+			known = known || port == node.port;
+		}
+		if (!known)
+		{
+			ports.push_back(node.port);
+		}
+	}
+	return ports;
+}
+
+int TransformGraph::evaluations() const
+{
+	return m_evaluations;
+}
+
+int TransformGraph::p_add(const TransformNode& node)
+{
+	if (node.name.empty())
+	{
+		throw std::runtime_error("Transform without a name.");
+	}
+	if (find(node.name) >= 0)
+	{
+		throw std::runtime_error("Duplicate transform " + node.name + ".");
+	}
+
+	m_nodes.push_back(node);
+	m_nodes.back().valid = false;
+	m_nodes.back().changed = false;
+	if (node.type == TRANSFORM_SENSOR)
+	{
+		if (node.port >= (int)m_port_nodes.size())
+		{
+			m_port_nodes.resize(node.port + 1);
+		}
+		m_port_nodes[node.port].push_back(m_nodes.size() - 1);
+	}
+	return m_nodes.size() - 1;
+}
+
+int TransformGraph::p_lookup(const std::string& name) const
+{
+	int index = find(name);
+	if (index < 0)
+	{
+		throw std::runtime_error("Transform " + name + " is used before it is declared.");
+	}
+	return index;
+}
@@ -0,0 +1,126 @@
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "udp_sender.hpp"
+
+static_assert(sizeof(sockaddr_in) <= 16, "address storage too small");
+
+UdpSender::UdpSender() : m_socket(-1),
+						 m_multicast(false),
+						 m_sent(0),
+						 m_dropped(0)
+{
+	memset(m_address, 0, sizeof(m_address));
+}
+
+UdpSender::~UdpSender()
+{
+	close();
+}
+
+void UdpSender::open(const std::string& host, int port, int ttl, const std::string& interface)
+{
+	close();
+
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	addrinfo* result = nullptr;
+	if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || !result)
+	{
+		throw std::runtime_error("Could not resolve UDP destination " + host + ".");
+	}
+	sockaddr_in address;
+	memcpy(&address, result->ai_addr, sizeof(address));
+	freeaddrinfo(result);
+	address.sin_port = htons(port);
+	memcpy(m_address, &address, sizeof(address));
+
+	m_socket = socket(AF_INET, SOCK_DGRAM, 0);
+	if (m_socket < 0)
+	{
+		throw std::runtime_error(std::string("Could not create UDP socket: ") + strerror(errno));
+	}
+
+	// never let a full socket buffer stall the caller
+	fcntl(m_socket, F_SETFL, fcntl(m_socket, F_GETFL) | O_NONBLOCK);
+
+	m_multicast = IN_MULTICAST(ntohl(address.sin_addr.s_addr));
+	if (m_multicast)
+	{
+		unsigned char multicast_ttl = ttl;
+		setsockopt(m_socket, IPPROTO_IP, IP_MULTICAST_TTL, &multicast_ttl, sizeof(multicast_ttl));
+
+		if (!interface.empty())
+		{
+			in_addr local;
+			if (inet_pton(AF_INET, interface.c_str(), &local) != 1 ||
+				setsockopt(m_socket, IPPROTO_IP, IP_MULTICAST_IF, &local, sizeof(local)) < 0)
+			{
+				close();
+				throw std::runtime_error("Could not send multicast on interface " + interface + ".");
+			}
+		}
+	}
+}
+
+void UdpSender::close()
+{
+	if (m_socket >= 0)
+	{
+		::close(m_socket);
+		m_socket = -1;
+	}
+}
+
+bool UdpSender::is_open() const
+{
+	return m_socket >= 0;
+}
+
+bool UdpSender::is_multicast() const
+{
+	return m_multicast;
+}
+
+bool UdpSender::send(const void* data, size_t length)
+{
+	if (m_socket < 0)
+	{
+		return false;
+	}
+	if (length > UDP_MAX_DATAGRAM)
+	{
+		m_dropped++;
+		return false;
+	}
+
+	ssize_t r = sendto(m_socket, data, length, 0, reinterpret_cast<const sockaddr*>(m_address), sizeof(sockaddr_in));
+	if (r != (ssize_t)length)
+	{
+		m_dropped++;
+		return false;
+	}
+	m_sent++;
+	return true;
+}
+
+uint64_t UdpSender::sent() const
+{
+	return m_sent;
+}
+
+uint64_t UdpSender::dropped() const
+{
+	return m_dropped;
+}
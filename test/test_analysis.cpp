@@ -0,0 +1,123 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+#include "analysis.hpp"
+#include "thread_pool.hpp"
+
+int test_analysis_summary()
+{
+    int status = 0;
+
+    std::cout << "Test session summary" << std::endl;
+
+    // two sensors at 100 Hz, sensor 1 drops 5 samples once
+    std::vector<Sample> samples;
+    for (int i = 0; i < 1000; i++)
+    {
+        for (int sensor = 0; sensor < 2; sensor++)
+        {
+            if (sensor == 1 && i >= 500 && i < 505)
+            {
+                continue;
+            }
+            Sample sample = {};
+            sample.sensor = sensor;
+            sample.timestamp = 100 + i * 0.01;
+            sample.fields = SAMPLE_QUALITY | SAMPLE_BUTTON;
+            sample.quality = (i % 100) / 100.0;
+            sample.button = i % 200 >= 100 && i % 200 < 110;
+            samples.push_back(sample);
+        }
+    }
+
+    SessionSummary summary = summarize_samples(samples);
+    if (summary.samples != 1995 || summary.sensors.size() != 2)
+    {
+        std::cout << "Test session summary: Failed size test" << std::endl;
+        return 1;
+    }
+
+    const SensorSummary &s0 = summary.sensors[0];
+    const SensorSummary &s1 = summary.sensors[1];
+    if (std::fabs(s0.rate - 100) > 1e-6 || std::fabs(s0.median_interval - 0.01) > 1e-9 || s0.gaps != 0 || s0.jitter > 1e-9)
+    {
+        std::cout << "Test session summary: Failed rate test" << std::endl;
+        status++;
+    }
+    if (s1.samples != 995 || s1.gaps != 1 || std::fabs(s1.max_interval - 0.06) > 1e-9 || std::fabs(s1.gap_time - 0.05) > 1e-9)
+    {
+        std::cout << "Test session summary: Failed gap test" << std::endl;
+        status++;
+    }
+    if (s0.button_presses != 5 || s0.quality_samples != 1000 || s0.quality_min != 0 || s0.quality_max != 0.99
+        || std::fabs(s0.quality_p50 - 0.5) > 0.011 || std::fabs(s0.quality_p95 - 0.95) > 0.011)
+    {
+        std::cout << "Test session summary: Failed button and quality test" << std::endl;
+        status++;
+    }
+
+    std::string csv = sessions_to_csv({summary});
+    if (std::count(csv.begin(), csv.end(), '\n') != 3)
+    {
+        std::cout << "Test session summary: Failed CSV test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_analysis_pool()
+{
+    int status = 0;
+
+    std::cout << "Test work-stealing pool" << std::endl;
+
+    std::atomic<int> done(0);
+    ThreadPool pool(4);
+    for (int i = 0; i < 200; i++)
+    {
+        // uneven tasks, the first ones are long
+        pool.submit([&done, i]() {
+            volatile double x = 0;
+            for (int k = 0; k < (i < 8 ? 2000000 : 1000); k++)
+            {
+                x = x + std::sqrt((double)k);
+            }
+            done++;
+        });
+    }
+    pool.wait();
+    if (done != 200)
+    {
+        std::cout << "Test work-stealing pool: Failed completion test" << std::endl;
+        status++;
+    }
+
+    pool.submit([&done]() { done++; });
+    pool.wait();
+    if (done != 201)
+    {
+        std::cout << "Test work-stealing pool: Failed reuse test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_analysis()
+{
+    return test_analysis_summary() + test_analysis_pool();
+}
+
+int main(int argc, char *argv[])
+{
+    int status = test_analysis();
+    if (status != 0)
+    {
+        std::cout << "Tests failed." << std::endl;
+    }
+    return status;
+}
@@ -0,0 +1,262 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "atc3dg_client.hpp"
+
+// a daemon segment with sensors on ports 0 and 1
+void start_daemon(TrackerShmWriter &writer, const std::string &name)
+{
+    writer.open(name);
+    TrackerShmSensor sensors[3] = {};
+    for (int port = 0; port < 3; port++)
+    {
+        sensors[port].port = port;
+        sensors[port].attached = port < 2;
+        sensors[port].serial = 1000 + port;
+        strcpy(sensors[port].model, "Sensor");
+    }
+    writer.set_topology(sensors, 3);
+    writer.set_status(true, 80, atc3dg_time());
+}
+
+Sample make_sample(int sensor, double x)
+{
+    Sample sample = {};
+    sample.sensor = sensor;
+    sample.fields = SAMPLE_ALL;
+    sample.position[0] = x;
+    return sample;
+}
+
+int test_atc3dg_client_attach()
+{
+    int status = 0;
+    std::string name = "/atc3dg_client_test_" + std::to_string(getpid());
+
+    std::cout << "Test client attach" << std::endl;
+
+    ATC3DGClient client(name);
+    try
+    {
+        client.connect();
+        std::cout << "Test client attach: Failed missing daemon test" << std::endl;
+        status++;
+    }
+    catch (const std::runtime_error &)
+    {
+    }
+
+    TrackerShmWriter writer;
+    start_daemon(writer, name);
+    client.connect();
+    if (!client.good() || client.get_number_sensors() != 2 || !client.is_attached(1) || client.is_attached(2))
+    {
+        std::cout << "Test client attach: Failed topology test" << std::endl;
+        status++;
+    }
+    std::vector<SensorInfo> topology = client.get_topology();
+    if (topology.size() != 3 || topology[1].serial != 1001 || topology[1].model != "Sensor" || client.get_rate() != 80)
+    {
+        std::cout << "Test client attach: Failed sensor info test" << std::endl;
+        status++;
+    }
+
+    try
+    {
+        client.set_rate(100);
+        std::cout << "Test client attach: Failed rate test" << std::endl;
+        status++;
+    }
+    catch (const std::runtime_error &)
+    {
+    }
+
+    // a daemon without heartbeat is gone
+    writer.set_status(true, 80, atc3dg_time() - 2 * TRACKER_SHM_TIMEOUT);
+    if (client.good())
+    {
+        std::cout << "Test client attach: Failed heartbeat test" << std::endl;
+        status++;
+    }
+
+    client.disconnect();
+    return status;
+}
+
+int test_atc3dg_client_poll()
+{
+    int status = 0;
+    std::string name = "/atc3dg_client_test_" + std::to_string(getpid());
+
+    std::cout << "Test client poll" << std::endl;
+
+    TrackerShmWriter writer;
+    start_daemon(writer, name);
+    // published before the client attached
+    writer.publish(make_sample(0, -1));
+
+    ATC3DGClient client(name);
+    client.connect();
+    client.set_transaction_budget(20);
+
+    for (int i = 0; i < 3; i++)
+    {
+        writer.publish(make_sample(0, i));
+        writer.publish(make_sample(1, 10 + i));
+    }
+
+    // every sample once and in order, per sensor
+    Sample sample;
+    for (int sensor : {1, 0})
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            if (!client.poll(sensor, sample) || sample.sensor != sensor || sample.position[0] != sensor * 10 + i)
+            {
+                std::cout << "Test client poll: Failed order test" << std::endl;
+                status++;
+            }
+        }
+    }
+    if (client.poll(0, sample))
+    {
+        std::cout << "Test client poll: Failed no new sample test" << std::endl;
+        status++;
+    }
+
+    // a client that fell behind continues with the oldest sample left
+    for (int i = 0; i < TRACKER_SHM_HISTORY + 10; i++)
+    {
+        writer.publish(make_sample(0, i));
+    }
+    if (!client.poll(0, sample) || sample.position[0] != 10)
+    {
+        std::cout << "Test client poll: Failed overrun test" << std::endl;
+        status++;
+    }
+
+    // the legacy call works unchanged
+    writer.publish(make_sample(1, 42));
+    double x, y, z, ax, ay, az, matrix[3][3], q0, qi, qj, qk, quality;
+    bool button;
+    client.update(1, x, y, z, ax, ay, az, matrix, q0, qi, qj, qk, quality, button);
+    if (x != 42)
+    {
+        std::cout << "Test client poll: Failed update test" << std::endl;
+        status++;
+    }
+
+    client.disconnect();
+    return status;
+}
+
+int test_atc3dg_client_topology()
+{
+    int status = 0;
+    std::string name = "/atc3dg_client_test_" + std::to_string(getpid());
+
+    std::cout << "Test client topology" << std::endl;
+
+    TrackerShmWriter writer;
+    start_daemon(writer, name);
+    ATC3DGClient client(name);
+    client.connect();
+
+    std::vector<int> reported;
+    client.set_topology_callback([&](const SensorInfo &info) { reported.push_back(info.port); });
+    if (client.refresh_topology())
+    {
+        std::cout << "Test client topology: Failed unchanged test" << std::endl;
+        status++;
+    }
+
+    TrackerShmSensor sensors[3] = {};
+    for (int port = 0; port < 3; port++)
+    {
+        sensors[port].port = port;
+        sensors[port].attached = port != 1;
+        sensors[port].serial = 1000 + port;
+    }
+    writer.set_topology(sensors, 3);
+    if (!client.refresh_topology() || reported != std::vector<int>({1, 2}) || client.get_number_sensors() != 2 || client.is_attached(1))
+    {
+        std::cout << "Test client topology: Failed change test" << std::endl;
+        status++;
+    }
+
+    client.disconnect();
+    return status;
+}
+
+int test_atc3dg_client_stream()
+{
+    int status = 0;
+    std::string name = "/atc3dg_client_test_" + std::to_string(getpid());
+
+    std::cout << "Test client stream" << std::endl;
+
+    TrackerShmWriter writer;
+    start_daemon(writer, name);
+    ATC3DGClient client(name);
+    client.connect();
+
+    // samples of sensor 0 in the order the daemon published them
+    std::vector<double> received;
+    client.subscribe([&](const Sample &sample) {
+        if (sample.sensor == 0)
+        {
+            received.push_back(sample.position[0]);
+        }
+    });
+    client.start();
+
+    std::atomic<bool> publishing(true);
+    std::thread daemon([&]() {
+        for (int i = 0; publishing; i++)
+        {
+            writer.set_status(true, 200, atc3dg_time());
+            writer.publish(make_sample(0, i));
+            writer.publish(make_sample(1, i));
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    client.stop();
+    publishing = false;
+    daemon.join();
+
+    bool ordered = !received.empty();
+    for (size_t i = 1; i < received.size(); i++)
+    {
+        ordered = ordered && received[i] == received[i - 1] + 1;
+    }
+    if (!ordered)
+    {
+        std::cout << "Test client stream: Failed order test, " << received.size() << " samples" << std::endl;
+        status++;
+    }
+
+    client.disconnect();
+    return status;
+}
+
+int test_atc3dg_client()
+{
+    return test_atc3dg_client_attach() + test_atc3dg_client_poll() + test_atc3dg_client_topology() + test_atc3dg_client_stream();
+}
+
+int main(int argc, char *argv[])
+{
+    int status = test_atc3dg_client();
+    if (status != 0)
+    {
+        std::cout << "Tests failed." << std::endl;
+    }
+    return status;
+}
@@ -0,0 +1,191 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+#include "calibration.hpp"
+
+Pose random_pose(std::mt19937 &generator, double max_angle, double max_translation)
+{
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    double axis[3] = {unit(generator), unit(generator), unit(generator)};
+    double norm = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    double angle = unit(generator) * max_angle * M_PI / 180.0 / 2;
+    Pose pose;
+    pose.q[0] = std::cos(angle);
+    for (int i = 0; i < 3; i++)
+    {
+        pose.q[i + 1] = std::sin(angle) * axis[i] / norm;
+        pose.t[i] = unit(generator) * max_translation;
+    }
+    return pose;
+}
+
+// small rotation and translation error of a measured pose
+Pose noisy(const Pose &pose, std::mt19937 &generator, double degrees, double mm)
+{
+    std::normal_distribution<double> noise(0.0, 1.0);
+    Pose error;
+    for (int i = 1; i < 4; i++)
+    {
+        error.q[i] = noise(generator) * degrees * M_PI / 180.0 / 2;
+    }
+    error.normalize();
+    Pose result = pose * error;
+    for (int i = 0; i < 3; i++)
+    {
+        result.t[i] += noise(generator) * mm;
+    }
+    return result;
+}
+
+double distance(const double (&a)[3], const double (&b)[3])
+{
+    return std::sqrt((a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]) + (a[2] - b[2]) * (a[2] - b[2]));
+}
+
+int test_calibration_pivot()
+{
+    int status = 0;
+
+    std::cout << "Test pivot calibration" << std::endl;
+
+    std::mt19937 generator(1);
+    const double tip[3] = {3.0, -12.0, 150.0};
+    const double pivot[3] = {20.0, 5.0, 200.0};
+    std::vector<Pose> poses;
+    for (int i = 0; i < 20000; i++)
+    {
+        // R tip + t = pivot
+        Pose pose = random_pose(generator, 60, 0);
+        double rotated[3];
+        pose.rotate(tip, rotated);
+        for (int j = 0; j < 3; j++)
+        {
+            pose.t[j] = pivot[j] - rotated[j];
+        }
+        poses.push_back(noisy(pose, generator, 0.05, 0.1));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    PivotCalibration result = calibrate_pivot(poses);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (distance(result.tip, tip) > 0.1 || distance(result.pivot, pivot) > 0.1)
+    {
+        std::cout << "Test pivot calibration: Failed solution test" << std::endl;
+        status++;
+    }
+    if (result.rms <= 0.0 || result.rms > 0.5 || result.max_error < result.rms || result.poses != poses.size())
+    {
+        std::cout << "Test pivot calibration: Failed residual test" << std::endl;
+        status++;
+    }
+    if (seconds > 1.0)
+    {
+        std::cout << "Test pivot calibration: Failed time test, " << seconds << " s" << std::endl;
+        status++;
+    }
+
+    // same result on one thread
+    PivotCalibration single = calibrate_pivot(poses, 1);
+    if (distance(single.tip, result.tip) > 1e-6)
+    {
+        std::cout << "Test pivot calibration: Failed thread test" << std::endl;
+        status++;
+    }
+
+    // without rotation the tip cannot be located
+    std::vector<Pose> still(100, poses[0]);
+    try
+    {
+        calibrate_pivot(still);
+        std::cout << "Test pivot calibration: Failed degenerate test" << std::endl;
+        status++;
+    }
+    catch (const std::runtime_error &)
+    {
+    }
+
+    return status;
+}
+
+int test_calibration_hand_eye()
+{
+    int status = 0;
+
+    std::cout << "Test hand-eye calibration" << std::endl;
+
+    std::mt19937 generator(2);
+    Pose x = random_pose(generator, 90, 50);
+    Pose transmitter = random_pose(generator, 180, 500);
+    std::vector<Pose> hand;
+    std::vector<Pose> eye;
+    for (int i = 0; i < 10000; i++)
+    {
+        // eye = transmitter * hand * x, so A X = X B
+        Pose h = random_pose(generator, 120, 300);
+        hand.push_back(h);
+        eye.push_back(noisy(transmitter * h * x, generator, 0.05, 0.1));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    HandEyeCalibration result = calibrate_hand_eye(hand, eye);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Pose error = result.x.inverse() * x;
+    double angle = 2 * std::acos(std::min(1.0, std::fabs(error.q[0]))) * 180.0 / M_PI;
+    if (angle > 0.05 || distance(result.x.t, x.t) > 0.2)
+    {
+        std::cout << "Test hand-eye calibration: Failed solution test" << std::endl;
+        status++;
+    }
+    if (result.rotation_rms > 0.5 || result.translation_rms > 2.0 || result.motions != 5000)
+    {
+        std::cout << "Test hand-eye calibration: Failed residual test" << std::endl;
+        status++;
+    }
+    if (seconds > 1.0)
+    {
+        std::cout << "Test hand-eye calibration: Failed time test, " << seconds << " s" << std::endl;
+        status++;
+    }
+
+    // rotations about a single axis do not determine X
+    std::vector<Pose> planar_hand;
+    std::vector<Pose> planar_eye;
+    for (int i = 0; i < 100; i++)
+    {
+        double angle = i * 0.05;
+        Pose h = {{std::cos(angle), 0, 0, std::sin(angle)}, {i * 1.0, 0, 0}};
+        planar_hand.push_back(h);
+        planar_eye.push_back(transmitter * h * x);
+    }
+    try
+    {
+        calibrate_hand_eye(planar_hand, planar_eye);
+        std::cout << "Test hand-eye calibration: Failed degenerate test" << std::endl;
+        status++;
+    }
+    catch (const std::runtime_error &)
+    {
+    }
+
+    return status;
+}
+
+int test_calibration()
+{
+    return test_calibration_pivot() + test_calibration_hand_eye();
+}
+
+int main(int argc, char *argv[])
+{
+    int status = test_calibration();
+    if (status != 0)
+    {
+        std::cout << "Tests failed." << std::endl;
+    }
+    return status;
+}
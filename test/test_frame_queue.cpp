@@ -0,0 +1,113 @@
+#include <iostream>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "frame_queue.hpp"
+
+int test_frame_queue_drop_oldest()
+{
+    int status = 0;
+
+    std::cout << "Test drop-oldest queue" << std::endl;
+
+    FrameQueue<int> queue(4);
+    for (int i = 0; i < 10; i++)
+    {
+        queue.push(i);
+    }
+    if (queue.size() != 4 || queue.dropped() != 6)
+    {
+        std::cout << "Test drop-oldest queue: Failed drop count test" << std::endl;
+        status++;
+    }
+
+    int value;
+    for (int expected = 6; expected < 10; expected++)
+    {
+        if (!queue.pop(value) || value != expected)
+        {
+            std::cout << "Test drop-oldest queue: Failed order test" << std::endl;
+            status++;
+            break;
+        }
+    }
+    if (queue.pop(value) || queue.try_push(1) == false)
+    {
+        std::cout << "Test drop-oldest queue: Failed empty test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_frame_queue_concurrent()
+{
+    int status = 0;
+
+    std::cout << "Test drop-oldest queue with a slow consumer" << std::endl;
+
+    struct Frame {
+        uint64_t number;
+        uint64_t check;
+    };
+
+    const uint64_t frames = 200000;
+    FrameQueue<Frame> queue(8);
+    std::atomic<bool> done(false);
+    uint64_t received = 0;
+    bool ordered = true;
+
+    std::thread consumer([&]() {
+        Frame frame;
+        uint64_t last = 0;
+        bool first = true;
+        while (!done || queue.size() > 0)
+        {
+            if (!queue.pop(frame))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            // frames arrive intact and in order, with gaps where dropped
+            if (frame.check != ~frame.number || (!first && frame.number <= last))
+            {
+                ordered = false;
+            }
+            last = frame.number;
+            first = false;
+            received++;
+        }
+    });
+
+    for (uint64_t i = 0; i < frames; i++)
+    {
+        queue.push({i, ~i});
+    }
+    done = true;
+    consumer.join();
+
+    if (!ordered || received + queue.dropped() != frames)
+    {
+        std::cout << "Test drop-oldest queue with a slow consumer: Failed, " << received << " received, "
+                  << queue.dropped() << " dropped" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_frame_queue()
+{
+    return test_frame_queue_drop_oldest() + test_frame_queue_concurrent();
+}
+
+int main(int argc, char *argv[])
+{
+    int status = test_frame_queue();
+    if (status != 0)
+    {
+        std::cout << "Tests failed." << std::endl;
+    }
+    return status;
+}
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <type_traits>
 
 #include "matrix.hpp"
 
@@ -100,9 +101,79 @@ int test_matrix_inverse()
     return status;
 }
 
+int test_matrix_multiply()
+{
+    int status = 0;
+    QuadMatrix<4> translation;
+    translation.set(0, 3, 2.0f);
+    translation.set(1, 3, 3.0f);
+
+    std::cout << "Test multiply" << std::endl;
+
+    QuadMatrix<4> product = translation.multiply(translation);
+    if (product.get(0, 3) != 4.0f || product.get(1, 3) != 6.0f || product.get(3, 3) != 1.0f)
+    {
+        std::cout << "Test multiply: Failed translation test" << std::endl;
+        status++;
+    }
+
+    std::cout << "Test 4x4 inverse of translation" << std::endl;
+    QuadMatrix<4> identity;
+    if (translation.inverse().multiply(translation) != identity)
+    {
+        std::cout << "Test multiply: Failed inverse test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_matrix_expressions()
+{
+    int status = 0;
+
+    std::cout << "Test expressions" << std::endl;
+
+    static_assert(std::is_trivially_copyable<QuadMatrix<4>>::value, "QuadMatrix is not trivially copyable");
+    static_assert(alignof(QuadMatrix<4>) >= 16, "QuadMatrix is not aligned");
+    constexpr QuadMatrix<4> constant = QuadMatrix<4>() * 2.0f;
+    static_assert(constant.trace() == 8.0f && constant.determinant() == 16.0f, "QuadMatrix is not constexpr");
+
+    QuadMatrix<4> reference({{0, -1, 0, 10}, {1, 0, 0, 20}, {0, 0, 1, 30}, {0, 0, 0, 1}});
+    QuadMatrix<4> tool({{1, 0, 0, 5}, {0, 0, -1, 6}, {0, 1, 0, 7}, {0, 0, 0, 1}});
+
+    QuadMatrix<4> fused = reference.inverse() * tool;
+    QuadMatrix<4> chained = reference.inverse().multiply(tool);
+    if (fused != chained || fused.get(0, 3) != -14.0f || fused.get(1, 3) != 5.0f)
+    {
+        std::cout << "Test expressions: Failed product test" << std::endl;
+        status++;
+    }
+
+    QuadMatrix<4> sum = (reference + tool) * 0.5f - transposed(reference);
+    if (sum.get(0, 1) != -1.5f || sum.get(3, 0) != -10.0f || sum.get(3, 3) != 0.0f)
+    {
+        std::cout << "Test expressions: Failed element-wise test" << std::endl;
+        status++;
+    }
+
+    // the destination appears in the expression
+    QuadMatrix<4> aliased = tool;
+    aliased = aliased * reference * tool;
+    aliased *= reference;
+    if (aliased != tool.multiply(reference).multiply(tool).multiply(reference))
+    {
+        std::cout << "Test expressions: Failed aliasing test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
 int test_matrix()
 {
-    return test_matrix_equal() + test_matrix_minor() + test_matrix_determinant() + test_matrix_inverse();
+    return test_matrix_equal() + test_matrix_minor() + test_matrix_determinant() + test_matrix_inverse() + test_matrix_multiply()
+        + test_matrix_expressions();
 }
 
 int main(int argc, char *argv[])
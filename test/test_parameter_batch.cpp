@@ -0,0 +1,122 @@
+#include <iostream>
+#include <cmath>
+
+#include "atc3dg.hpp"
+
+int test_parameter_batch_values()
+{
+    int status = 0;
+
+    std::cout << "Test parameter values" << std::endl;
+
+    // 80 Hz as the tracker reports its rate, little endian
+    ParameterValue rate;
+    rate.bytes = {0x00, 0x50};
+    if (rate.word() != 0x5000 || std::fabs(rate.fixed() - 80.0) > 1e-9)
+    {
+        std::cout << "Test parameter values: Failed word test" << std::endl;
+        status++;
+    }
+
+    // control characters of identification strings are dropped
+    ParameterValue model;
+    model.bytes = {'3', 'D', 'G', 0x00, 0x0A};
+    if (model.text() != "3DG")
+    {
+        std::cout << "Test parameter values: Failed text test" << std::endl;
+        status++;
+    }
+
+    try
+    {
+        rate.word(1);
+        std::cout << "Test parameter values: Failed range test" << std::endl;
+        status++;
+    }
+    catch (const std::runtime_error &)
+    {
+    }
+
+    return status;
+}
+
+int test_parameter_batch_queue()
+{
+    int status = 0;
+
+    std::cout << "Test parameter batch" << std::endl;
+
+    ParameterBatch batch;
+    size_t serial = batch.examine(ATC_SERIAL_NUMBER);
+    batch.change_word(ATC_RATE, 80 * 256, -1);
+    size_t model = batch.model_string(ATC_COMPONENT_RX, 2);
+    size_t part = batch.part_number(ATC_COMPONENT_RX, 2);
+    size_t rom = batch.examine(ATC_ROM);
+    if (serial != 0 || model != 1 || part != 2 || rom != 3 || batch.size() != 4)
+    {
+        std::cout << "Test parameter batch: Failed index test" << std::endl;
+        status++;
+    }
+    if (atc3dg_parameter_size(ATC_ROM) != 64 || atc3dg_parameter_size(ATC_RATE) != 2)
+    {
+        std::cout << "Test parameter batch: Failed size test" << std::endl;
+        status++;
+    }
+
+    // undocumented parameters need an explicit size
+    try
+    {
+        batch.examine(0x95);
+        std::cout << "Test parameter batch: Failed unknown size test" << std::endl;
+        status++;
+    }
+    catch (const std::runtime_error &)
+    {
+    }
+    if (batch.examine(0x95, 0, 1) != 4)
+    {
+        std::cout << "Test parameter batch: Failed explicit size test" << std::endl;
+        status++;
+    }
+
+    // without a tracker the batch fails and no value is ok
+    ATC3DGTracker tracker;
+    try
+    {
+        tracker.execute(batch);
+        std::cout << "Test parameter batch: Failed offline test" << std::endl;
+        status++;
+    }
+    catch (const ATC3DGError &e)
+    {
+        if (e.kind() != ATC_ERROR_DISCONNECT || batch[serial].ok)
+        {
+            std::cout << "Test parameter batch: Failed offline error test" << std::endl;
+            status++;
+        }
+    }
+
+    batch.clear();
+    if (batch.size() != 0)
+    {
+        std::cout << "Test parameter batch: Failed clear test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_parameter_batch()
+{
+    return test_parameter_batch_values() + test_parameter_batch_queue();
+}
+
+int main(int argc, char *argv[])
+{
+    int status = test_parameter_batch();
+    if (status != 0)
+    {
+        std::cout << "Tests failed." << std::endl;
+    }
+    return status;
+}
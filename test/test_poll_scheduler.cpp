@@ -0,0 +1,152 @@
+#include <iostream>
+#include <cmath>
+
+#include "poll_scheduler.hpp"
+
+// runs the scheduler for a while with sensor 2 moving along x at speed
+// mm/s and the others static, returns the polls per sensor
+std::vector<uint64_t> simulate(PollScheduler &scheduler, double rate, double seconds, double speed)
+{
+    std::vector<int> attached = {0, 1, 2, 3};
+    std::vector<int> sensors;
+    std::vector<uint64_t> polls(4, 0);
+    int frames = (int)(seconds * rate);
+    for (int frame = 0; frame < frames; frame++)
+    {
+        double now = frame / rate;
+        scheduler.next(attached, rate, now, sensors);
+        for (int sensor : sensors)
+        {
+            Sample sample = {};
+            sample.sensor = sensor;
+            sample.timestamp = now;
+            sample.fields = SAMPLE_POSITION | SAMPLE_QUATERNION;
+            sample.position[0] = sensor == 2 ? speed * now : 0.0;
+            sample.quaternion[0] = 1.0;
+            scheduler.update(sample);
+            polls[sensor]++;
+        }
+    }
+    return polls;
+}
+
+int test_poll_scheduler_motion()
+{
+    int status = 0;
+
+    std::cout << "Test poll scheduler motion" << std::endl;
+
+    // 400 polls per second for 4 sensors at 240 Hz, round robin would give
+    // each of them 100 Hz
+    SchedulerOptions options;
+    options.budget = 400;
+    options.min_rate = 10;
+    PollScheduler scheduler(options);
+    std::vector<uint64_t> polls = simulate(scheduler, 240, 10, 200);
+
+    uint64_t total = polls[0] + polls[1] + polls[2] + polls[3];
+    if (total > 4000 * 1.02)
+    {
+        std::cout << "Test poll scheduler motion: Failed budget test, " << total << " polls" << std::endl;
+        status++;
+    }
+    if (polls[2] < 2000)
+    {
+        std::cout << "Test poll scheduler motion: Failed moving sensor test, " << polls[2] << " polls" << std::endl;
+        status++;
+    }
+    for (int sensor : {0, 1, 3})
+    {
+        // at least the minimum rate, not much more than their share
+        if (polls[sensor] < 95 || polls[sensor] > 700)
+        {
+            std::cout << "Test poll scheduler motion: Failed static sensor test, " << polls[sensor] << " polls" << std::endl;
+            status++;
+        }
+    }
+
+    std::vector<SensorSchedule> schedule = scheduler.get_schedule();
+    if (schedule.size() != 4 || std::fabs(schedule[2].motion - 200) > 20 || schedule[0].motion > 1)
+    {
+        std::cout << "Test poll scheduler motion: Failed motion estimate test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_poll_scheduler_priority()
+{
+    int status = 0;
+
+    std::cout << "Test poll scheduler priority" << std::endl;
+
+    // all static, port 1 weighted four times
+    SchedulerOptions options;
+    options.budget = 400;
+    options.min_rate = 10;
+    options.priorities = {1, 4, 1, 1};
+    PollScheduler scheduler(options);
+    std::vector<uint64_t> polls = simulate(scheduler, 240, 10, 0);
+    if (polls[1] < 2 * polls[0] || polls[1] < 2 * polls[3])
+    {
+        std::cout << "Test poll scheduler priority: Failed priority test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_poll_scheduler_budget()
+{
+    int status = 0;
+
+    std::cout << "Test poll scheduler budget" << std::endl;
+
+    // until a poll is measured, and while the link carries all of them,
+    // every sensor is polled in every frame
+    PollScheduler first;
+    std::vector<int> attached = {0, 1, 2, 3};
+    std::vector<int> sensors;
+    first.next(attached, 80, 0.0, sensors);
+    if (sensors != attached)
+    {
+        std::cout << "Test poll scheduler budget: Failed first frame test" << std::endl;
+        status++;
+    }
+
+    PollScheduler scheduler;
+    scheduler.account(4, 0.004);
+    if (std::fabs(scheduler.get_budget() - 800) > 1e-6)
+    {
+        std::cout << "Test poll scheduler budget: Failed measurement test" << std::endl;
+        status++;
+    }
+    std::vector<uint64_t> polls = simulate(scheduler, 80, 1, 0);
+    for (uint64_t count : polls)
+    {
+        if (count != 80)
+        {
+            std::cout << "Test poll scheduler budget: Failed round robin test, " << count << " polls" << std::endl;
+            status++;
+            break;
+        }
+    }
+
+    return status;
+}
+
+int test_poll_scheduler()
+{
+    return test_poll_scheduler_motion() + test_poll_scheduler_priority() + test_poll_scheduler_budget();
+}
+
+int main(int argc, char *argv[])
+{
+    int status = test_poll_scheduler();
+    if (status != 0)
+    {
+        std::cout << "Tests failed." << std::endl;
+    }
+    return status;
+}
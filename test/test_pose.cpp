@@ -0,0 +1,220 @@
+#include <iostream>
+#include <cmath>
+
+#include "pose.hpp"
+#include "raw_history.hpp"
+#include "synthetic_tracker.hpp"
+
+bool near(const QuadMatrix<4> &a, const QuadMatrix<4> &b)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            if (std::fabs(a.get(i, j) - b.get(i, j)) > 1e-4f)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+Pose rotation(double degrees, double x, double y, double z, double tx, double ty, double tz)
+{
+    double r = degrees * M_PI / 180.0 / 2;
+    double norm = std::sqrt(x * x + y * y + z * z);
+    return {{std::cos(r), std::sin(r) * x / norm, std::sin(r) * y / norm, std::sin(r) * z / norm}, {tx, ty, tz}};
+}
+
+int test_pose_compose()
+{
+    int status = 0;
+
+    std::cout << "Test pose composition" << std::endl;
+
+    Pose a = rotation(30, 1, 2, 3, 10, -20, 30);
+    Pose b = rotation(-75, 0, 1, 0, 5, 6, 7);
+
+    // same results as the matrices
+    if (!near((a * b).matrix(), a.matrix() * b.matrix()))
+    {
+        std::cout << "Test pose composition: Failed product test" << std::endl;
+        status++;
+    }
+    if (!near((a.inverse() * b).matrix(), a.matrix().inverse() * b.matrix()))
+    {
+        std::cout << "Test pose composition: Failed inverse test" << std::endl;
+        status++;
+    }
+    if (!near(Pose::from_matrix(a.matrix()).matrix(), a.matrix()))
+    {
+        std::cout << "Test pose composition: Failed matrix round trip test" << std::endl;
+        status++;
+    }
+
+    double point[3] = {1, 2, 3};
+    double moved[3];
+    a.apply(point, moved);
+    QuadMatrix<4> m = a.matrix();
+    for (int i = 0; i < 3; i++)
+    {
+        double expected = m.get(i, 0) * point[0] + m.get(i, 1) * point[1] + m.get(i, 2) * point[2] + m.get(i, 3);
+        if (std::fabs(moved[i] - expected) > 1e-4)
+        {
+            std::cout << "Test pose composition: Failed point test" << std::endl;
+            status++;
+            break;
+        }
+    }
+
+    return status;
+}
+
+int test_pose_slerp()
+{
+    int status = 0;
+
+    std::cout << "Test pose interpolation" << std::endl;
+
+    Pose a = rotation(0, 0, 0, 1, 0, 0, 0);
+    Pose b = rotation(90, 0, 0, 1, 10, 0, 0);
+    Pose half = Pose::slerp(a, b, 0.5);
+    if (!near(half.matrix(), rotation(45, 0, 0, 1, 5, 0, 0).matrix()))
+    {
+        std::cout << "Test pose interpolation: Failed midpoint test" << std::endl;
+        status++;
+    }
+
+    // q and -q are the same rotation, the shorter arc is taken
+    Pose negated = b;
+    for (int i = 0; i < 4; i++)
+    {
+        negated.q[i] = -negated.q[i];
+    }
+    if (!near(Pose::slerp(a, negated, 0.5).matrix(), half.matrix()))
+    {
+        std::cout << "Test pose interpolation: Failed shorter arc test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_pose_sample()
+{
+    int status = 0;
+
+    std::cout << "Test pose of a sample" << std::endl;
+
+    // quaternion and matrix of a sample describe the same rotation
+    SyntheticOptions options;
+    options.motion = SYNTHETIC_SINE;
+    SyntheticTracker tracker(options);
+    tracker.connect();
+    Sample sample = {};
+    tracker.pose(1, 1.234, sample);
+
+    Pose pose = Pose::from_sample(sample);
+    QuadMatrix<4> m = pose.matrix();
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            if (std::fabs(m.get(i, j) - sample.matrix[i][j]) > 1e-5)
+            {
+                std::cout << "Test pose of a sample: Failed rotation test" << std::endl;
+                return 1;
+            }
+        }
+        if (std::fabs(m.get(i, 3) - sample.position[i]) > 1e-3)
+        {
+            std::cout << "Test pose of a sample: Failed translation test" << std::endl;
+            status++;
+        }
+    }
+
+    return status;
+}
+
+int16_t word(double fraction)
+{
+    return (int16_t)std::lround(fraction * 0x8000);
+}
+
+int test_pose_record()
+{
+    int status = 0;
+
+    std::cout << "Test pose of a tracker record" << std::endl;
+
+    // POINT record of azimuth, elevation and roll, matrix and quaternion as
+    // the trakSTAR manual defines them
+    double d2r = M_PI / 180.0;
+    double a = 30 * d2r, e = -20 * d2r, r = 60 * d2r;
+    double ca = std::cos(a), sa = std::sin(a);
+    double ce = std::cos(e), se = std::sin(e);
+    double cr = std::cos(r), sr = std::sin(r);
+    double matrix[3][3] = {
+        {ce * ca, ce * sa, -se},
+        {-cr * sa + sr * se * ca, cr * ca + sr * se * sa, sr * ce},
+        {sr * sa + cr * se * ca, -sr * ca + cr * se * sa, cr * ce}};
+    double quaternion[4] = {
+        std::cos(a / 2) * std::cos(e / 2) * std::cos(r / 2) + std::sin(a / 2) * std::sin(e / 2) * std::sin(r / 2),
+        std::cos(a / 2) * std::cos(e / 2) * std::sin(r / 2) - std::sin(a / 2) * std::sin(e / 2) * std::cos(r / 2),
+        std::cos(a / 2) * std::sin(e / 2) * std::cos(r / 2) + std::sin(a / 2) * std::cos(e / 2) * std::sin(r / 2),
+        std::sin(a / 2) * std::cos(e / 2) * std::cos(r / 2) - std::cos(a / 2) * std::sin(e / 2) * std::sin(r / 2)};
+
+    RawSample raw = {};
+    raw.scaling = 1;
+    raw.words[RAW_WORD_POSITION] = word(0.25);
+    for (int i = 0; i < 9; i++)
+    {
+        raw.words[RAW_WORD_MATRIX + i] = word(matrix[i / 3][i % 3]);
+    }
+    raw.words[RAW_WORD_ANGLES + 0] = word(30 / 180.0);
+    raw.words[RAW_WORD_ANGLES + 1] = word(-20 / 180.0);
+    raw.words[RAW_WORD_ANGLES + 2] = word(60 / 180.0);
+    for (int i = 0; i < 4; i++)
+    {
+        raw.words[RAW_WORD_QUATERNION + i] = word(quaternion[i]);
+    }
+    Sample sample = {};
+    raw_sample_decode(0, raw, SAMPLE_ALL, sample);
+
+    // orientations sent by the server are those of the device matrix
+    QuadMatrix<4> m = Pose::from_sample(sample).matrix();
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            if (std::fabs(m.get(i, j) - sample.matrix[i][j]) > 1e-3)
+            {
+                std::cout << "Test pose of a tracker record: Failed rotation test" << std::endl;
+                return 1;
+            }
+        }
+    }
+    if (std::fabs(m.get(0, 3) - 228.6) > 1e-3)
+    {
+        std::cout << "Test pose of a tracker record: Failed translation test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_pose()
+{
+    return test_pose_compose() + test_pose_slerp() + test_pose_sample() + test_pose_record();
+}
+
+int main(int argc, char *argv[])
+{
+    int status = test_pose();
+    if (status != 0)
+    {
+        std::cout << "Tests failed." << std::endl;
+    }
+    return status;
+}
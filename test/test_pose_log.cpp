@@ -0,0 +1,293 @@
+#include <iostream>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include <unistd.h>
+
+#include "pose_log.hpp"
+#include "recording.hpp"
+
+// one step of the tracker's 14 bit resolution
+#define NATIVE_UNIT (1.0 / 8192)
+
+static std::vector<Sample> make_samples(int n)
+{
+    std::vector<Sample> samples;
+    Sample sample = {};
+    for (int i = 0; i < n; i++)
+    {
+        double t = i * 0.005;
+        sample.sensor = i % 4;
+        sample.sequence = i;
+        sample.request_time = 1700000000.0 + t;
+        sample.timestamp = sample.request_time + 0.0012;
+        sample.fields = i % 100 == 0 ? SAMPLE_POSITION : SAMPLE_ALL;
+        for (int j = 0; j < 3; j++)
+        {
+            sample.position[j] = 300 * std::sin(t + j + sample.sensor);
+            sample.angles[j] = 179 * std::cos(0.3 * t + j);
+            for (int k = 0; k < 3; k++)
+            {
+                sample.matrix[j][k] = std::sin(t * (j + 1) + k);
+            }
+        }
+        for (int j = 0; j < 4; j++)
+        {
+            sample.quaternion[j] = 0.5 * std::cos(t + j);
+        }
+        sample.quality = 0.25 + 0.1 * std::sin(t);
+        sample.button = i % 7 == 0;
+        samples.push_back(sample);
+    }
+    return samples;
+}
+
+static bool close_to(double a, double b, double tolerance)
+{
+    return std::fabs(a - b) <= tolerance;
+}
+
+static bool equal(const Sample &a, const Sample &b)
+{
+    bool ok = a.sensor == b.sensor && a.sequence == b.sequence && a.fields == b.fields
+        && close_to(a.timestamp, b.timestamp, 1e-6) && close_to(a.request_time, b.request_time, 1e-6);
+    if (a.fields & SAMPLE_POSITION)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            // position scaling of 36 inches
+            ok = ok && close_to(a.position[j], b.position[j], 914.4 * NATIVE_UNIT / 2);
+        }
+    }
+    if (a.fields & SAMPLE_ANGLES)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            ok = ok && close_to(a.angles[j], b.angles[j], 180 * NATIVE_UNIT / 2);
+        }
+    }
+    if (a.fields & SAMPLE_MATRIX)
+    {
+        for (int j = 0; j < 9; j++)
+        {
+            ok = ok && close_to(a.matrix[j / 3][j % 3], b.matrix[j / 3][j % 3], NATIVE_UNIT / 2);
+        }
+    }
+    if (a.fields & SAMPLE_QUATERNION)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            ok = ok && close_to(a.quaternion[j], b.quaternion[j], NATIVE_UNIT / 2);
+        }
+    }
+    if (a.fields & SAMPLE_QUALITY)
+    {
+        ok = ok && close_to(a.quality, b.quality, NATIVE_UNIT / 2);
+    }
+    if (a.fields & SAMPLE_BUTTON)
+    {
+        ok = ok && a.button == b.button;
+    }
+    return ok;
+}
+
+int test_pose_log_roundtrip()
+{
+    int status = 0;
+    const char *filename = "test_pose_log.atcz";
+
+    std::cout << "Test pose log round trip" << std::endl;
+
+    std::vector<Sample> samples = make_samples(10000);
+    PoseLogWriter writer;
+    writer.open(filename, 512);
+    for (const auto &sample : samples)
+    {
+        writer.write(sample);
+    }
+    writer.close();
+
+    PoseLogReader reader;
+    reader.open(filename);
+    if (reader.size() != samples.size() || reader.blocks().size() != 20)
+    {
+        std::cout << "Test pose log round trip: Failed size test" << std::endl;
+        status++;
+    }
+
+    uint64_t bytes = 0;
+    for (const auto &block : reader.blocks())
+    {
+        bytes += block.bytes;
+    }
+    if (bytes * 4 > samples.size() * RECORDING_RECORD_SIZE)
+    {
+        std::cout << "Test pose log round trip: Failed compression test, "
+                  << (double)bytes / samples.size() << " bytes per sample" << std::endl;
+        status++;
+    }
+
+    Sample sample;
+    size_t i = 0;
+    while (reader.read(sample))
+    {
+        if (i >= samples.size() || !equal(samples[i], sample))
+        {
+            std::cout << "Test pose log round trip: Failed sample " << i << std::endl;
+            status++;
+            break;
+        }
+        i++;
+    }
+    if (i != samples.size())
+    {
+        std::cout << "Test pose log round trip: Failed read test" << std::endl;
+        status++;
+    }
+
+    std::remove(filename);
+    return status;
+}
+
+int test_pose_log_seek()
+{
+    int status = 0;
+    const char *filename = "test_pose_log.atcz";
+
+    std::cout << "Test pose log seek and parallel decode" << std::endl;
+
+    std::vector<Sample> samples = make_samples(5000);
+    PoseLogWriter writer;
+    writer.open(filename, 300);
+    for (const auto &sample : samples)
+    {
+        writer.write(sample);
+    }
+    writer.close();
+
+    PoseLogReader reader;
+    reader.open(filename);
+
+    Sample sample;
+    if (!reader.seek_time(samples[3333].timestamp - 1e-4) || !reader.read(sample) || sample.sequence != 3333)
+    {
+        std::cout << "Test pose log seek: Failed seek test" << std::endl;
+        status++;
+    }
+    if (!reader.seek_time(0) || !reader.read(sample) || sample.sequence != 0)
+    {
+        std::cout << "Test pose log seek: Failed seek to start test" << std::endl;
+        status++;
+    }
+    if (reader.seek_time(samples.back().timestamp + 1) || reader.read(sample))
+    {
+        std::cout << "Test pose log seek: Failed seek past end test" << std::endl;
+        status++;
+    }
+
+    std::vector<Sample> all;
+    reader.read_all(all, 4);
+    bool ok = all.size() == samples.size();
+    for (size_t i = 0; ok && i < all.size(); i++)
+    {
+        ok = equal(samples[i], all[i]);
+    }
+    if (!ok)
+    {
+        std::cout << "Test pose log seek: Failed parallel decode test" << std::endl;
+        status++;
+    }
+
+    std::remove(filename);
+    return status;
+}
+
+int test_pose_log_interrupted()
+{
+    int status = 0;
+    const char *filename = "test_pose_log.atcz";
+
+    std::cout << "Test pose log without index" << std::endl;
+
+    std::vector<Sample> samples = make_samples(5000);
+    PoseLogWriter writer;
+    writer.open(filename, 300);
+    for (const auto &sample : samples)
+    {
+        writer.write(sample);
+    }
+    writer.close();
+
+    PoseLogReader reader;
+    reader.open(filename);
+    std::vector<PoseLogBlock> blocks = reader.blocks();
+    reader.close();
+
+    // index and trailer lost, the blocks are rebuilt from their headers
+    const PoseLogBlock &last = blocks.back();
+    if (truncate(filename, last.offset + last.bytes) != 0)
+    {
+        std::cout << "Test pose log without index: Failed truncate" << std::endl;
+        std::remove(filename);
+        return 1;
+    }
+    reader.open(filename);
+    bool ok = reader.size() == samples.size() && reader.blocks().size() == blocks.size();
+    for (size_t i = 0; ok && i < blocks.size(); i++)
+    {
+        ok = reader.blocks()[i].offset == blocks[i].offset && reader.blocks()[i].first == blocks[i].first
+            && reader.blocks()[i].last_timestamp == blocks[i].last_timestamp;
+    }
+    if (!ok)
+    {
+        std::cout << "Test pose log without index: Failed rebuild test" << std::endl;
+        status++;
+    }
+    Sample sample;
+    if (!reader.seek_time(samples[4000].timestamp) || !reader.read(sample) || !equal(samples[4000], sample))
+    {
+        std::cout << "Test pose log without index: Failed seek test" << std::endl;
+        status++;
+    }
+    reader.close();
+
+    // recording stopped while the last block was written
+    if (truncate(filename, last.offset + last.bytes / 2) != 0)
+    {
+        std::cout << "Test pose log without index: Failed truncate" << std::endl;
+        std::remove(filename);
+        return status + 1;
+    }
+    reader.open(filename);
+    std::vector<Sample> all;
+    reader.read_all(all);
+    ok = reader.blocks().size() == blocks.size() - 1 && all.size() == last.first;
+    for (size_t i = 0; ok && i < all.size(); i++)
+    {
+        ok = equal(samples[i], all[i]);
+    }
+    if (!ok)
+    {
+        std::cout << "Test pose log without index: Failed partial block test" << std::endl;
+        status++;
+    }
+
+    std::remove(filename);
+    return status;
+}
+
+int test_pose_log()
+{
+    return test_pose_log_roundtrip() + test_pose_log_seek() + test_pose_log_interrupted();
+}
+
+int main(int argc, char *argv[])
+{
+    int status = test_pose_log();
+    if (status != 0)
+    {
+        std::cout << "Tests failed." << std::endl;
+    }
+    return status;
+}
@@ -0,0 +1,69 @@
+#include <iostream>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+#include "pose_shm.hpp"
+
+int test_pose_shm_publish()
+{
+    int status = 0;
+    std::string name = "/atc3dg_test_" + std::to_string(getpid());
+
+    std::cout << "Test publish" << std::endl;
+
+    PoseShmWriter writer;
+    writer.open(name);
+    PoseShmReader reader;
+    reader.open(name);
+
+    PoseShmFrame frame;
+    if (reader.latest(frame))
+    {
+        std::cout << "Test publish: Failed empty segment test" << std::endl;
+        status++;
+    }
+
+    for (int i = 0; i < POSE_SHM_HISTORY + 10; i++)
+    {
+        PoseShmFrame &next = writer.begin();
+        next.timestamp = i;
+        next.count = 1;
+        strcpy(next.transforms[0].name, "Tool");
+        next.transforms[0].matrix[0][3] = i;
+        writer.publish();
+    }
+
+    const PoseShmTransform *tool = nullptr;
+    if (!reader.latest(frame) || frame.frame != POSE_SHM_HISTORY + 9 || (tool = PoseShmReader::find(frame, "Tool")) == nullptr || tool->matrix[0][3] != POSE_SHM_HISTORY + 9)
+    {
+        std::cout << "Test publish: Failed latest frame test" << std::endl;
+        status++;
+    }
+
+    if (reader.read(5, frame) || !reader.read(20, frame) || frame.timestamp != 20)
+    {
+        std::cout << "Test publish: Failed history test" << std::endl;
+        status++;
+    }
+
+    reader.close();
+    writer.close();
+
+    return status;
+}
+
+int test_pose_shm()
+{
+    return test_pose_shm_publish();
+}
+
+int main(int argc, char *argv[])
+{
+    int status = test_pose_shm();
+    if (status != 0)
+    {
+        std::cout << "Tests failed." << std::endl;
+    }
+    return status;
+}
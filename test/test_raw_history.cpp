@@ -0,0 +1,196 @@
+#include <iostream>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "raw_history.hpp"
+
+RawSample make_raw(uint64_t sequence, double timestamp)
+{
+    RawSample raw = {};
+    raw.request_time = timestamp - 0.001;
+    raw.timestamp = timestamp;
+    raw.sequence = sequence;
+    raw.scaling = 1;
+    // half of the range
+    raw.words[RAW_WORD_POSITION] = 0x4000;
+    raw.words[RAW_WORD_ANGLES] = -0x4000;
+    raw.words[RAW_WORD_QUATERNION] = 0x2000;
+    raw.button = 1;
+    return raw;
+}
+
+int test_raw_history_decode()
+{
+    int status = 0;
+
+    std::cout << "Test raw sample decode" << std::endl;
+
+    RawSample raw = make_raw(7, 2.0);
+    Sample sample = {};
+    sample.angles[0] = 123;
+    raw_sample_decode(2, raw, SAMPLE_POSITION | SAMPLE_BUTTON, sample);
+    if (sample.sensor != 2 || sample.sequence != 7 || sample.timestamp != 2.0 || std::fabs(sample.request_time - 1.999) > 1e-12)
+    {
+        std::cout << "Test raw sample decode: Failed header test" << std::endl;
+        status++;
+    }
+    // 36 inches times half the range
+    if (std::fabs(sample.position[0] - 457.2) > 1e-9 || !sample.button || sample.fields != (SAMPLE_POSITION | SAMPLE_BUTTON))
+    {
+        std::cout << "Test raw sample decode: Failed position test" << std::endl;
+        status++;
+    }
+    // fields that were not asked for are left alone
+    if (sample.angles[0] != 123)
+    {
+        std::cout << "Test raw sample decode: Failed lazy decode test" << std::endl;
+        status++;
+    }
+
+    raw.scaling = 2;
+    raw_sample_decode(2, raw, SAMPLE_ALL, sample);
+    if (std::fabs(sample.position[0] - 914.4) > 1e-9 || sample.angles[0] != -90 || sample.quaternion[0] != 0.25)
+    {
+        std::cout << "Test raw sample decode: Failed all fields test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_raw_history_ring()
+{
+    int status = 0;
+
+    std::cout << "Test raw history ring" << std::endl;
+
+    RawHistory history(6, 2);
+    if (history.capacity() != 7 || history.memory() != 2 * 8 * 64 || history.memory() * 3 > 2 * 8 * sizeof(Sample))
+    {
+        std::cout << "Test raw history ring: Failed size test" << std::endl;
+        status++;
+    }
+
+    for (int i = 0; i < 20; i++)
+    {
+        history.push(1, make_raw(i, i * 0.01));
+    }
+    // unknown sensors are ignored
+    history.push(5, make_raw(0, 0));
+
+    std::vector<RawSample> raw;
+    if (history.count(1) != 20 || history.count(0) != 0 || history.latest(0, 4, raw) != 0)
+    {
+        std::cout << "Test raw history ring: Failed count test" << std::endl;
+        status++;
+    }
+    if (history.latest(1, 100, raw) != 7 || raw.front().sequence != 13 || raw.back().sequence != 19)
+    {
+        std::cout << "Test raw history ring: Failed wrap test" << std::endl;
+        status++;
+    }
+
+    std::vector<Sample> samples;
+    if (history.decode(1, 3, SAMPLE_POSITION, samples) != 3 || samples[0].sequence != 17 || std::fabs(samples[2].position[0] - 457.2) > 1e-9)
+    {
+        std::cout << "Test raw history ring: Failed decode test" << std::endl;
+        status++;
+    }
+    if (history.decode_range(1, 0.145, 0.175, SAMPLE_BUTTON, samples) != 3 || samples[0].sequence != 15 || samples[2].sequence != 17)
+    {
+        std::cout << "Test raw history ring: Failed range test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_raw_history_batch()
+{
+    int status = 0;
+
+    std::cout << "Test raw history batch" << std::endl;
+
+    RawHistory history(16, 1);
+    for (int i = 0; i < 10; i++)
+    {
+        history.push(0, make_raw(i, i));
+    }
+
+    std::vector<double> position(4 * 3), timestamp(4);
+    std::vector<uint64_t> sequence(4);
+    SampleBatch batch = {};
+    batch.position = position.data();
+    batch.timestamp = timestamp.data();
+    batch.sequence = sequence.data();
+    if (history.read_batch(0, 4, batch) != 4 || sequence[0] != 6 || timestamp[3] != 9 || std::fabs(position[9] - 457.2) > 1e-9)
+    {
+        std::cout << "Test raw history batch: Failed batch test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_raw_history_concurrent()
+{
+    int status = 0;
+
+    std::cout << "Test raw history concurrent" << std::endl;
+
+    // a reader never sees a sample the producer is overwriting
+    RawHistory history(64, 1);
+    std::atomic<bool> done(false);
+    std::thread producer([&]() {
+        for (int i = 0; i < 200000; i++)
+        {
+            RawSample raw = make_raw(i, i);
+            for (int w = 0; w < RAW_SAMPLE_WORDS; w++)
+            {
+                raw.words[w] = (int16_t)i;
+            }
+            history.push(0, raw);
+        }
+        done = true;
+    });
+
+    std::vector<RawSample> raw;
+    bool consistent = true;
+    while (!done && consistent)
+    {
+        history.latest(0, 64, raw);
+        for (size_t i = 0; i < raw.size() && consistent; i++)
+        {
+            consistent = raw[i].sequence == raw[0].sequence + i && raw[i].timestamp == raw[i].sequence;
+            for (int w = 0; w < RAW_SAMPLE_WORDS; w++)
+            {
+                consistent = consistent && raw[i].words[w] == (int16_t)raw[i].sequence;
+            }
+        }
+    }
+    producer.join();
+    if (!consistent)
+    {
+        std::cout << "Test raw history concurrent: Failed torn sample test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_raw_history()
+{
+    return test_raw_history_decode() + test_raw_history_ring() + test_raw_history_batch() + test_raw_history_concurrent();
+}
+
+int main(int argc, char *argv[])
+{
+    int status = test_raw_history();
+    if (status != 0)
+    {
+        std::cout << "Tests failed." << std::endl;
+    }
+    return status;
+}
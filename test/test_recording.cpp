@@ -0,0 +1,88 @@
+#include <iostream>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+
+#include "atc3dg.hpp"
+#include "recording.hpp"
+
+int test_recording_batch()
+{
+    int status = 0;
+    const char *filename = "test_recording.atc";
+
+    std::cout << "Test batch read" << std::endl;
+
+    RecordingWriter writer;
+    writer.open(filename);
+    Sample sample = {};
+    for (int i = 0; i < 1000; i++)
+    {
+        sample.sensor = i % 2;
+        sample.sequence = i;
+        sample.timestamp = i * 0.01;
+        sample.position[2] = i;
+        sample.quaternion[0] = 1.0;
+        sample.button = i % 10 == 0;
+        writer.write(sample);
+    }
+    writer.close();
+
+    RecordingReader reader;
+    reader.open(filename);
+    if (reader.size() != 1000)
+    {
+        std::cout << "Test batch read: Failed size test" << std::endl;
+        status++;
+    }
+    // monotonic timestamps plus the offset are seconds since the epoch
+    if (std::fabs(reader.clock_offset() + atc3dg_time() - std::time(nullptr)) > 2)
+    {
+        std::cout << "Test batch read: Failed clock offset test" << std::endl;
+        status++;
+    }
+
+    double position[600 * 3];
+    double timestamp[600];
+    uint8_t button[600];
+    SampleBatch batch = {};
+    batch.position = position;
+    batch.timestamp = timestamp;
+    batch.button = button;
+
+    int sensors[] = {1};
+    size_t rows = reader.read_batch(sensors, 1, 600, batch);
+    if (rows != 500 || position[2] != 1.0 || position[499 * 3 + 2] != 999.0 || timestamp[1] != 0.03)
+    {
+        std::cout << "Test batch read: Failed sensor filter test" << std::endl;
+        status++;
+    }
+
+    reader.seek(10);
+    rows = reader.read_batch(nullptr, 0, 600, batch);
+    if (rows != 600 || button[0] != 1 || button[1] != 0 || position[2] != 10.0)
+    {
+        std::cout << "Test batch read: Failed seek test" << std::endl;
+        status++;
+    }
+
+    reader.close();
+    std::remove(filename);
+
+    return status;
+}
+
+int test_recording()
+{
+    return test_recording_batch();
+}
+
+int main(int argc, char *argv[])
+{
+    int status = test_recording();
+    if (status != 0)
+    {
+        std::cout << "Tests failed." << std::endl;
+    }
+    return status;
+}
@@ -0,0 +1,99 @@
+#include <iostream>
+#include <cmath>
+
+#include "resampler.hpp"
+
+Pose rotation_z(float degrees, float x)
+{
+    float r = degrees * M_PI / 180.0f;
+    QuadMatrix<4> m;
+    m.set(0, 0, std::cos(r));
+    m.set(0, 1, -std::sin(r));
+    m.set(1, 0, std::sin(r));
+    m.set(1, 1, std::cos(r));
+    m.set(0, 3, x);
+    return Pose::from_matrix(m);
+}
+
+bool near(const Pose &pose_a, const Pose &pose_b)
+{
+    QuadMatrix<4> a = pose_a.matrix();
+    QuadMatrix<4> b = pose_b.matrix();
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            if (std::fabs(a.get(i, j) - b.get(i, j)) > 1e-4f)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int test_resampler_interpolate()
+{
+    int status = 0;
+    Resampler resampler;
+    Pose pose;
+
+    std::cout << "Test interpolation" << std::endl;
+
+    resampler.push(0, 1.0, rotation_z(0, 0));
+    resampler.push(0, 2.0, rotation_z(90, 10));
+
+    if (!resampler.sample(0, 1.5, pose) || !near(pose, rotation_z(45, 5)))
+    {
+        std::cout << "Test interpolation: Failed midpoint test" << std::endl;
+        status++;
+    }
+
+    if (!resampler.sample(0, 3.0, pose) || !near(pose, rotation_z(90, 10)))
+    {
+        std::cout << "Test interpolation: Failed clamp test" << std::endl;
+        status++;
+    }
+
+    if (resampler.sample(1, 1.5, pose))
+    {
+        std::cout << "Test interpolation: Failed empty sensor test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_resampler_common_timestamp()
+{
+    int status = 0;
+    Resampler resampler;
+
+    std::cout << "Test common timestamp" << std::endl;
+
+    resampler.push(0, 1.00, rotation_z(0, 0));
+    resampler.push(1, 1.01, rotation_z(0, 0));
+    resampler.push(0, 1.02, rotation_z(0, 0));
+    if (resampler.common_timestamp({0, 1}) != 1.01)
+    {
+        std::cout << "Test common timestamp: Failed oldest newest sample test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_resampler()
+{
+    return test_resampler_interpolate() + test_resampler_common_timestamp();
+}
+
+int main(int argc, char *argv[])
+{
+    int status = test_resampler();
+    if (status != 0)
+    {
+        std::cout << "Tests failed." << std::endl;
+    }
+    return status;
+}
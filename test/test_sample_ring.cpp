@@ -0,0 +1,92 @@
+#include <iostream>
+#include <thread>
+
+#include "sample_ring.hpp"
+
+int test_sample_ring_overflow()
+{
+    int status = 0;
+    SampleRing ring(4);
+    Sample sample = {};
+
+    std::cout << "Test overflow" << std::endl;
+
+    for (int i = 0; i < 6; i++)
+    {
+        sample.sequence = i;
+        ring.push(sample);
+    }
+    if (ring.size() != 4 || ring.dropped() != 2)
+    {
+        std::cout << "Test overflow: Failed drop count test" << std::endl;
+        status++;
+    }
+
+    if (!ring.pop(sample) || sample.sequence != 0)
+    {
+        std::cout << "Test overflow: Failed oldest sample test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_sample_ring_threads()
+{
+    int status = 0;
+    const int count = 100000;
+    SampleRing ring(64);
+
+    std::cout << "Test producer/consumer" << std::endl;
+
+    std::thread producer([&ring]() {
+        Sample sample = {};
+        for (int i = 0; i < count; i++)
+        {
+            sample.sequence = i;
+            while (!ring.push(sample))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    Sample sample;
+    uint64_t expected = 0;
+    while (expected < count)
+    {
+        if (!ring.pop(sample))
+        {
+            continue;
+        }
+        if (sample.sequence != expected)
+        {
+            status++;
+            break;
+        }
+        expected++;
+    }
+    producer.join();
+
+    if (status != 0)
+    {
+        std::cout << "Test producer/consumer: Failed ordering test" << std::endl;
+    }
+
+    return status;
+}
+
+int test_sample_ring()
+{
+    return test_sample_ring_overflow() + test_sample_ring_threads();
+}
+
+int main(int argc, char *argv[])
+{
+    int status = test_sample_ring();
+    if (status != 0)
+    {
+        std::cout << "Tests failed." << std::endl;
+    }
+    return status;
+}
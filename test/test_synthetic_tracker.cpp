@@ -0,0 +1,184 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "synthetic_tracker.hpp"
+
+int test_synthetic_tracker_determinism()
+{
+    int status = 0;
+
+    std::cout << "Test synthetic tracker determinism" << std::endl;
+
+    SyntheticOptions options;
+    options.sensors = 6;
+    options.seed = 42;
+    SyntheticTracker a(options);
+    SyntheticTracker b(options);
+    a.connect();
+    b.connect();
+
+    // sensor 0 follows sinusoids, pose() of the static motion is its home
+    Sample first = {};
+    SyntheticOptions still = options;
+    still.motion = SYNTHETIC_STATIC;
+    SyntheticTracker c(still);
+    c.connect();
+    c.pose(0, 0, first);
+
+    Sample sa = {};
+    Sample sb = {};
+    bool equal = true;
+    bool moving = false;
+    for (int i = 0; i < 200; i++)
+    {
+        double t = i * 0.05;
+        for (int sensor = 0; sensor < options.sensors; sensor++)
+        {
+            a.pose(sensor, t, sa);
+            b.pose(sensor, t, sb);
+            for (int k = 0; k < 3; k++)
+            {
+                equal = equal && sa.position[k] == sb.position[k] && sa.angles[k] == sb.angles[k];
+            }
+            if (sensor == 0)
+            {
+                moving = moving || std::fabs(first.position[0] - sa.position[0]) > 1;
+            }
+        }
+    }
+    if (!equal || !moving)
+    {
+        std::cout << "Test synthetic tracker determinism: Failed" << std::endl;
+        status++;
+    }
+
+    // rotation matrix and quaternion describe the same orientation
+    double w = sa.quaternion[0];
+    double trace = sa.matrix[0][0] + sa.matrix[1][1] + sa.matrix[2][2];
+    double norm = 0;
+    for (int k = 0; k < 4; k++)
+    {
+        norm += sa.quaternion[k] * sa.quaternion[k];
+    }
+    if (std::fabs(norm - 1) > 1e-9 || std::fabs(4 * w * w - (1 + trace)) > 1e-9)
+    {
+        std::cout << "Test synthetic tracker determinism: Failed orientation test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_synthetic_tracker_topology()
+{
+    int status = 0;
+
+    std::cout << "Test synthetic tracker topology and rate" << std::endl;
+
+    SyntheticOptions options;
+    options.sensors = 300;
+    options.rate = 50000;
+    SyntheticTracker tracker(options);
+    tracker.connect();
+
+    if (tracker.get_number_sensors() != 300 || tracker.get_topology().size() != 300
+        || !tracker.is_attached(299) || tracker.is_attached(300))
+    {
+        std::cout << "Test synthetic tracker topology and rate: Failed topology test" << std::endl;
+        status++;
+    }
+    if (tracker.get_rate() != tracker.get_max_rate())
+    {
+        std::cout << "Test synthetic tracker topology and rate: Failed rate test" << std::endl;
+        status++;
+    }
+
+    Sample sample = {};
+    if (!tracker.poll(299, sample, SAMPLE_POSITION | SAMPLE_MATRIX) || sample.sensor != 299 || sample.timestamp <= 0)
+    {
+        std::cout << "Test synthetic tracker topology and rate: Failed poll test" << std::endl;
+        status++;
+    }
+    std::vector<Sample> samples;
+    if (tracker.poll_all({3, 1, 2}, samples, SAMPLE_POSITION) != 3 || samples[0].sensor != 3 || samples[2].sensor != 2)
+    {
+        std::cout << "Test synthetic tracker topology and rate: Failed poll_all test" << std::endl;
+        status++;
+    }
+    tracker.disconnect();
+    if (tracker.good() || tracker.poll(0, sample))
+    {
+        std::cout << "Test synthetic tracker topology and rate: Failed disconnect test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_synthetic_tracker_acquisition()
+{
+    int status = 0;
+
+    std::cout << "Test synthetic tracker acquisition thread" << std::endl;
+
+    SyntheticOptions options;
+    options.sensors = 8;
+    options.rate = 1000;
+    SyntheticTracker tracker(options);
+    tracker.connect();
+
+    std::atomic<int> samples(0);
+    std::atomic<int> wrong(0);
+    tracker.subscribe([&](const Sample& sample) {
+        samples++;
+        if (sample.sensor < 0 || sample.sensor >= 8)
+        {
+            wrong++;
+        }
+    });
+    // a callback may unsubscribe itself
+    std::atomic<int> once(0);
+    int id = -1;
+    id = tracker.subscribe([&](const Sample&) {
+        if (once++ == 0)
+        {
+            tracker.unsubscribe(id);
+        }
+    });
+    tracker.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    tracker.stop();
+
+    // 8 sensors at 1 kHz, allow for a loaded machine
+    if (samples < 8 * 50 || wrong != 0)
+    {
+        std::cout << "Test synthetic tracker acquisition thread: Failed, " << samples << " samples" << std::endl;
+        status++;
+    }
+    if (once != 1)
+    {
+        std::cout << "Test synthetic tracker acquisition thread: Failed unsubscribe from a callback test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_synthetic_tracker()
+{
+    return test_synthetic_tracker_determinism() + test_synthetic_tracker_topology() + test_synthetic_tracker_acquisition();
+}
+
+int main(int argc, char *argv[])
+{
+    int status = test_synthetic_tracker();
+    if (status != 0)
+    {
+        std::cout << "Tests failed." << std::endl;
+    }
+    return status;
+}
@@ -0,0 +1,190 @@
+#include <iostream>
+#include <cmath>
+
+#include "transform_graph.hpp"
+
+Pose translation(float x, float y, float z)
+{
+    QuadMatrix<4> m;
+    m.set(0, 3, x);
+    m.set(1, 3, y);
+    m.set(2, 3, z);
+    return Pose::from_matrix(m);
+}
+
+bool near(const Pose &pose_a, const Pose &pose_b)
+{
+    QuadMatrix<4> a = pose_a.matrix();
+    QuadMatrix<4> b = pose_b.matrix();
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            if (std::fabs(a.get(i, j) - b.get(i, j)) > 1e-4f)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int test_transform_graph_default()
+{
+    int status = 0;
+    TransformGraph graph = TransformGraph::default_graph();
+
+    std::cout << "Test default graph" << std::endl;
+
+    graph.begin_frame();
+    graph.set_sensor(0, translation(10, 0, 0));
+    graph.set_sensor(1, translation(10, 5, 0));
+    graph.evaluate();
+
+    int index = graph.find("ToolToReference");
+    if (index < 0 || !near(graph.node(index).value, translation(0, 5, 0)))
+    {
+        std::cout << "Test default graph: Failed ToolToReference test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_transform_graph_incremental()
+{
+    int status = 0;
+    TransformGraph graph;
+    graph.add_sensor("Reference", 0);
+    graph.add_sensor("Tool", 1);
+    graph.add_fixed("Tip", translation(0, 0, 100), "Tool");
+    graph.add_relative("TipToReference", "Tip", "Reference");
+
+    std::cout << "Test incremental evaluation" << std::endl;
+
+    graph.begin_frame();
+    graph.set_sensor(0, translation(1, 0, 0));
+    graph.set_sensor(1, translation(1, 0, 0));
+    graph.evaluate();
+    if (graph.evaluations() != 2)
+    {
+        std::cout << "Test incremental evaluation: Failed first frame test" << std::endl;
+        status++;
+    }
+    if (!near(graph.node(graph.find("TipToReference")).value, translation(0, 0, 100)))
+    {
+        std::cout << "Test incremental evaluation: Failed value test" << std::endl;
+        status++;
+    }
+
+    graph.begin_frame();
+    graph.evaluate();
+    if (graph.evaluations() != 0)
+    {
+        std::cout << "Test incremental evaluation: Failed unchanged frame test" << std::endl;
+        status++;
+    }
+
+    graph.begin_frame();
+    graph.set_sensor(0, translation(2, 0, 0));
+    graph.evaluate();
+    if (graph.evaluations() != 1)
+    {
+        std::cout << "Test incremental evaluation: Failed reference-only frame test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_transform_graph_detached()
+{
+    int status = 0;
+    TransformGraph graph;
+    graph.add_sensor("Reference", 0);
+    graph.add_sensor("Tool", 1);
+    graph.add_fixed("Tip", translation(0, 0, 100), "Tool");
+    graph.add_relative("TipToReference", "Tip", "Reference");
+
+    std::cout << "Test detached sensor" << std::endl;
+
+    graph.begin_frame();
+    graph.set_sensor(0, translation(1, 0, 0));
+    graph.set_sensor(1, translation(1, 0, 0));
+    graph.evaluate();
+
+    // the tool is unplugged, its pose and everything derived from it are gone
+    graph.begin_frame();
+    graph.set_sensor(0, translation(2, 0, 0));
+    graph.clear_sensor(1);
+    graph.evaluate();
+    if (graph.node(graph.find("Tool")).valid || graph.node(graph.find("Tip")).valid || graph.node(graph.find("TipToReference")).valid)
+    {
+        std::cout << "Test detached sensor: Failed invalidation test" << std::endl;
+        status++;
+    }
+    if (!graph.node(graph.find("Reference")).valid || !graph.node(graph.find("TipToReference")).changed)
+    {
+        std::cout << "Test detached sensor: Failed reference test" << std::endl;
+        status++;
+    }
+
+    // and come back with the next pose
+    graph.begin_frame();
+    graph.set_sensor(1, translation(2, 0, 0));
+    graph.evaluate();
+    int index = graph.find("TipToReference");
+    if (!graph.node(index).valid || !near(graph.node(index).value, translation(0, 0, 100)))
+    {
+        std::cout << "Test detached sensor: Failed reattach test" << std::endl;
+        status++;
+    }
+
+    return status;
+}
+
+int test_transform_graph_parse()
+{
+    int status = 0;
+    TransformGraph graph;
+
+    std::cout << "Test parse" << std::endl;
+
+    graph.parse(R"({"transforms": [
+        {"name": "Reference", "type": "sensor", "port": 0},
+        {"name": "Offset", "type": "fixed", "parent": "Reference",
+         "matrix": [[1, 0, 0, 0], [0, 1, 0, 0], [0, 0, 1, 5], [0, 0, 0, 1]]}
+    ]})");
+    if (graph.size() != 2 || graph.ports().size() != 1)
+    {
+        std::cout << "Test parse: Failed node count test" << std::endl;
+        status++;
+    }
+
+    try
+    {
+        graph.parse(R"({"transforms": [{"name": "A", "type": "relative", "from": "B", "to": "C"}]})");
+        std::cout << "Test parse: Failed undeclared input test" << std::endl;
+        status++;
+    }
+    catch (const std::runtime_error &)
+    {
+    }
+
+    return status;
+}
+
+int test_transform_graph()
+{
+    return test_transform_graph_default() + test_transform_graph_incremental() + test_transform_graph_detached() + test_transform_graph_parse();
+}
+
+int main(int argc, char *argv[])
+{
+    int status = test_transform_graph();
+    if (status != 0)
+    {
+        std::cout << "Tests failed." << std::endl;
+    }
+    return status;
+}
@@ -20,9 +20,29 @@ int test_vector_length()
     return status;
 }
 
+int test_vector_operators()
+{
+    int status = 0;
+
+    std::cout << "Test vector operators" << std::endl;
+
+    constexpr Vector<3> x({1.0f, 0.0f, 0.0f});
+    constexpr Vector<3> y({0.0f, 2.0f, 0.0f});
+    static_assert(x.dot(y) == 0.0f && (x + y).get(1) == 2.0f, "Vector is not constexpr");
+
+    Vector<3> v = 2.0f * x - y;
+    v += x;
+    if (v != Vector<3>({3.0f, -2.0f, 0.0f}) || v.dot(v) != 13.0f)
+    {
+        std::cout << "Test vector operators: Failed" << std::endl;
+        status++;
+    }
+    return status;
+}
+
 int test_vector()
 {
-    return test_vector_length();
+    return test_vector_length() + test_vector_operators();
 }
 
 int main(int argc, char *argv[])